@@ -66,6 +66,7 @@ create table private_messages
 (
     id           serial
         primary key,
+    message_id   bigint,
     from_user_id integer                                                       not null
         constraint fk_private_messages_from_user
             references users
@@ -99,6 +100,9 @@ create index idx_private_messages_timestamp
 create index idx_private_messages_users
     on private_messages (from_user_id, to_user_id);
 
+create unique index idx_private_messages_message_id
+    on private_messages (message_id);
+
 create table groups
 (
     id          serial
@@ -121,6 +125,7 @@ create table group_messages
 (
     id           serial
         primary key,
+    message_id   bigint,
     group_id     integer                                                     not null
         constraint fk_group_messages_group
             references groups
@@ -150,6 +155,9 @@ create index idx_group_messages_from_user
 create index idx_group_messages_timestamp
     on group_messages (timestamp);
 
+create unique index idx_group_messages_message_id
+    on group_messages (message_id);
+
 create table group_members
 (
     id        serial
@@ -0,0 +1,13 @@
+-- 为已有数据库添加消息ID列
+-- 归档线程按 message_id 去重写入，重新读取的消息流记录不会重复插入；旧记录的 message_id 为空
+alter table private_messages
+    add column if not exists message_id bigint;
+
+create unique index if not exists idx_private_messages_message_id
+    on private_messages (message_id);
+
+alter table group_messages
+    add column if not exists message_id bigint;
+
+create unique index if not exists idx_group_messages_message_id
+    on group_messages (message_id);
@@ -1,8 +1,15 @@
 #include <iostream>
+#include <memory>
 #include <signal.h>
 #include "server/ChatServer.h"
+#include "server/CpuAffinity.h"
+#include "server/ServerConfig.h"
+#include "metrics/MetricsServer.h"
+#include "metrics/Tracer.h"
+#include "model/UserModel.h"
 #include "muduo/base/Logging.h"
 #include "muduo/net/EventLoop.h"
+#include "service/IdGenerator.h"
 #include "service/MessageArchiveService.h"
 #include "service/RedisService.h"
 
@@ -26,30 +33,53 @@ int main(int argc, char* argv[]) {
     signal(SIGINT, handleSignal);
     signal(SIGTERM, handleSignal);
     
-    // 设置服务器监听地址和端口
-    uint16_t port = 8888;
-    std::string ip = "0.0.0.0";
-    
-    if (argc > 1) {
-        port = static_cast<uint16_t>(std::stoi(argv[1]));
+    // 加载配置：--config=文件 和 --key=value，兼容 "端口 [IP] [reuseport]" 位置参数
+    ServerConfig config;
+    if (!config.load(argc, argv)) {
+        LOG_ERROR << "Usage: " << argv[0] << " [port [ip [reuseport]]] [--config=file] [--key=value ...]";
+        return 1;
     }
     
-    if (argc > 2) {
-        ip = argv[2];
+    std::vector<int> ioCpus;
+    std::vector<int> workerCpus;
+    if (!CpuAffinity::resolve(config.ioCpus, &ioCpus) ||
+        !CpuAffinity::resolve(config.workerCpus, &workerCpus)) {
+        return 1;
     }
     
-    muduo::net::InetAddress serverAddr(ip, port);
+    // reuse_port 开启时每个I/O线程各自监听端口
+    ChatServer::AcceptMode acceptMode = config.reusePort ? ChatServer::AcceptMode::REUSE_PORT
+                                                         : ChatServer::AcceptMode::SINGLE_ACCEPTOR;
+    
+    muduo::net::InetAddress serverAddr(config.ip, config.port);
     
     // 创建事件循环
     muduo::net::EventLoop loop;
     
+    // 追踪采样
+    Tracer::getInstance().setSampleRate(config.traceSampleRate);
+    Tracer::getInstance().setCapacity(static_cast<size_t>(config.traceBufferSpans));
+    
+    // 消息ID的节点部分
+    IdGenerator::getInstance().setNodeId(config.nodeId);
+    
     // 初始化Redis服务
-    if (!RedisService::getInstance().init("127.0.0.1", 6379, "2932897504xu")) {
+    RedisService::getInstance().setGroupLogOptions(config.largeGroupThreshold, config.groupLogLength);
+    RedisService::getInstance().setStreamMaxLength(config.messageStreamMaxLength);
+    if (!RedisService::getInstance().init(config.redisHost, config.redisPort, config.redisPassword,
+                                          config.redisDb, config.redisPoolSize)) {
         LOG_ERROR << "Failed to initialize Redis service";
         return 1;
     }
     LOG_INFO << "Redis service initialized successfully";
     
+    // 初始化数据库连接池
+    if (!UserModel::getInstance().init(config.pgConninfo, config.pgPoolSize)) {
+        LOG_ERROR << "Failed to initialize database connection pool";
+        return 1;
+    }
+    LOG_INFO << "Database connection pool initialized successfully";
+    
     // 初始化消息归档服务
     if (!MessageArchiveService::getInstance().init()) {
         LOG_ERROR << "Failed to initialize Message Archive service";
@@ -61,16 +91,36 @@ int main(int argc, char* argv[]) {
     MessageArchiveService::getInstance().start();
     
     // 创建聊天服务器
-    ChatServer server(&loop, serverAddr, "ChatServer");
+    ChatServer server(&loop, serverAddr, "ChatServer", acceptMode);
     g_chatServer = &server;
+    server.setIoThreads(config.ioThreads);
+    server.setIoCpuAffinity(ioCpus);
+    server.setWorkerThreads(config.workerThreads);
+    server.setWorkerCpuAffinity(workerCpus);
+    server.setMaxInFlightRequests(config.maxInFlight);
+    server.setWriteCoalescing(config.writeCoalescing);
+    server.setCompression(config.compression, config.compressionThreshold);
+    server.setIdleTimeout(config.idleTimeout, config.idleTick);
+    server.setWatchdogThreshold(config.watchdogThresholdMs);
     
     // 启动服务器
     server.start();
     
-    LOG_INFO << "Chat server is running on " << ip << ":" << port;
+    // 指标HTTP服务运行在主线程的事件循环中
+    std::unique_ptr<MetricsServer> metricsServer;
+    if (config.metricsPort != 0) {
+        metricsServer = std::make_unique<MetricsServer>(&loop, muduo::net::InetAddress(config.metricsIp, config.metricsPort));
+        metricsServer->start();
+    }
+    
+    LOG_INFO << "Chat server is running on " << config.ip << ":" << config.port;
     
     // 运行事件循环
     loop.loop();
+    server.logStats();
+    if (!config.traceFile.empty() && Tracer::getInstance().dumpToFile(config.traceFile)) {
+        LOG_INFO << "Traces written to " << config.traceFile;
+    }
     
     // 停止消息归档服务
     MessageArchiveService::getInstance().stop();
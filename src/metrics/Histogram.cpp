@@ -0,0 +1,117 @@
+#include "Histogram.h"
+#include <algorithm>
+
+namespace {
+
+std::atomic<size_t> nextHistogramId{0};
+
+} // namespace
+
+Histogram::Histogram()
+    : id_(nextHistogramId.fetch_add(1, std::memory_order_relaxed))
+{
+}
+
+Histogram::~Histogram() = default;
+
+int Histogram::bucketOf(uint64_t value)
+{
+    if (value < kSubBuckets) {
+        return static_cast<int>(value);
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    if (exponent > kMaxExponent) {
+        return kBuckets - 1;
+    }
+    int sub = static_cast<int>(value >> (exponent - kSubBucketBits)) & (kSubBuckets - 1);
+    return kSubBuckets + (exponent - kSubBucketBits) * kSubBuckets + sub;
+}
+
+uint64_t Histogram::bucketUpperBound(int bucket)
+{
+    if (bucket < kSubBuckets) {
+        return static_cast<uint64_t>(std::max(bucket, 0));
+    }
+    if (bucket >= kBuckets - 1) {
+        return UINT64_MAX;
+    }
+    int exponent = (bucket - kSubBuckets) / kSubBuckets + kSubBucketBits;
+    uint64_t sub = static_cast<uint64_t>((bucket - kSubBuckets) % kSubBuckets);
+    uint64_t width = uint64_t(1) << (exponent - kSubBucketBits);
+    return (uint64_t(kSubBuckets) + sub + 1) * width - 1;
+}
+
+std::vector<Histogram::Shard*>& Histogram::threadShards()
+{
+    thread_local std::vector<Shard*> shards;
+    return shards;
+}
+
+Histogram::Shard* Histogram::addShard()
+{
+    auto shard = std::make_unique<Shard>();
+    Shard* shardPtr = shard.get();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shards_.push_back(std::move(shard));
+    }
+    
+    std::vector<Shard*>& shards = threadShards();
+    if (shards.size() <= id_) {
+        shards.resize(id_ + 1, nullptr);
+    }
+    shards[id_] = shardPtr;
+    return shardPtr;
+}
+
+Histogram::Snapshot Histogram::snapshot() const
+{
+    Snapshot snap;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& shard : shards_) {
+        for (int i = 0; i < kBuckets; ++i) {
+            uint64_t n = shard->buckets[i].load(std::memory_order_relaxed);
+            snap.buckets[i] += n;
+            snap.count += n;
+        }
+        snap.sum += shard->sum.load(std::memory_order_relaxed);
+        snap.max = std::max(snap.max, shard->max.load(std::memory_order_relaxed));
+    }
+    return snap;
+}
+
+uint64_t Histogram::Snapshot::percentile(double q) const
+{
+    if (count == 0) {
+        return 0;
+    }
+    q = std::clamp(q, 0.0, 1.0);
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * static_cast<double>(count) + 0.5));
+    uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::min(bucketUpperBound(i), max);
+        }
+    }
+    return max;
+}
+
+uint64_t Histogram::Snapshot::countAtOrBelow(uint64_t bound) const
+{
+    uint64_t total = 0;
+    for (int i = 0; i < kBuckets && bucketUpperBound(i) <= bound; ++i) {
+        total += buckets[i];
+    }
+    return total;
+}
+
+void Histogram::Snapshot::merge(const Snapshot& other)
+{
+    for (int i = 0; i < kBuckets; ++i) {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    sum += other.sum;
+    max = std::max(max, other.max);
+}
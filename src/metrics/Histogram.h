@@ -0,0 +1,96 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "muduo/base/noncopyable.h"
+
+// 延迟直方图，对数线性分桶，按线程分片
+//
+// 分桶：小于8的值各占一个桶；之后每个2的幂区间 [2^e, 2^(e+1)) 等分为8个桶，相对误差不超过12.5%。
+// 单位由调用方决定（通常为微秒），超过 2^kMaxExponent 的值计入最后一个桶。
+//
+// 每个线程第一次记录时为该直方图分配自己的分片，之后记录只对本线程分片的一个桶做一次relaxed原子加，
+// sum 和 max 由分片所属线程独占写入，不需要原子读改写。
+// 快照时合并所有分片并计算分位数，不影响记录方。线程退出后其分片仍保留在直方图中。
+class Histogram : muduo::noncopyable {
+public:
+    static constexpr int kSubBucketBits = 3;
+    static constexpr int kSubBuckets = 1 << kSubBucketBits;
+    static constexpr int kMaxExponent = 40;
+    static constexpr int kBuckets = kSubBuckets + (kMaxExponent - kSubBucketBits + 1) * kSubBuckets;
+
+    // 某一时刻的计数
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+        std::vector<uint64_t> buckets = std::vector<uint64_t>(kBuckets);
+
+        // q 取 0~1，返回该分位数所在桶的上界（不超过最大值），没有数据时返回0
+        uint64_t percentile(double q) const;
+
+        // 不超过 bound 的值的数量，bound 为某个桶的上界时结果精确
+        uint64_t countAtOrBelow(uint64_t bound) const;
+
+        double mean() const { return count > 0 ? static_cast<double>(sum) / static_cast<double>(count) : 0.0; }
+
+        // 合并另一个快照
+        void merge(const Snapshot& other);
+    };
+
+    Histogram();
+    ~Histogram();
+
+    // 值所在的桶
+    static int bucketOf(uint64_t value);
+
+    // 桶的上界（含）
+    static uint64_t bucketUpperBound(int bucket);
+
+    void record(uint64_t value)
+    {
+        Shard* shard = localShard();
+        shard->buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        shard->sum.store(shard->sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        if (value > shard->max.load(std::memory_order_relaxed)) {
+            shard->max.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    Snapshot snapshot() const;
+
+private:
+    // 一个线程的计数，只由该线程写入
+    struct Shard {
+        std::atomic<uint64_t> buckets[kBuckets] = {};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+    };
+
+    Shard* localShard()
+    {
+        std::vector<Shard*>& shards = threadShards();
+        if (id_ < shards.size() && shards[id_]) {
+            return shards[id_];
+        }
+        return addShard();
+    }
+
+    // 当前线程的分片表，按直方图编号索引
+    static std::vector<Shard*>& threadShards();
+
+    // 为当前线程分配分片
+    Shard* addShard();
+
+    // 编号全局递增、不会复用，已销毁直方图在各线程分片表中留下的指针不会再被访问
+    const size_t id_;
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,172 @@
+#include "Metrics.h"
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+// 导出的直方图桶数，边界为 2^i - 1，最大约为 2^26 微秒（67秒）或 2^26 个
+constexpr int kExportBuckets = 27;
+
+int64_t nowMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string formatDouble(double value)
+{
+    char buf[32];
+    snprintf(buf, sizeof buf, "%.9g", value);
+    return buf;
+}
+
+} // namespace
+
+int Counter::shardIndex()
+{
+    static std::atomic<int> nextShard{0};
+    thread_local int shard = nextShard.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return shard;
+}
+
+uint64_t Counter::value() const
+{
+    uint64_t total = 0;
+    for (const Shard& shard : shards_) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void PrometheusWriter::family(const std::string& name, const char* type, const char* help)
+{
+    if (name == lastFamily_) {
+        return;
+    }
+    lastFamily_ = name;
+    out_ += "# HELP " + name + " " + help + "\n";
+    out_ += "# TYPE " + name + " " + type + "\n";
+}
+
+void PrometheusWriter::sample(const std::string& name, const std::string& labels, double value)
+{
+    out_ += name;
+    if (!labels.empty()) {
+        out_ += "{" + labels + "}";
+    }
+    out_ += " " + formatDouble(value) + "\n";
+}
+
+void PrometheusWriter::histogram(const std::string& name, const std::string& labels,
+                                 const Histogram::Snapshot& snapshot, double scale)
+{
+    const std::string prefix = labels.empty() ? "" : labels + ",";
+    // 按2的幂输出桶边界，它们也是对数线性分桶的边界，累计数精确
+    for (int i = 0; i < kExportBuckets; ++i) {
+        uint64_t bound = (uint64_t(1) << i) - 1;
+        sample(name + "_bucket", prefix + "le=\"" + formatDouble(static_cast<double>(bound) * scale) + "\"",
+               static_cast<double>(snapshot.countAtOrBelow(bound)));
+    }
+    sample(name + "_bucket", prefix + "le=\"+Inf\"", static_cast<double>(snapshot.count));
+    sample(name + "_sum", labels, static_cast<double>(snapshot.sum) * scale);
+    sample(name + "_count", labels, static_cast<double>(snapshot.count));
+}
+
+std::string PrometheusWriter::escape(const std::string& value)
+{
+    std::string result;
+    result.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            result += '\\';
+            result += c;
+        } else if (c == '\n') {
+            result += "\\n";
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+MetricsRegistry& MetricsRegistry::getInstance()
+{
+    static MetricsRegistry instance;
+    return instance;
+}
+
+int MetricsRegistry::addCollector(Collector collector)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    int id = nextCollectorId_++;
+    collectors_.emplace(id, std::move(collector));
+    return id;
+}
+
+void MetricsRegistry::removeCollector(int id)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    collectors_.erase(id);
+}
+
+Histogram& MetricsRegistry::latency(const std::string& component, const std::string& operation)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& histogram = latency_[std::make_pair(component, operation)];
+    if (!histogram) {
+        histogram = std::make_unique<Histogram>();
+    }
+    return *histogram;
+}
+
+std::string MetricsRegistry::scrape()
+{
+    PrometheusWriter writer;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : collectors_) {
+        entry.second(writer);
+    }
+    
+    writer.family("chat_operation_duration_seconds", "histogram",
+                  "Latency of message dispatch, Redis, PostgreSQL and archive operations");
+    for (const auto& entry : latency_) {
+        std::string labels = "component=\"" + PrometheusWriter::escape(entry.first.first) +
+                             "\",operation=\"" + PrometheusWriter::escape(entry.first.second) + "\"";
+        writer.histogram("chat_operation_duration_seconds", labels, entry.second->snapshot(), 1e-6);
+    }
+    return writer.str();
+}
+
+std::string MetricsRegistry::latencyReport()
+{
+    std::string report = "component operation count p50_us p99_us p999_us max_us\n";
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : latency_) {
+        Histogram::Snapshot snap = entry.second->snapshot();
+        if (snap.count == 0) {
+            continue;
+        }
+        report += entry.first.first + " " + entry.first.second + " " + std::to_string(snap.count) + " " +
+                  std::to_string(snap.percentile(0.5)) + " " + std::to_string(snap.percentile(0.99)) + " " +
+                  std::to_string(snap.percentile(0.999)) + " " + std::to_string(snap.max) + "\n";
+    }
+    return report;
+}
+
+ScopedLatency::ScopedLatency(Histogram& histogram, const char* component, const char* operation)
+    : histogram_(histogram),
+      component_(component),
+      operation_(operation),
+      start_(nowMicros())
+{
+}
+
+ScopedLatency::~ScopedLatency()
+{
+    int64_t elapsed = nowMicros() - start_;
+    histogram_.record(static_cast<uint64_t>(elapsed));
+    if (uint64_t traceId = Tracer::current()) {
+        Tracer::getInstance().record(traceId, component_, operation_, start_, elapsed);
+    }
+}
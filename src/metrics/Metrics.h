@@ -0,0 +1,117 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include "muduo/base/noncopyable.h"
+#include "Histogram.h"
+#include "Tracer.h"
+
+// 计数器，按线程分片
+//
+// 每个线程第一次记录时分到一个分片，之后只对自己的分片做relaxed原子加，不与其他线程争用缓存行；
+// 读取时把所有分片相加。线程数超过分片数时多个线程共用分片，结果仍然正确。
+class Counter : muduo::noncopyable {
+public:
+    static constexpr int kShards = 64;
+
+    void add(uint64_t n = 1) { shards_[shardIndex()].value.fetch_add(n, std::memory_order_relaxed); }
+
+    uint64_t value() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+
+    // 当前线程的分片编号
+    static int shardIndex();
+
+    std::array<Shard, kShards> shards_;
+};
+
+// Prometheus 文本格式输出
+class PrometheusWriter {
+public:
+    // 指标族的 HELP 和 TYPE 行，同名指标族只输出一次
+    void family(const std::string& name, const char* type, const char* help);
+
+    // 一个样本，labels 形如 type="LOGIN_REQUEST",loop="0"，可以为空
+    void sample(const std::string& name, const std::string& labels, double value);
+
+    // 直方图的 _bucket、_sum、_count 样本，scale 把记录单位换算为输出单位（如微秒换算为秒）
+    void histogram(const std::string& name, const std::string& labels,
+                   const Histogram::Snapshot& snapshot, double scale);
+
+    // 转义标签值
+    static std::string escape(const std::string& value);
+
+    const std::string& str() const { return out_; }
+
+private:
+    std::string out_;
+    std::string lastFamily_;
+};
+
+// 指标注册表
+//
+// 各模块注册采集函数，抓取时依次调用生成 Prometheus 文本；
+// 操作延迟（消息分发、Redis、数据库、归档调用）按 component/operation 登记在注册表中，由注册表统一输出。
+class MetricsRegistry {
+public:
+    using Collector = std::function<void(PrometheusWriter&)>;
+
+    static MetricsRegistry& getInstance();
+
+    // 注册采集函数，返回的编号用于注销
+    int addCollector(Collector collector);
+    void removeCollector(int id);
+
+    // 操作延迟直方图（微秒），第一次调用时创建，之后不会释放，调用方可以缓存引用
+    Histogram& latency(const std::string& component, const std::string& operation);
+
+    // 生成全部指标
+    std::string scrape();
+
+    // 各操作延迟的分位数（微秒），每行一个操作：component operation count p50 p99 p999 max
+    std::string latencyReport();
+
+private:
+    MetricsRegistry() = default;
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    std::mutex mutex_;
+    int nextCollectorId_ = 0;
+    std::map<int, Collector> collectors_;
+    std::map<std::pair<std::string, std::string>, std::unique_ptr<Histogram>> latency_;
+};
+
+// 记录作用域耗时（微秒），当前线程处于追踪中时同时记录一个 span
+class ScopedLatency : muduo::noncopyable {
+public:
+    // component 和 operation 必须是静态字符串
+    ScopedLatency(Histogram& histogram, const char* component, const char* operation);
+    ~ScopedLatency();
+
+private:
+    Histogram& histogram_;
+    const char* component_;
+    const char* operation_;
+    int64_t start_;
+};
+
+// 记录当前作用域的操作延迟，直方图只在第一次执行时查找
+#define METRICS_LATENCY_SCOPE(component, operation) \
+    static Histogram& metricsLatency_ = MetricsRegistry::getInstance().latency(component, operation); \
+    ScopedLatency metricsLatencyScope_(metricsLatency_, component, operation)
+
+#endif // METRICS_H
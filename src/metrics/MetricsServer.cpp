@@ -0,0 +1,45 @@
+#include "MetricsServer.h"
+#include "Metrics.h"
+#include "Tracer.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/http/HttpRequest.h"
+#include "muduo/net/http/HttpResponse.h"
+
+MetricsServer::MetricsServer(muduo::net::EventLoop* loop, const muduo::net::InetAddress& listenAddr)
+    : server_(loop, listenAddr, "MetricsServer"),
+      ipPort_(listenAddr.toIpPort())
+{
+    server_.setHttpCallback([this](const muduo::net::HttpRequest& req, muduo::net::HttpResponse* resp) {
+        onRequest(req, resp);
+    });
+}
+
+void MetricsServer::start()
+{
+    server_.start();
+    LOG_INFO << "Metrics endpoint listening on http://" << ipPort_ << "/metrics";
+}
+
+void MetricsServer::onRequest(const muduo::net::HttpRequest& req, muduo::net::HttpResponse* resp)
+{
+    if (req.method() == muduo::net::HttpRequest::kGet && req.path() == "/metrics") {
+        resp->setStatusCode(muduo::net::HttpResponse::k200Ok);
+        resp->setStatusMessage("OK");
+        resp->setContentType("text/plain; version=0.0.4");
+        resp->setBody(MetricsRegistry::getInstance().scrape());
+    } else if (req.method() == muduo::net::HttpRequest::kGet && req.path() == "/latency") {
+        resp->setStatusCode(muduo::net::HttpResponse::k200Ok);
+        resp->setStatusMessage("OK");
+        resp->setContentType("text/plain");
+        resp->setBody(MetricsRegistry::getInstance().latencyReport());
+    } else if (req.method() == muduo::net::HttpRequest::kGet && req.path() == "/traces") {
+        resp->setStatusCode(muduo::net::HttpResponse::k200Ok);
+        resp->setStatusMessage("OK");
+        resp->setContentType("application/json");
+        resp->setBody(Tracer::getInstance().dumpChromeJson());
+    } else {
+        resp->setStatusCode(muduo::net::HttpResponse::k404NotFound);
+        resp->setStatusMessage("Not Found");
+        resp->setCloseConnection(true);
+    }
+}
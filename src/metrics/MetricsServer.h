@@ -0,0 +1,29 @@
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <string>
+#include "muduo/base/noncopyable.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/InetAddress.h"
+#include "muduo/net/http/HttpServer.h"
+
+// 指标HTTP服务
+//   GET /metrics  Prometheus 文本格式的全部指标
+//   GET /latency  各操作延迟的 p50/p99/p999（微秒）
+//   GET /traces   环形缓冲区中的追踪记录，Chrome trace-event 格式
+//
+// 运行在给定的事件循环中（通常是主线程），抓取时合并各线程的计数，不影响记录方。
+class MetricsServer : muduo::noncopyable {
+public:
+    MetricsServer(muduo::net::EventLoop* loop, const muduo::net::InetAddress& listenAddr);
+
+    void start();
+
+private:
+    void onRequest(const muduo::net::HttpRequest& req, muduo::net::HttpResponse* resp);
+
+    muduo::net::HttpServer server_;
+    const std::string ipPort_;
+};
+
+#endif // METRICS_SERVER_H
@@ -0,0 +1,177 @@
+#include "Tracer.h"
+#include "muduo/base/CurrentThread.h"
+#include "muduo/base/Logging.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+namespace {
+
+constexpr size_t kDefaultCapacity = 65536;
+constexpr double kDefaultSampleRate = 0.001;
+
+// 每个线程独立的 xorshift 随机数，采样判断不需要加锁
+uint64_t nextRandom()
+{
+    thread_local uint64_t state = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()) ^
+                                  (static_cast<uint64_t>(muduo::CurrentThread::tid()) << 32) ^ 0x9E3779B97F4A7C15ULL;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+uint64_t thresholdOf(double rate)
+{
+    if (rate <= 0.0) {
+        return 0;
+    }
+    if (rate >= 1.0) {
+        return UINT64_MAX;
+    }
+    return static_cast<uint64_t>(rate * 18446744073709551616.0);
+}
+
+} // namespace
+
+thread_local uint64_t Tracer::t_traceId = 0;
+
+Tracer::Scope::Scope(uint64_t traceId)
+    : prev_(t_traceId)
+{
+    t_traceId = traceId;
+}
+
+Tracer::Scope::~Scope()
+{
+    t_traceId = prev_;
+}
+
+Tracer::Span::Span(const char* category, const char* name)
+    : traceId_(t_traceId),
+      category_(category),
+      name_(name),
+      start_(traceId_ ? nowMicros() : 0)
+{
+}
+
+Tracer::Span::~Span()
+{
+    if (traceId_) {
+        Tracer::getInstance().record(traceId_, category_, name_, start_, nowMicros() - start_);
+    }
+}
+
+Tracer& Tracer::getInstance()
+{
+    static Tracer instance;
+    return instance;
+}
+
+Tracer::Tracer()
+    : sampleThreshold_(thresholdOf(kDefaultSampleRate)),
+      ring_(kDefaultCapacity)
+{
+}
+
+void Tracer::setSampleRate(double rate)
+{
+    sampleThreshold_.store(thresholdOf(rate), std::memory_order_relaxed);
+}
+
+void Tracer::setCapacity(size_t spans)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ring_.assign(spans > 0 ? spans : 1, SpanRecord());
+    next_ = 0;
+    wrapped_ = false;
+}
+
+uint64_t Tracer::maybeStart(bool force)
+{
+    if (!force) {
+        uint64_t threshold = sampleThreshold_.load(std::memory_order_relaxed);
+        if (threshold == 0 || (threshold != UINT64_MAX && nextRandom() >= threshold)) {
+            return 0;
+        }
+    }
+    uint64_t traceId = 0;
+    while (traceId == 0) {
+        traceId = nextRandom();
+    }
+    return traceId;
+}
+
+void Tracer::record(uint64_t traceId, const char* category, const char* name, int64_t startMicros, int64_t durationMicros)
+{
+    if (traceId == 0) {
+        return;
+    }
+    SpanRecord span;
+    span.traceId = traceId;
+    span.category = category;
+    span.name = name;
+    span.startMicros = startMicros;
+    span.durationMicros = durationMicros;
+    span.tid = muduo::CurrentThread::tid();
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    ring_[next_] = span;
+    if (++next_ == ring_.size()) {
+        next_ = 0;
+        wrapped_ = true;
+    }
+}
+
+std::string Tracer::dumpChromeJson() const
+{
+    std::vector<SpanRecord> spans;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (wrapped_) {
+            spans.assign(ring_.begin() + static_cast<std::ptrdiff_t>(next_), ring_.end());
+        }
+        spans.insert(spans.end(), ring_.begin(), ring_.begin() + static_cast<std::ptrdiff_t>(next_));
+    }
+    
+    // 每个 trace 显示为一个进程，同一条消息的各阶段排在一起
+    std::string json = "{\"traceEvents\":[";
+    char buf[512];
+    bool first = true;
+    for (const SpanRecord& span : spans) {
+        snprintf(buf, sizeof buf,
+                 "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,"
+                 "\"pid\":%u,\"tid\":%d,\"args\":{\"trace\":\"%s\"}}",
+                 first ? "" : ",", span.name, span.category,
+                 static_cast<long long>(span.startMicros), static_cast<long long>(span.durationMicros),
+                 static_cast<unsigned>(span.traceId & 0x7fffffff), span.tid, format(span.traceId).c_str());
+        json += buf;
+        first = false;
+    }
+    json += "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return json;
+}
+
+bool Tracer::dumpToFile(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        LOG_ERROR << "Cannot open trace file " << path;
+        return false;
+    }
+    file << dumpChromeJson();
+    return static_cast<bool>(file);
+}
+
+int64_t Tracer::nowMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string Tracer::format(uint64_t traceId)
+{
+    char buf[17];
+    snprintf(buf, sizeof buf, "%016llx", static_cast<unsigned long long>(traceId));
+    return buf;
+}
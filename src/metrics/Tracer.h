@@ -0,0 +1,97 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "muduo/base/noncopyable.h"
+
+// 采样追踪
+//
+// 收到聊天消息时按采样率决定是否追踪，被追踪的消息分配一个 trace id，
+// 处理过程中各阶段（排队、处理函数、Redis/数据库调用、投递给接收者、写出完成）记录为 span，
+// 保存在固定大小的环形缓冲区中，新的覆盖旧的，可以导出为 Chrome trace-event 格式（chrome://tracing）。
+//
+// 当前线程正在处理的 trace id 保存在线程局部变量中，由 Scope 设置；没有被追踪时记录 span 只需检查一次该变量。
+// span 的类别和名称必须是静态字符串。
+class Tracer : muduo::noncopyable {
+public:
+    struct SpanRecord {
+        uint64_t traceId = 0;
+        const char* category = "";
+        const char* name = "";
+        int64_t startMicros = 0;     // 单调时钟
+        int64_t durationMicros = 0;
+        int tid = 0;
+    };
+
+    // 设置当前线程的 trace id，析构时恢复
+    class Scope : muduo::noncopyable {
+    public:
+        explicit Scope(uint64_t traceId);
+        ~Scope();
+
+    private:
+        uint64_t prev_;
+    };
+
+    // 当前线程处于追踪中时，记录作用域的耗时
+    class Span : muduo::noncopyable {
+    public:
+        Span(const char* category, const char* name);
+        ~Span();
+
+    private:
+        uint64_t traceId_;
+        const char* category_;
+        const char* name_;
+        int64_t start_;
+    };
+
+    static Tracer& getInstance();
+
+    // 采样率（0~1），0 表示只追踪客户端要求追踪的消息
+    void setSampleRate(double rate);
+
+    // 环形缓冲区能容纳的 span 数量，调整时清空已有记录
+    void setCapacity(size_t spans);
+
+    // 为一条新消息决定是否追踪，force 为客户端要求追踪；追踪时返回非零 trace id
+    uint64_t maybeStart(bool force);
+
+    // 当前线程正在处理的 trace id，没有时为0
+    static uint64_t current() { return t_traceId; }
+
+    // 记录一个 span，traceId 为0时忽略
+    void record(uint64_t traceId, const char* category, const char* name, int64_t startMicros, int64_t durationMicros);
+
+    // 导出为 Chrome trace-event JSON
+    std::string dumpChromeJson() const;
+
+    // 导出到文件
+    bool dumpToFile(const std::string& path) const;
+
+    // 单调时钟（微秒）
+    static int64_t nowMicros();
+
+    // trace id 的十六进制表示，用于日志
+    static std::string format(uint64_t traceId);
+
+private:
+    Tracer();
+
+    static thread_local uint64_t t_traceId;
+
+    // 采样阈值，随机数小于该值时追踪
+    std::atomic<uint64_t> sampleThreshold_;
+
+    mutable std::mutex mutex_;
+    std::vector<SpanRecord> ring_;
+    size_t next_ = 0;      // 下一个写入位置
+    bool wrapped_ = false; // 环形缓冲区已写满过
+};
+
+#endif // TRACER_H
@@ -0,0 +1,128 @@
+#include "ConnectionPool.h"
+#include "../metrics/Metrics.h"
+#include "muduo/base/Logging.h"
+
+namespace {
+
+int64_t nowMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+constexpr std::chrono::milliseconds ConnectionPool::kDefaultWaitTimeout;
+
+ConnectionPool::ConnectionPool()
+    : created_(0),
+      initialized_(false),
+      poolSize_(kDefaultPoolSize),
+      waitTimeout_(kDefaultWaitTimeout)
+{
+    MetricsRegistry::getInstance().addCollector([this](PrometheusWriter& writer) {
+        collectMetrics(writer);
+    });
+}
+void ConnectionPool::init(const std::string& conninfo, int poolSize, std::chrono::milliseconds waitTimeout)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (poolSize <= 0) {
+        LOG_WARN << "Invalid database pool size " << poolSize << ", using " << kDefaultPoolSize;
+        poolSize = kDefaultPoolSize;
+    }
+    conninfo_ = conninfo;
+    initialized_ = true;
+    poolSize_ = poolSize;
+    waitTimeout_ = waitTimeout;
+
+    // 丢弃按旧配置创建的空闲连接
+    created_ -= static_cast<int>(idle_.size());
+    idle_.clear();
+}
+
+ConnectionPool::Handle ConnectionPool::acquire()
+{
+    std::string conninfo;
+    int64_t start = nowMicros();
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!initialized_) {
+            LOG_ERROR << "Database connection pool used before init()";
+            return Handle(nullptr, Releaser{this, 0});
+        }
+        bool ready = available_.wait_for(lock, waitTimeout_, [this]() {
+            return !idle_.empty() || created_ < poolSize_;
+        });
+        int64_t acquired = nowMicros();
+        waitLatency_.record(static_cast<uint64_t>(acquired - start));
+        if (!ready) {
+            timeouts_.fetch_add(1, std::memory_order_relaxed);
+            LOG_ERROR << "Timed out waiting for a database connection, pool size " << poolSize_;
+            return Handle(nullptr, Releaser{this, 0});
+        }
+
+        if (!idle_.empty()) {
+            pqxx::connection* conn = idle_.back().release();
+            idle_.pop_back();
+            return Handle(conn, Releaser{this, acquired});
+        }
+
+        // 先占用名额，在锁外建立连接
+        ++created_;
+        conninfo = conninfo_;
+    }
+
+    try {
+        auto conn = std::make_unique<pqxx::connection>(conninfo);
+        return Handle(conn.release(), Releaser{this, nowMicros()});
+    } catch (const std::exception& e) {
+        LOG_ERROR << "Failed to get database connection: " << e.what();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --created_;
+        }
+        available_.notify_one();
+        return Handle(nullptr, Releaser{this, 0});
+    }
+}
+
+void ConnectionPool::release(pqxx::connection* conn, int64_t acquiredMicros)
+{
+    holdLatency_.record(static_cast<uint64_t>(nowMicros() - acquiredMicros));
+    std::unique_ptr<pqxx::connection> owned(conn);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (owned->is_open()) {
+            idle_.push_back(std::move(owned));
+        } else {
+            --created_;
+        }
+    }
+    available_.notify_one();
+}
+
+void ConnectionPool::collectMetrics(PrometheusWriter& writer)
+{
+    int created = 0;
+    size_t idle = 0;
+    int poolSize = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        created = created_;
+        idle = idle_.size();
+        poolSize = poolSize_;
+    }
+    
+    writer.family("chat_db_pool_size", "gauge", "Maximum number of PostgreSQL connections");
+    writer.sample("chat_db_pool_size", "", poolSize);
+    writer.family("chat_db_pool_connections", "gauge", "PostgreSQL connections by state");
+    writer.sample("chat_db_pool_connections", "state=\"idle\"", static_cast<double>(idle));
+    writer.sample("chat_db_pool_connections", "state=\"in_use\"", static_cast<double>(created) - static_cast<double>(idle));
+    writer.family("chat_db_pool_timeouts_total", "counter", "Requests that timed out waiting for a PostgreSQL connection");
+    writer.sample("chat_db_pool_timeouts_total", "", static_cast<double>(timeouts_.load(std::memory_order_relaxed)));
+    writer.family("chat_db_pool_wait_seconds", "histogram", "Time spent waiting for a PostgreSQL connection");
+    writer.histogram("chat_db_pool_wait_seconds", "", waitLatency_.snapshot(), 1e-6);
+    writer.family("chat_db_connection_hold_seconds", "histogram", "Time a PostgreSQL connection is held per borrow, i.e. query latency");
+    writer.histogram("chat_db_connection_hold_seconds", "", holdLatency_.snapshot(), 1e-6);
+}
@@ -0,0 +1,78 @@
+#ifndef CONNECTION_POOL_H
+#define CONNECTION_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <pqxx/pqxx>
+#include "../metrics/Histogram.h"
+
+class PrometheusWriter;
+
+// PostgreSQL连接池 - UserModel 和 MessageArchiveService 共用
+//
+// 连接信息只能通过 init 设置，之前获取连接总是失败。
+// 连接在第一次需要时创建，最多 poolSize 个；借出的连接归还后复用，
+// 连接断开的不再放回池中，下次按需重新创建。
+class ConnectionPool {
+public:
+    // 归还连接的删除器
+    struct Releaser {
+        ConnectionPool* pool;
+        int64_t acquiredMicros;  // 借出时间，用于统计占用时长
+        void operator()(pqxx::connection* conn) const { pool->release(conn, acquiredMicros); }
+    };
+
+    // 借出的连接，析构时自动归还；获取失败时为空
+    using Handle = std::unique_ptr<pqxx::connection, Releaser>;
+
+
+    static constexpr int kDefaultPoolSize = 4;
+    static constexpr std::chrono::milliseconds kDefaultWaitTimeout{5000};
+
+    static ConnectionPool& getInstance() {
+        static ConnectionPool instance;
+        return instance;
+    }
+
+    // 设置连接信息和池大小，需在第一次获取连接前调用
+    void init(const std::string& conninfo, int poolSize = kDefaultPoolSize,
+              std::chrono::milliseconds waitTimeout = kDefaultWaitTimeout);
+
+    // 获取连接，池已满时最多等待 waitTimeout
+    Handle acquire();
+
+    int poolSize() const { return poolSize_; }
+
+private:
+    ConnectionPool();
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    void release(pqxx::connection* conn, int64_t acquiredMicros);
+    
+    // 输出连接池指标
+    void collectMetrics(PrometheusWriter& writer);
+
+    std::mutex mutex_;
+    std::condition_variable available_;
+    std::vector<std::unique_ptr<pqxx::connection>> idle_;  // 空闲连接
+    int created_;                                          // 已创建（含借出）的连接数量
+    std::string conninfo_;
+    bool initialized_;                                     // 已调用 init
+    int poolSize_;
+    std::chrono::milliseconds waitTimeout_;
+    
+    // 等待空闲连接的时间、连接被借出的时长（微秒）和等待超时次数
+    Histogram waitLatency_;
+    Histogram holdLatency_;
+    std::atomic<uint64_t> timeouts_{0};
+};
+
+#endif // CONNECTION_POOL_H
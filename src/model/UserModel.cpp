@@ -1,4 +1,5 @@
 #include "UserModel.h"
+#include "../metrics/Metrics.h"
 #include <iostream>
 #include <sstream>
 #include <cstring>
@@ -8,31 +9,24 @@
 #include "muduo/base/Timestamp.h"
 
 UserModel::UserModel() {
-    // 初始化PostgreSQL连接信息
-    conninfo_ = "host=localhost port=5432 dbname=chat_server user=sqhh99 password=2932897504xu";
-    
-    if (!init()) {
-        LOG_ERROR << "Failed to initialize database connection";
-    } else {
-        LOG_INFO << "Database connection initialized successfully";
-    }
+    // 连接在第一次查询时由连接池建立
 }
 
 UserModel::~UserModel() {
-    // 连接会在使用unique_ptr后自动关闭
+    // 连接由连接池管理
 }
 
-bool UserModel::init() {
-    std::lock_guard<std::mutex> lock(mutex_);
+bool UserModel::init(const std::string& conninfo, int poolSize) {
+    ConnectionPool::getInstance().init(conninfo, poolSize);
     
     try {
         // 测试连接是否有效
-        auto conn = std::make_unique<pqxx::connection>(conninfo_);
-        if (!conn->is_open()) {
+        auto conn = getConnection();
+        if (!conn || !conn->is_open()) {
             LOG_ERROR << "Failed to connect to PostgreSQL database";
             return false;
         }
-        LOG_INFO << "PostgreSQL connection established";
+        LOG_INFO << "PostgreSQL connection established, pool size " << poolSize;
         return true;
     } catch (const std::exception& e) {
         LOG_ERROR << "PostgreSQL connection error: " << e.what();
@@ -40,19 +34,12 @@ bool UserModel::init() {
     }
 }
 
-std::unique_ptr<pqxx::connection> UserModel::getConnection() {
-    try {
-        auto conn = std::make_unique<pqxx::connection>(conninfo_);
-        return conn;
-    } catch (const std::exception& e) {
-        LOG_ERROR << "Failed to get database connection: " << e.what();
-        return nullptr;
-    }
+ConnectionPool::Handle UserModel::getConnection() {
+    return ConnectionPool::getInstance().acquire();
 }
 
 bool UserModel::verifyLogin(const std::string& username, const std::string& password) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
+    METRICS_LATENCY_SCOPE("user_model", "verifyLogin");
     try {
         auto conn = getConnection();
         if (!conn) {
@@ -96,8 +83,7 @@ bool UserModel::verifyLogin(const std::string& username, const std::string& pass
 }
 
 std::shared_ptr<User> UserModel::getUserByName(const std::string& username) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
+    METRICS_LATENCY_SCOPE("user_model", "getUserByName");
     try {
         auto conn = getConnection();
         if (!conn) {
@@ -159,8 +145,7 @@ std::shared_ptr<User> UserModel::getUserByName(const std::string& username) {
 }
 
 std::shared_ptr<User> UserModel::getUserById(int userId) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
+    METRICS_LATENCY_SCOPE("user_model", "getUserById");
     try {
         auto conn = getConnection();
         if (!conn) {
@@ -222,8 +207,7 @@ std::shared_ptr<User> UserModel::getUserById(int userId) {
 }
 
 bool UserModel::updateUserOnlineState(int userId, bool online) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
+    METRICS_LATENCY_SCOPE("user_model", "updateUserOnlineState");
     try {
         auto conn = getConnection();
         if (!conn) {
@@ -252,8 +236,7 @@ bool UserModel::updateUserOnlineState(int userId, bool online) {
 }
 
 bool UserModel::updateUserLoginTime(int userId) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
+    METRICS_LATENCY_SCOPE("user_model", "updateUserLoginTime");
     try {
         auto conn = getConnection();
         if (!conn) {
@@ -279,10 +262,49 @@ bool UserModel::updateUserLoginTime(int userId) {
     }
 }
 
+std::unordered_map<int, std::string> UserModel::getUsernamesByIds(const std::vector<int>& userIds) {
+    METRICS_LATENCY_SCOPE("user_model", "getUsernamesByIds");
+    std::unordered_map<int, std::string> usernames;
+    if (userIds.empty()) {
+        return usernames;
+    }
+    
+    try {
+        auto conn = getConnection();
+        if (!conn) {
+            LOG_ERROR << "Failed to get database connection";
+            return usernames;
+        }
+        
+        // 开始事务
+        pqxx::work txn(*conn);
+        
+        // 一次查询所有用户，ID均为整数，可以直接拼接
+        std::string sql = "SELECT id, username FROM users WHERE id IN (";
+        for (size_t i = 0; i < userIds.size(); ++i) {
+            if (i > 0) {
+                sql += ",";
+            }
+            sql += std::to_string(userIds[i]);
+        }
+        sql += ")";
+        
+        pqxx::result result = txn.exec(sql);
+        
+        for (const auto& row : result) {
+            usernames.emplace(row[0].as<int>(), row[1].as<std::string>());
+        }
+        
+        return usernames;
+    } catch (const std::exception& e) {
+        LOG_ERROR << "Get usernames by IDs failed: " << e.what();
+        return usernames;
+    }
+}
+
 std::vector<std::shared_ptr<User>> UserModel::getOnlineUsers() {
+    METRICS_LATENCY_SCOPE("user_model", "getOnlineUsers");
     std::vector<std::shared_ptr<User>> users;
-    std::lock_guard<std::mutex> lock(mutex_);
-    
     try {
         auto conn = getConnection();
         if (!conn) {
@@ -326,6 +348,7 @@ std::vector<std::shared_ptr<User>> UserModel::getOnlineUsers() {
 // 新增用户注册功能
 bool UserModel::registerUser(const std::string& username, const std::string& password, 
                             const std::string& email, const std::string& avatar) {
+    METRICS_LATENCY_SCOPE("user_model", "registerUser");
     try {
         // 先检查用户名和邮箱是否已存在
         if (isUserExists(username)) {
@@ -375,6 +398,7 @@ bool UserModel::registerUser(const std::string& username, const std::string& pas
 
 // 检查用户名是否已存在
 bool UserModel::isUserExists(const std::string& username) {
+    METRICS_LATENCY_SCOPE("user_model", "isUserExists");
     try {
         auto conn = getConnection();
         if (!conn) {
@@ -397,6 +421,7 @@ bool UserModel::isUserExists(const std::string& username) {
 
 // 检查邮箱是否已存在
 bool UserModel::isEmailExists(const std::string& email) {
+    METRICS_LATENCY_SCOPE("user_model", "isEmailExists");
     try {
         auto conn = getConnection();
         if (!conn) {
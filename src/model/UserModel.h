@@ -4,12 +4,14 @@
 #include "User.h"
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include <memory>
-#include <mutex>
 #include <pqxx/pqxx>
 #include "muduo/base/Logging.h"
+#include "ConnectionPool.h"
 
 // 用户数据访问模型 - 连接PostgreSQL数据库
+// 查询通过连接池并发执行，不再串行化
 class UserModel {
 public:
     static UserModel& getInstance() {
@@ -18,6 +20,9 @@ public:
     }
     
     ~UserModel();
+    
+    // 设置数据库连接信息和连接池大小，并测试连接
+    bool init(const std::string& conninfo, int poolSize = ConnectionPool::kDefaultPoolSize);
 
     // 验证用户登录并更新状态
     bool verifyLogin(const std::string& username, const std::string& password);
@@ -38,6 +43,9 @@ public:
     // 根据ID获取用户信息
     std::shared_ptr<User> getUserById(int userId);
     
+    // 批量查询用户名，返回 用户ID -> 用户名，不存在的用户不在结果中
+    std::unordered_map<int, std::string> getUsernamesByIds(const std::vector<int>& userIds);
+    
     // 更新用户在线状态
     bool updateUserOnlineState(int userId, bool online);
     
@@ -50,15 +58,8 @@ public:
 private:
     UserModel(); // 私有构造函数
     
-    // 初始化数据库连接
-    bool init();
-    
-    // 获取数据库连接
-    std::unique_ptr<pqxx::connection> getConnection();
-    
-private:
-    std::string conninfo_; // 连接信息
-    std::mutex mutex_;     // 保护共享数据
+    // 从连接池借出数据库连接，析构时归还
+    ConnectionPool::Handle getConnection();
 };
 
 #endif // USER_MODEL_H
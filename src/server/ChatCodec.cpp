@@ -0,0 +1,472 @@
+#include "ChatCodec.h"
+#include "Session.h"
+#include "Request.h"
+#include "Compressor.h"
+#include "../wire/WireFormat.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/Endian.h"
+#include "muduo/net/EventLoop.h"
+#include <chrono>
+#include <cstring>
+#include <string>
+
+namespace {
+
+// 每个I/O线程复用一个压缩器，压缩总是在连接所属线程中进行
+Compressor& loopCompressor()
+{
+    thread_local Compressor compressor;
+    return compressor;
+}
+
+} // namespace
+
+ChatCodec::ChatCodec(const FrameCallback& cb, size_t maxFrameSize)
+    : frameCallback_(cb),
+      maxFrameSize_(kDefaultMaxFrameSize),
+      coalescing_(false),
+      compressionThreshold_(kDefaultCompressionThreshold)
+{
+    setMaxFrameSize(maxFrameSize);
+}
+
+void ChatCodec::setMaxFrameSize(size_t maxFrameSize)
+{
+    // 二进制帧依赖长度字段首字节为0来区分文本协议
+    if (maxFrameSize == 0 || maxFrameSize > kMaxFrameSizeLimit) {
+        LOG_WARN << "Invalid max frame size " << maxFrameSize << ", clamped to " << kMaxFrameSizeLimit;
+        maxFrameSize = kMaxFrameSizeLimit;
+    }
+    maxFrameSize_ = maxFrameSize;
+}
+
+void ChatCodec::onMessage(const muduo::net::TcpConnectionPtr& conn,
+                          muduo::net::Buffer* buf,
+                          muduo::Timestamp receiveTime)
+{
+    Session* session = getSession(conn);
+    Mode mode = session ? session->mode : Mode::UNKNOWN;
+
+    // 根据第一个字节协商协议模式
+    if (mode == Mode::UNKNOWN) {
+        if (buf->readableBytes() == 0) {
+            return;
+        }
+        char first = *buf->peek();
+        mode = (first >= '0' && first <= '9') ? Mode::LEGACY_TEXT : Mode::BINARY;
+        if (session) {
+            session->mode = mode;
+        }
+        LOG_DEBUG << "Connection " << conn->name() << " uses "
+                  << (mode == Mode::BINARY ? "binary" : "legacy text") << " protocol";
+    }
+
+    if (mode == Mode::BINARY) {
+        decodeBinary(conn, buf, receiveTime);
+    } else {
+        decodeLegacyText(conn, buf, receiveTime);
+    }
+}
+
+void ChatCodec::decodeBinary(const muduo::net::TcpConnectionPtr& conn,
+                             muduo::net::Buffer* buf,
+                             muduo::Timestamp receiveTime)
+{
+    // 一次读事件中可能包含多帧，也可能只有半帧
+    while (buf->readableBytes() >= kHeaderLen && conn->connected()) {
+        const size_t length = static_cast<uint32_t>(buf->peekInt32());
+        if (length > maxFrameSize_) {
+            rejectOversizedFrame(conn, length);
+            buf->retrieveAll();
+            break;
+        }
+
+        // 帧不完整，等待更多数据
+        if (buf->readableBytes() < kHeaderLen + length) {
+            break;
+        }
+
+        const char* data = buf->peek();
+        uint16_t type = 0;
+        uint16_t flags = 0;
+        ::memcpy(&type, data + sizeof(int32_t), sizeof type);
+        ::memcpy(&flags, data + sizeof(int32_t) + sizeof(int16_t), sizeof flags);
+
+        Frame frame;
+        frame.type = muduo::net::sockets::networkToHost16(type);
+        frame.flags = muduo::net::sockets::networkToHost16(flags);
+        frame.payload = muduo::StringPiece(data + kHeaderLen, static_cast<int>(length));
+
+        // 压缩只用于服务器发出的帧，客户端的请求不应压缩
+        if (frame.flags & kFlagCompressed) {
+            LOG_ERROR << "Compressed request from " << conn->peerAddress().toIpPort();
+            frame.type = -1;
+        }
+
+        // 回调期间payload直接引用缓冲区，处理完成后再移动读指针
+        frameCallback_(conn, frame, receiveTime);
+        buf->retrieve(kHeaderLen + length);
+    }
+}
+
+void ChatCodec::decodeLegacyText(const muduo::net::TcpConnectionPtr& conn,
+                                 muduo::net::Buffer* buf,
+                                 muduo::Timestamp receiveTime)
+{
+    while (buf->readableBytes() > 0 && conn->connected()) {
+        const char* eol = buf->findEOL();
+        size_t length = eol ? static_cast<size_t>(eol - buf->peek()) : buf->readableBytes();
+        if (length > maxFrameSize_) {
+            rejectOversizedFrame(conn, length);
+            buf->retrieveAll();
+            break;
+        }
+
+        muduo::StringPiece line(buf->peek(), static_cast<int>(length));
+        if (line.size() > 0 && line[line.size() - 1] == '\r') {
+            line.remove_suffix(1);
+        }
+
+        if (!line.empty()) {
+            frameCallback_(conn, splitTextMessage(line), receiveTime);
+        }
+        buf->retrieve(eol ? length + 1 : length);
+    }
+}
+
+void ChatCodec::rejectOversizedFrame(const muduo::net::TcpConnectionPtr& conn, size_t length) const
+{
+    LOG_ERROR << "Frame too large from " << conn->peerAddress().toIpPort()
+              << ": " << length << " bytes, limit " << maxFrameSize_;
+    
+    // 关闭前写出合并模式下尚未发送的数据
+    flush(conn);
+    conn->shutdown();
+}
+
+ChatCodec::Frame ChatCodec::splitTextMessage(const muduo::StringPiece& message)
+{
+    Frame frame;
+    frame.type = -1;
+    frame.flags = 0;
+
+    const char* begin = message.data();
+    const char* end = begin + message.size();
+    const char* colon = static_cast<const char*>(::memchr(begin, ':', message.size()));
+    const char* typeEnd = colon ? colon : end;
+
+    // 消息类型必须是1到5位数字
+    if (typeEnd == begin || typeEnd - begin > 5) {
+        return frame;
+    }
+    int type = 0;
+    for (const char* p = begin; p != typeEnd; ++p) {
+        if (*p < '0' || *p > '9') {
+            return frame;
+        }
+        type = type * 10 + (*p - '0');
+    }
+
+    frame.type = type;
+    if (colon) {
+        frame.payload = muduo::StringPiece(colon + 1, static_cast<int>(end - colon - 1));
+    }
+    return frame;
+}
+
+void ChatCodec::send(const muduo::net::TcpConnectionPtr& conn, const muduo::StringPiece& message) const
+{
+    // 对带 rid 的请求的响应回显 rid
+    std::string_view rid = RequestScope::ridFor(conn.get());
+    if (rid.empty()) {
+        sendMessage(conn, message);
+        return;
+    }
+    
+    std::string tagged = message.as_string();
+    size_t colon = tagged.find(':');
+    if (colon == std::string::npos) {
+        tagged += ':';
+    } else if (colon + 1 != tagged.size()) {
+        tagged += ';';
+    }
+    tagged += "rid=";
+    tagged.append(rid.data(), rid.size());
+    sendMessage(conn, tagged);
+}
+
+void ChatCodec::send(const muduo::net::TcpConnectionPtr& conn, int type,
+                     const muduo::StringPiece& payload, uint16_t flags) const
+{
+    std::string_view rid = RequestScope::ridFor(conn.get());
+    if (rid.empty()) {
+        sendFrame(conn, type, payload, flags);
+        return;
+    }
+    
+    // 二进制消息的 rid 追加为保留字段，字段顺序不影响解码
+    std::string tagged = payload.as_string();
+    if (flags & kFlagWire) {
+        wire::putStringField(&tagged, wire::kRidField, rid);
+        sendFrame(conn, type, tagged, flags);
+        return;
+    }
+    
+    if (!tagged.empty()) {
+        tagged += ';';
+    }
+    tagged += "rid=";
+    tagged.append(rid.data(), rid.size());
+    sendFrame(conn, type, tagged, flags);
+}
+
+void ChatCodec::sendMessage(const muduo::net::TcpConnectionPtr& conn, const muduo::StringPiece& message) const
+{
+    // 工作线程中的回复转到连接所属的EventLoop中编码发送
+    muduo::net::EventLoop* loop = conn->getLoop();
+    if (!loop->isInLoopThread()) {
+        loop->queueInLoop([this, conn, copy = message.as_string()]() { sendMessage(conn, copy); });
+        return;
+    }
+    
+    Session* session = getSession(conn);
+    if (!session || session->mode != Mode::BINARY) {
+        write(conn, session, muduo::StringPiece(), message);
+        return;
+    }
+
+    Frame frame = splitTextMessage(message);
+    if (frame.type < 0) {
+        LOG_ERROR << "Cannot encode malformed message: " << message.as_string();
+        return;
+    }
+    sendFrame(conn, frame.type, frame.payload, 0);
+}
+
+void ChatCodec::sendFrame(const muduo::net::TcpConnectionPtr& conn, int type,
+                          const muduo::StringPiece& payload, uint16_t flags) const
+{
+    muduo::net::EventLoop* loop = conn->getLoop();
+    if (!loop->isInLoopThread()) {
+        loop->queueInLoop([this, conn, type, copy = payload.as_string(), flags]() {
+            sendFrame(conn, type, copy, flags);
+        });
+        return;
+    }
+    
+    Session* session = getSession(conn);
+    if (!session || session->mode != Mode::BINARY) {
+        if (flags & kFlagWire) {
+            LOG_ERROR << "Cannot send binary message type " << type << " to text connection "
+                      << conn->peerAddress().toIpPort();
+            return;
+        }
+        std::string prefix = std::to_string(type);
+        prefix += ':';
+        write(conn, session, prefix, payload);
+        return;
+    }
+
+    // 启用二进制消息的连接把键值对转换为 Fields 消息
+    std::string fields;
+    muduo::StringPiece body = payload;
+    if (!(flags & kFlagWire) && session->wireFormat.load(std::memory_order_relaxed)) {
+        encodeFields(payload, &fields);
+        body = fields;
+        flags |= kFlagWire;
+    }
+    maybeCompress(session, type, &body, &flags);
+
+    char header[kHeaderLen];
+    makeHeader(header, body.size(), type, flags);
+    write(conn, session, muduo::StringPiece(header, static_cast<int>(kHeaderLen)), body);
+}
+
+void ChatCodec::send(const muduo::net::TcpConnectionPtr& conn, const EncodedMessage& message) const
+{
+    conn->getLoop()->assertInLoopThread();
+    
+    Session* session = getSession(conn);
+    if (!session || session->mode != Mode::BINARY) {
+        write(conn, session, muduo::StringPiece(), message.text);
+        return;
+    }
+    
+    if (message.binary.empty()) {
+        LOG_ERROR << "Cannot encode malformed message: " << message.text;
+        return;
+    }
+    const std::string& frame = session->wireFormat.load(std::memory_order_relaxed) ? message.wire : message.binary;
+    write(conn, session, muduo::StringPiece(), frame);
+}
+
+void ChatCodec::flush(const muduo::net::TcpConnectionPtr& conn) const
+{
+    Session* session = getSession(conn);
+    if (!session || session->pendingOutput.readableBytes() == 0) {
+        return;
+    }
+    
+    muduo::net::Buffer& pending = session->pendingOutput;
+    flushes_.fetch_add(1, std::memory_order_relaxed);
+    writeNow(conn, muduo::StringPiece(pending.peek(), static_cast<int>(pending.readableBytes())));
+    pending.retrieveAll();
+}
+
+void ChatCodec::maybeCompress(Session* session, int type, muduo::StringPiece* body, uint16_t* flags) const
+{
+    if (static_cast<size_t>(body->size()) < compressionThreshold_ ||
+        session->compression.load(std::memory_order_relaxed) != Compression::DEFLATE) {
+        return;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    Compressor& compressor = loopCompressor();
+    bool smaller = compressor.compress(*body);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    
+    CompressionCounters& counters = compressionCounters_[type >= 0 && type < kMaxStatsType ? type : kMaxStatsType];
+    counters.bytesIn.fetch_add(body->size(), std::memory_order_relaxed);
+    counters.cpuNanos.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+                                std::memory_order_relaxed);
+    if (!smaller) {
+        counters.incompressible.fetch_add(1, std::memory_order_relaxed);
+        counters.bytesOut.fetch_add(body->size(), std::memory_order_relaxed);
+        return;
+    }
+    
+    *body = compressor.output();
+    *flags |= kFlagCompressed;
+    counters.compressed.fetch_add(1, std::memory_order_relaxed);
+    counters.bytesOut.fetch_add(body->size(), std::memory_order_relaxed);
+}
+
+ChatCodec::CompressionStats ChatCodec::compressionStats(int type) const
+{
+    CompressionStats stats;
+    if (type < 0 || type > kMaxStatsType) {
+        return stats;
+    }
+    const CompressionCounters& counters = compressionCounters_[type];
+    stats.compressed = counters.compressed.load(std::memory_order_relaxed);
+    stats.incompressible = counters.incompressible.load(std::memory_order_relaxed);
+    stats.bytesIn = counters.bytesIn.load(std::memory_order_relaxed);
+    stats.bytesOut = counters.bytesOut.load(std::memory_order_relaxed);
+    stats.cpuNanos = counters.cpuNanos.load(std::memory_order_relaxed);
+    return stats;
+}
+
+ChatCodec::WriteStats ChatCodec::writeStats() const
+{
+    WriteStats stats;
+    stats.sends = sends_.load(std::memory_order_relaxed);
+    stats.flushes = flushes_.load(std::memory_order_relaxed);
+    stats.writes = writes_.load(std::memory_order_relaxed);
+    stats.bytes = bytes_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void ChatCodec::write(const muduo::net::TcpConnectionPtr& conn, Session* session,
+                      const muduo::StringPiece& header, const muduo::StringPiece& body) const
+{
+    sends_.fetch_add(1, std::memory_order_relaxed);
+    bytes_.fetch_add(header.size() + body.size(), std::memory_order_relaxed);
+    
+    // 合并模式下先追加到会话的待发送缓冲区，本轮事件处理结束时一次写出
+    if (coalescing_ && session) {
+        muduo::net::Buffer& pending = session->pendingOutput;
+        bool flushScheduled = pending.readableBytes() > 0;
+        pending.append(header.data(), header.size());
+        pending.append(body.data(), body.size());
+        if (!flushScheduled) {
+            conn->getLoop()->queueInLoop(std::bind(&ChatCodec::flush, this, conn));
+        }
+        return;
+    }
+    
+    if (header.empty()) {
+        writeNow(conn, body);
+        return;
+    }
+    
+    muduo::net::Buffer buf;
+    buf.append(header.data(), header.size());
+    buf.append(body.data(), body.size());
+    writeNow(conn, muduo::StringPiece(buf.peek(), static_cast<int>(buf.readableBytes())));
+}
+
+void ChatCodec::writeNow(const muduo::net::TcpConnectionPtr& conn, const muduo::StringPiece& data) const
+{
+    // 输出缓冲区为空时TcpConnection会立即调用write(2)，否则追加到缓冲区等待可写事件
+    if (conn->outputBuffer()->readableBytes() == 0) {
+        writes_.fetch_add(1, std::memory_order_relaxed);
+    }
+    conn->send(data);
+}
+
+ChatCodec::EncodedMessagePtr ChatCodec::encode(const muduo::StringPiece& message)
+{
+    auto encoded = std::make_shared<EncodedMessage>();
+    encoded->text = message.as_string();
+    
+    Frame frame = splitTextMessage(message);
+    if (frame.type >= 0) {
+        char header[kHeaderLen];
+        makeHeader(header, frame.payload.size(), frame.type, 0);
+        
+        std::string& binary = encoded->binary;
+        binary.reserve(kHeaderLen + frame.payload.size());
+        binary.append(header, kHeaderLen);
+        binary.append(frame.payload.data(), frame.payload.size());
+        
+        // 消息体长度确定后再填写帧头
+        std::string fields;
+        encodeFields(frame.payload, &fields);
+        makeHeader(header, fields.size(), frame.type, kFlagWire);
+        std::string& wireFrame = encoded->wire;
+        wireFrame.reserve(kHeaderLen + fields.size());
+        wireFrame.append(header, kHeaderLen);
+        wireFrame.append(fields);
+    }
+    return encoded;
+}
+
+void ChatCodec::encodeFields(const muduo::StringPiece& payload, std::string* out)
+{
+    // Fields { repeated Field fields = 1; string rid = 15; }
+    // Field  { string key = 1; string value = 2; }
+    const char* p = payload.data();
+    const char* end = p + payload.size();
+    while (p < end) {
+        const char* sep = static_cast<const char*>(::memchr(p, ';', end - p));
+        const char* fieldEnd = sep ? sep : end;
+        const char* eq = static_cast<const char*>(::memchr(p, '=', fieldEnd - p));
+        if (eq && eq != p) {
+            std::string_view key(p, eq - p);
+            std::string_view value(eq + 1, fieldEnd - eq - 1);
+            if (key == "rid") {
+                wire::putStringField(out, wire::kRidField, value);
+            } else {
+                size_t length = wire::lengthDelimitedSize(1, key.size()) +
+                                (value.empty() ? 0 : wire::lengthDelimitedSize(2, value.size()));
+                wire::putTag(out, 1, wire::LENGTH_DELIMITED);
+                wire::putVarint(out, length);
+                wire::putStringField(out, 1, key);
+                if (!value.empty()) {
+                    wire::putStringField(out, 2, value);
+                }
+            }
+        }
+        p = fieldEnd + 1;
+    }
+}
+
+void ChatCodec::makeHeader(char* header, size_t length, int type, uint16_t flags)
+{
+    uint32_t netLength = muduo::net::sockets::hostToNetwork32(static_cast<uint32_t>(length));
+    uint16_t netType = muduo::net::sockets::hostToNetwork16(static_cast<uint16_t>(type));
+    uint16_t netFlags = muduo::net::sockets::hostToNetwork16(flags);
+    ::memcpy(header, &netLength, sizeof netLength);
+    ::memcpy(header + sizeof netLength, &netType, sizeof netType);
+    ::memcpy(header + sizeof netLength + sizeof netType, &netFlags, sizeof netFlags);
+}
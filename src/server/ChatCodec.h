@@ -0,0 +1,204 @@
+#ifndef CHAT_CODEC_H
+#define CHAT_CODEC_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include "muduo/base/noncopyable.h"
+#include "muduo/base/StringPiece.h"
+#include "muduo/base/Timestamp.h"
+#include "muduo/net/Buffer.h"
+#include "muduo/net/TcpConnection.h"
+
+// 消息帧编解码器
+//
+// 二进制帧格式（网络字节序）:
+//   | length (4) | type (2) | flags (2) | payload (length) |
+// length 只计算 payload 长度，payload 默认为 key1=value1;key2=value2;... 格式，
+// flags 中 kFlagWire 置位时为 src/wire/Messages.schema 定义的二进制消息，
+// kFlagCompressed 置位时 payload 经过压缩（登录时协商，只用于服务器发出的较大的帧）。
+//
+// 旧版文本协议（msgType:key1=value1;...）作为兼容模式保留：
+// 连接收到的第一个字节为数字时判定为文本模式，否则为二进制模式。
+// 由于最大帧长度小于 16MB，二进制帧的第一个字节恒为 0，两者不会混淆。
+// 文本模式下以换行符分隔消息，末尾没有换行符的剩余数据视为一条完整消息（与旧行为一致）。
+struct Session;
+
+class ChatCodec : muduo::noncopyable {
+public:
+    // 连接使用的协议模式
+    enum class Mode {
+        UNKNOWN,      // 尚未收到数据
+        BINARY,       // 长度前缀二进制帧
+        LEGACY_TEXT   // 旧版文本协议
+    };
+
+    // 连接协商的压缩算法
+    enum class Compression : uint8_t {
+        NONE,
+        DEFLATE   // raw deflate，见 Compressor
+    };
+
+    // 解码后的一帧，payload 直接指向输入缓冲区，仅在回调期间有效
+    struct Frame {
+        int type;                    // 消息类型，格式错误时为 -1
+        uint16_t flags;              // 帧标志位
+        muduo::StringPiece payload;  // 消息内容
+    };
+
+    // 预先编码的消息，群发时所有连接共享同一份只读数据
+    struct EncodedMessage {
+        std::string text;    // 旧版文本协议格式
+        std::string binary;  // 二进制帧，消息格式错误时为空
+        std::string wire;    // payload 为二进制消息的帧，消息格式错误时为空
+    };
+    using EncodedMessagePtr = std::shared_ptr<const EncodedMessage>;
+
+    // 发送统计
+    struct WriteStats {
+        uint64_t sends = 0;    // send调用次数
+        uint64_t flushes = 0;  // 合并模式下的批量写出次数
+        uint64_t writes = 0;   // 输出缓冲区为空时直接调用write(2)的次数
+        uint64_t bytes = 0;    // 发送的字节数
+    };
+
+    // 单个消息类型的压缩统计
+    struct CompressionStats {
+        uint64_t compressed = 0;      // 压缩后发送的帧数
+        uint64_t incompressible = 0;  // 压缩后没有变小、按原样发送的帧数
+        uint64_t bytesIn = 0;         // 压缩前字节数（含没有变小的帧）
+        uint64_t bytesOut = 0;        // 实际发送的 payload 字节数
+        uint64_t cpuNanos = 0;        // 压缩耗时
+    };
+
+    using FrameCallback = std::function<void(const muduo::net::TcpConnectionPtr&,
+                                             const Frame&,
+                                             muduo::Timestamp)>;
+
+    static constexpr size_t kHeaderLen = 8;
+    
+    // 帧标志位：payload 为二进制消息（见 src/wire/Messages.schema）
+    static constexpr uint16_t kFlagWire = 0x0001;
+    // 帧标志位：payload 经过压缩，解压后再按 kFlagWire 解析
+    static constexpr uint16_t kFlagCompressed = 0x0002;
+    
+    // payload 达到该长度才压缩，普通聊天消息不压缩
+    static constexpr size_t kDefaultCompressionThreshold = 1024;
+    
+    // 按消息类型统计压缩效果，更大的类型计入最后一项
+    static constexpr int kMaxStatsType = 63;
+
+    static constexpr size_t kDefaultMaxFrameSize = 4 * 1024 * 1024;  // 4MB
+    static constexpr size_t kMaxFrameSizeLimit = 16 * 1024 * 1024 - 1;
+
+    explicit ChatCodec(const FrameCallback& cb, size_t maxFrameSize = kDefaultMaxFrameSize);
+
+    // 设置最大帧长度
+    void setMaxFrameSize(size_t maxFrameSize);
+    size_t maxFrameSize() const { return maxFrameSize_; }
+
+    // 开启写合并：同一轮事件处理中对一个连接的多次发送追加到会话的待发送缓冲区，
+    // 在本轮结束时（EventLoop执行pendingFunctors时）一次写出。需在服务器启动前设置
+    void setCoalescing(bool on) { coalescing_ = on; }
+    bool coalescing() const { return coalescing_; }
+
+    // 设置压缩阈值，需在服务器启动前设置
+    void setCompressionThreshold(size_t threshold) { compressionThreshold_ = threshold; }
+    size_t compressionThreshold() const { return compressionThreshold_; }
+
+    // 获取某个消息类型的压缩统计
+    CompressionStats compressionStats(int type) const;
+
+    // 立即写出连接待发送的合并数据，必须在连接所属线程中调用
+    void flush(const muduo::net::TcpConnectionPtr& conn) const;
+
+    // 获取发送统计
+    WriteStats writeStats() const;
+
+    // 作为 TcpServer 的消息回调，每次读事件提取所有完整的帧
+    void onMessage(const muduo::net::TcpConnectionPtr& conn,
+                   muduo::net::Buffer* buf,
+                   muduo::Timestamp receiveTime);
+
+    // 发送 msgType:payload 格式的消息，根据连接的协议模式编码
+    // 可在任意线程调用，不在连接所属线程时复制消息后转到该线程发送
+    // 在处理带 rid 的请求期间发往请求连接的消息会追加 rid 字段
+    // 连接启用二进制消息时，键值对转换为通用的 Fields 消息
+    void send(const muduo::net::TcpConnectionPtr& conn, const muduo::StringPiece& message) const;
+
+    // 发送指定类型的消息，flags 含 kFlagWire 时 payload 必须是二进制消息，
+    // 只能发往启用了二进制消息的连接
+    void send(const muduo::net::TcpConnectionPtr& conn, int type,
+              const muduo::StringPiece& payload, uint16_t flags = 0) const;
+
+    // 发送预先编码的消息，必须在连接所属线程中调用；群发的聊天消息较小，不压缩
+    void send(const muduo::net::TcpConnectionPtr& conn, const EncodedMessage& message) const;
+
+    // 把 msgType:payload 格式的消息一次编码为两种协议格式
+    static EncodedMessagePtr encode(const muduo::StringPiece& message);
+
+    // 从 msgType:payload 格式中拆分消息类型，格式错误时 type 为 -1
+    static Frame splitTextMessage(const muduo::StringPiece& message);
+
+    // 把 key1=value1;... 格式的内容编码为 Fields 消息追加到 out，rid 字段编码为保留字段
+    static void encodeFields(const muduo::StringPiece& payload, std::string* out);
+
+private:
+    // 处理二进制帧
+    void decodeBinary(const muduo::net::TcpConnectionPtr& conn,
+                      muduo::net::Buffer* buf,
+                      muduo::Timestamp receiveTime);
+
+    // 处理旧版文本消息
+    void decodeLegacyText(const muduo::net::TcpConnectionPtr& conn,
+                          muduo::net::Buffer* buf,
+                          muduo::Timestamp receiveTime);
+
+    // 按连接的协议模式发送 msgType:payload 格式的消息
+    void sendMessage(const muduo::net::TcpConnectionPtr& conn, const muduo::StringPiece& message) const;
+
+    // 按连接的协议模式发送指定类型的消息
+    void sendFrame(const muduo::net::TcpConnectionPtr& conn, int type,
+                   const muduo::StringPiece& payload, uint16_t flags) const;
+
+    // 填写帧头
+    static void makeHeader(char* header, size_t length, int type, uint16_t flags);
+
+    // 发送一条已编码的消息，header 可以为空
+    void write(const muduo::net::TcpConnectionPtr& conn, Session* session,
+               const muduo::StringPiece& header, const muduo::StringPiece& body) const;
+
+    // 交给TcpConnection发送
+    void writeNow(const muduo::net::TcpConnectionPtr& conn, const muduo::StringPiece& data) const;
+
+    // 帧过大时断开连接
+    void rejectOversizedFrame(const muduo::net::TcpConnectionPtr& conn, size_t length) const;
+
+    // 按连接协商的算法压缩较大的帧，压缩后更小时更新 body 和 flags
+    void maybeCompress(Session* session, int type, muduo::StringPiece* body, uint16_t* flags) const;
+
+    struct CompressionCounters {
+        std::atomic<uint64_t> compressed{0};
+        std::atomic<uint64_t> incompressible{0};
+        std::atomic<uint64_t> bytesIn{0};
+        std::atomic<uint64_t> bytesOut{0};
+        std::atomic<uint64_t> cpuNanos{0};
+    };
+
+    FrameCallback frameCallback_;
+    size_t maxFrameSize_;
+    bool coalescing_;
+    size_t compressionThreshold_;
+    
+    mutable std::array<CompressionCounters, kMaxStatsType + 1> compressionCounters_;
+
+    mutable std::atomic<uint64_t> sends_{0};
+    mutable std::atomic<uint64_t> flushes_{0};
+    mutable std::atomic<uint64_t> writes_{0};
+    mutable std::atomic<uint64_t> bytes_{0};
+};
+
+#endif // CHAT_CODEC_H
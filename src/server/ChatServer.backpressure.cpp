@@ -0,0 +1,160 @@
+#include "ChatServer.h"
+#include "../service/RedisService.h"
+
+namespace {
+
+// 非断开策略下输出缓冲区的硬上限，为高水位的倍数
+constexpr size_t kSlowConsumerHardLimitFactor = 4;
+
+} // namespace
+
+void ChatServer::onHighWaterMark(const muduo::net::TcpConnectionPtr& conn, size_t bufferedBytes) {
+    Session* session = getSession(conn);
+    if (!session || session->congested) {
+        return;
+    }
+    
+    session->congested = true;
+    if (t_loopState) {
+        t_loopState->highWaterEvents.fetch_add(1, std::memory_order_relaxed);
+    }
+    LOG_WARN << "Slow consumer " << conn->peerAddress().toIpPort() << " (user " << session->userId.load()
+             << "), output buffer " << bufferedBytes << " bytes";
+    
+    if (slowConsumerPolicy_ == SlowConsumerPolicy::DISCONNECT) {
+        disconnectSlowConsumer(conn, bufferedBytes);
+    }
+}
+
+bool ChatServer::admitDelivery(const muduo::net::TcpConnectionPtr& conn, const std::string& offlineRecord) {
+    Session* session = getSession(conn);
+    if (!session || !session->congested) {
+        return true;
+    }
+    
+    // 写完成回调只在缓冲区完全清空时触发，这里顺便检查是否已回落到低水位
+    size_t bufferedBytes = conn->outputBuffer()->readableBytes();
+    if (bufferedBytes <= lowWaterMark_) {
+        resumeDelivery(conn);
+        return true;
+    }
+    
+    if (bufferedBytes >= highWaterMark_ * kSlowConsumerHardLimitFactor) {
+        disconnectSlowConsumer(conn, bufferedBytes);
+        return false;
+    }
+    
+    switch (slowConsumerPolicy_) {
+    case SlowConsumerPolicy::DROP_EPHEMERAL:
+        if (!offlineRecord.empty()) {
+            return true;
+        }
+        break;
+        
+    case SlowConsumerPolicy::SPILL_OFFLINE: {
+        int userId = session->userId.load();
+        if (offlineRecord.empty() || userId == -1) {
+            break;
+        }
+        
+        // 转存到离线队列，恢复后通过离线消息同步补发。转存承诺之后送达，不受工作队列上限限制
+        session->spillsInFlight.fetch_add(1);
+        bool submitted = workerPool_.submit([this, conn, userId, offlineRecord]() {
+            RedisService::getInstance().pushOfflineMessage(userId, offlineRecord);
+            finishSpill(conn);
+        });
+        if (!submitted) {
+            session->spillsInFlight.fetch_sub(1);
+            LOG_WARN << "Worker pool stopped, dropped message for slow consumer user " << userId;
+            break;
+        }
+        ++session->spilledMessages;
+        if (t_loopState) {
+            t_loopState->spilledMessages.fetch_add(1, std::memory_order_relaxed);
+        }
+        return false;
+    }
+        
+    case SlowConsumerPolicy::DISCONNECT:
+        // 连接正在关闭
+        break;
+    }
+    
+    if (t_loopState) {
+        t_loopState->droppedMessages.fetch_add(1, std::memory_order_relaxed);
+    }
+    return false;
+}
+
+void ChatServer::resumeDelivery(const muduo::net::TcpConnectionPtr& conn) {
+    Session* session = getSession(conn);
+    if (!session || !session->congested) {
+        return;
+    }
+    
+    session->congested = false;
+    uint64_t spilled = session->spilledMessages;
+    session->spilledMessages = 0;
+    LOG_INFO << "Slow consumer " << conn->peerAddress().toIpPort() << " recovered, "
+             << spilled << " messages spilled to offline queue";
+    
+    // 补发拥塞期间转存的消息，接着已发送的离线消息继续，正在同步时并入本次同步。
+    // 转存还在写入时由最后完成的一条触发，补发时离线队列已包含全部转存的消息
+    if (spilled == 0 || session->userId.load() == -1) {
+        return;
+    }
+    
+    session->spillResumePending.store(true);
+    if (session->spillsInFlight.load() == 0 && session->spillResumePending.exchange(false)) {
+        workerPool_.submit([this, conn]() {
+            syncSpilledMessages(conn);
+        });
+    }
+}
+
+void ChatServer::finishSpill(const muduo::net::TcpConnectionPtr& conn) {
+    Session* session = getSession(conn);
+    if (!session) {
+        return;
+    }
+    
+    if (session->spillsInFlight.fetch_sub(1) == 1 && session->spillResumePending.exchange(false)) {
+        syncSpilledMessages(conn);
+    }
+}
+
+void ChatServer::syncSpilledMessages(const muduo::net::TcpConnectionPtr& conn) {
+    Session* session = getSession(conn);
+    int userId = session ? session->userId.load() : -1;
+    if (userId == -1 || !conn->connected()) {
+        return;
+    }
+    
+    int count = RedisService::getInstance().getOfflineMessageCount(userId);
+    if (count > 0) {
+        startOfflineSync(conn, userId, count, session->offlineAck.load(), false);
+    }
+}
+
+void ChatServer::disconnectSlowConsumer(const muduo::net::TcpConnectionPtr& conn, size_t bufferedBytes) {
+    LOG_WARN << "Disconnecting slow consumer " << conn->peerAddress().toIpPort()
+             << " with " << bufferedBytes << " bytes buffered";
+    
+    if (t_loopState) {
+        t_loopState->slowConsumerDisconnects.fetch_add(1, std::memory_order_relaxed);
+    }
+    conn->forceClose();
+}
+
+void ChatServer::sampleBufferedBytes(LoopState* state) {
+    size_t total = 0;
+    for (const auto& conn : state->connections) {
+        total += conn->outputBuffer()->readableBytes();
+        
+        Session* session = getSession(conn);
+        if (session) {
+            total += session->pendingOutput.readableBytes();
+        }
+    }
+    state->bufferedBytes.store(total, std::memory_order_relaxed);
+}
@@ -3,49 +3,299 @@
 #include "../service/MessageArchiveService.h"
 #include "../model/UserModel.h"
 #include <json/json.h>
+#include <algorithm>
+
+namespace {
+
+// 登录积压转入离线队列之前每个连接最多暂存的大群消息数量
+constexpr size_t kMaxHeldGroupMessages = 1000;
+
+// 把Redis和归档库中以JSON保存的聊天记录转换为二进制消息，无法解析的记录跳过
+void appendChatRecords(const std::vector<std::string>& messages, std::vector<wire::ChatRecord>* records)
+{
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    Json::Value json;
+    records->reserve(records->size() + messages.size());
+    for (const std::string& message : messages) {
+        if (!reader->parse(message.data(), message.data() + message.size(), &json, nullptr)) {
+            LOG_WARN << "Skipped malformed chat record: " << message;
+            continue;
+        }
+        wire::fromJson(json, &records->emplace_back());
+    }
+}
+
+} // namespace
 
 // 查找用户ID通过连接
 int ChatServer::getUserIdByConnection(const muduo::net::TcpConnectionPtr& conn) {
-    for (const auto& pair : userConnectionMap_) {
-        if (pair.second == conn) {
-            return pair.first;
+    Session* session = getSession(conn);
+    return session ? session->userId.load() : -1;
+}
+
+// 将连接绑定到已登录用户
+bool ChatServer::bindUser(const muduo::net::TcpConnectionPtr& conn, const User& user) {
+    Session* session = getSession(conn);
+    if (!session) {
+        return false;
+    }
+    
+    // 同一连接切换账号时先解除旧的绑定
+    int current = session->userId.load();
+    if (current != -1 && current != user.getId()) {
+        unbindUser(conn);
+    }
+    
+    session->username = user.getUsername();
+    session->loginTime = muduo::Timestamp::now();
+    {
+        // 绑定之后到达的大群消息先暂存，直到本次登录的积压转入离线队列
+        std::lock_guard<std::mutex> lock(session->groupMutex);
+        session->groupProgress = Session::GroupProgress();
+    }
+    session->userId.store(user.getId());
+    
+    muduo::net::TcpConnectionPtr previous = sessions_.bind(user.getId(), conn);
+    if (previous) {
+        // 旧连接不再代表该用户，断开时不能把用户置为离线
+        Session* oldSession = getSession(previous);
+        if (oldSession) {
+            int expected = user.getId();
+            oldSession->userId.compare_exchange_strong(expected, -1);
         }
+        
+        // 用户已经在其他客户端登录，需要通知之前的客户端被踢下线
+        std::string kickOutMsg = std::to_string(static_cast<int>(MessageType::ERROR)) + 
+                              ":errorMsg=Your account logged in elsewhere";
+        deliver(previous, std::move(kickOutMsg));
+    }
+    
+    // 登录在工作线程中执行，连接可能已在此期间断开。断开回调若在绑定之前就取走了userId，
+    // unbindUser 会返回-1，因此直接按本连接解除（映射仍指向本连接时才移除）
+    if (!conn->connected()) {
+        int expected = user.getId();
+        session->userId.compare_exchange_strong(expected, -1);
+        sessions_.unbind(user.getId(), conn);
+        return false;
     }
-    return -1;
+    return true;
+}
+
+// 解除连接与用户的绑定
+int ChatServer::unbindUser(const muduo::net::TcpConnectionPtr& conn) {
+    Session* session = getSession(conn);
+    if (!session) {
+        return -1;
+    }
+    
+    int userId = session->userId.exchange(-1);
+    if (userId == -1) {
+        return -1;
+    }
+
+    // 只移除仍然指向本连接的映射，已被其他连接顶替时不算解除
+    return sessions_.unbind(userId, conn) ? userId : -1;
 }
 
 // 查找用户连接通过ID
 muduo::net::TcpConnectionPtr ChatServer::getConnectionByUserId(int userId) {
-    auto it = userConnectionMap_.find(userId);
-    if (it != userConnectionMap_.end()) {
-        return it->second;
+    return sessions_.find(userId);
+}
+
+// 向其他用户的连接发送消息
+void ChatServer::deliver(const muduo::net::TcpConnectionPtr& conn, std::string message,
+                         std::string offlineRecord) {
+    // 会话的协议模式和输出缓冲区属于连接所在的I/O线程
+    const uint64_t traceId = Tracer::current();
+    const int64_t queuedAt = traceId ? Tracer::nowMicros() : 0;
+    conn->getLoop()->runInLoop([this, conn, message = std::move(message),
+                                offlineRecord = std::move(offlineRecord), traceId, queuedAt]() {
+        if (traceId) {
+            Tracer::getInstance().record(traceId, "deliver", "enqueue", queuedAt, Tracer::nowMicros() - queuedAt);
+        }
+        if (conn->connected() && admitDelivery(conn, offlineRecord)) {
+            codec_.send(conn, message);
+            traceWrite(conn, traceId);
+        }
+    });
+}
+
+void ChatServer::traceWrite(const muduo::net::TcpConnectionPtr& conn, uint64_t traceId) {
+    Session* session = getSession(conn);
+    if (traceId == 0 || !session) {
+        return;
     }
-    return nullptr;
+    // 客户端长时间不读时只保留最近的记录
+    if (session->tracedWrites.size() >= kMaxTracedWritesPerSession) {
+        session->tracedWrites.pop_front();
+    }
+    session->tracedWrites.emplace_back(traceId, Tracer::nowMicros());
 }
 
-// 处理私聊消息
-void ChatServer::handlePrivateChat(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg) {
-    // 获取发送者ID
-    int fromUserId = getUserIdByConnection(conn);
-    if (fromUserId == -1) {
-        LOG_ERROR << "User not logged in. Cannot send private message.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You must be logged in to send messages");
+void ChatServer::finishTracedWrites(Session* session) {
+    int64_t now = Tracer::nowMicros();
+    for (const auto& write : session->tracedWrites) {
+        Tracer::getInstance().record(write.first, "deliver", "write", write.second, now - write.second);
+    }
+    session->tracedWrites.clear();
+}
+
+// 向多个在线用户群发消息
+void ChatServer::broadcast(const std::vector<int>& userIds, int excludeUserId, const std::string& message,
+                           std::string offlineRecord, int groupId, long long groupSeq) {
+    // 按连接所属的EventLoop分组
+    std::unordered_map<muduo::net::EventLoop*, std::vector<muduo::net::TcpConnectionPtr>> connsByLoop;
+    for (int userId : userIds) {
+        if (userId == excludeUserId) continue;
+        
+        auto memberConn = getConnectionByUserId(userId);
+        if (memberConn && memberConn->connected()) {
+            connsByLoop[memberConn->getLoop()].push_back(std::move(memberConn));
+        }
+    }
+    size_t recipients = 0;
+    for (const auto& entry : connsByLoop) {
+        recipients += entry.second.size();
+    }
+    groupFanout_.record(recipients);
+    if (connsByLoop.empty()) {
+        return;
+    }
+    
+    // 所有成员共享同一份编码结果，每个连接只在写入输出缓冲区时复制一次
+    ChatCodec::EncodedMessagePtr encoded = ChatCodec::encode(message);
+    auto record = std::make_shared<const std::string>(std::move(offlineRecord));
+    const uint64_t traceId = Tracer::current();
+    const int64_t queuedAt = traceId ? Tracer::nowMicros() : 0;
+    for (auto& entry : connsByLoop) {
+        entry.first->runInLoop([this, conns = std::move(entry.second), encoded, record, groupId, groupSeq,
+                                traceId, queuedAt]() {
+            if (traceId) {
+                Tracer::getInstance().record(traceId, "deliver", "enqueue", queuedAt, Tracer::nowMicros() - queuedAt);
+            }
+            for (const auto& memberConn : conns) {
+                if (!memberConn->connected()) {
+                    continue;
+                }
+                if (groupSeq > 0) {
+                    deliverGroupMessage(memberConn, Session::GroupMessage{groupId, groupSeq, encoded, record}, traceId);
+                } else if (admitDelivery(memberConn, *record)) {
+                    codec_.send(memberConn, *encoded);
+                    traceWrite(memberConn, traceId);
+                }
+            }
+        });
+    }
+}
+
+// 推送一条大群消息
+void ChatServer::deliverGroupMessage(const muduo::net::TcpConnectionPtr& conn, const Session::GroupMessage& message,
+                                     uint64_t traceId) {
+    Session* session = getSession(conn);
+    if (!session || session->userId.load() == -1) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(session->groupMutex);
+    Session::GroupProgress& progress = session->groupProgress;
+    if (!progress.ready) {
+        // 暂存已满时丢弃，该群的游标停在它之前，下次登录时从群组日志读取
+        if (progress.held.size() >= kMaxHeldGroupMessages) {
+            progress.stalled.insert(message.groupId);
+            return;
+        }
+        progress.held.push_back(message);
+        return;
+    }
+    auto pulled = progress.pulled.find(message.groupId);
+    if (pulled != progress.pulled.end() && message.seq <= pulled->second) {
+        return;
+    }
+    
+    // 转存到离线队列的消息同样算作已投递。某条消息被丢弃后该群的游标停在它之前，
+    // 下次登录时从群组日志重新读取，不会越过漏掉的消息
+    uint64_t spilled = session->spilledMessages;
+    if (admitDelivery(conn, *message.record)) {
+        codec_.send(conn, *message.encoded);
+        traceWrite(conn, traceId);
+    } else if (session->spilledMessages == spilled) {
+        progress.stalled.insert(message.groupId);
+        return;
+    }
+    if (progress.stalled.count(message.groupId) == 0) {
+        long long& delivered = progress.delivered[message.groupId];
+        delivered = std::max(delivered, message.seq);
+    }
+}
+
+// 开始推送大群消息
+void ChatServer::startGroupDelivery(const muduo::net::TcpConnectionPtr& conn,
+                                    std::unordered_map<int, long long> pulled) {
+    Session* session = getSession(conn);
+    if (!session) {
         return;
     }
     
+    std::vector<Session::GroupMessage> held;
+    {
+        std::lock_guard<std::mutex> lock(session->groupMutex);
+        session->groupProgress.pulled = std::move(pulled);
+        session->groupProgress.ready = true;
+        held.swap(session->groupProgress.held);
+    }
+    
+    // 暂存的消息按到达顺序补发，序号不超过转入部分的已在离线队列中
+    for (const Session::GroupMessage& message : held) {
+        if (!conn->connected()) {
+            break;
+        }
+        deliverGroupMessage(conn, message, 0);
+    }
+}
+
+// 记录发送者自己的大群消息序号
+void ChatServer::noteGroupMessage(const muduo::net::TcpConnectionPtr& conn, int groupId, long long seq) {
+    Session* session = getSession(conn);
+    if (!session) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(session->groupMutex);
+    if (session->groupProgress.ready && session->groupProgress.stalled.count(groupId) == 0) {
+        long long& delivered = session->groupProgress.delivered[groupId];
+        delivered = std::max(delivered, seq);
+    }
+}
+
+// 取出连接的大群投递进度
+std::unordered_map<int, long long> ChatServer::takeGroupCursors(const muduo::net::TcpConnectionPtr& conn) {
+    Session* session = getSession(conn);
+    if (!session) {
+        return {};
+    }
+    
+    std::lock_guard<std::mutex> lock(session->groupMutex);
+    std::unordered_map<int, long long> delivered = std::move(session->groupProgress.delivered);
+    session->groupProgress = Session::GroupProgress();
+    return delivered;
+}
+
+// 处理私聊消息
+void ChatServer::handlePrivateChat(const muduo::net::TcpConnectionPtr& conn, int fromUserId, const Request& msg) {
     // 获取接收者ID或用户名和消息内容
     auto toUserIdIt = msg.find("toUserId");
     auto contentIt = msg.find("content");
     
     if (toUserIdIt == msg.end() || contentIt == msg.end()) {
         LOG_ERROR << "Invalid private chat message format. Missing toUserId or content.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid message format");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid message format");
         return;
     }
     
     int toUserId = -1;
-    std::string toUserName = toUserIdIt->second;
-    std::string content = contentIt->second;
+    std::string toUserName(toUserIdIt->second);
+    std::string content(contentIt->second);
     
     // 尝试将toUserId转换为整数，如果失败则认为是用户名
     try {
@@ -57,32 +307,28 @@ void ChatServer::handlePrivateChat(const muduo::net::TcpConnectionPtr& conn, con
             toUserId = toUser->getId();
         } else {
             LOG_ERROR << "Cannot find user with name: " << toUserName;
-            conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=User not found");
+            codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=User not found");
             return;
         }
     } catch (const std::out_of_range& e) {
         LOG_ERROR << "User ID is out of range";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid user ID");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid user ID");
         return;
     }
     
-    // 更新连接活动时间
-    connectionLastActiveTime_[conn] = muduo::Timestamp::now();
+    // 发送消息到Redis，好友关系在同一次调用中检查
+    std::string record;
+    std::string messageId;
+    RedisService::SendResult result =
+        RedisService::getInstance().sendPrivateMessage(fromUserId, toUserId, content, &record, &messageId);
     
-    // 检查是否为好友关系
-    bool isFriend = RedisService::getInstance().isFriend(fromUserId, toUserId);
-    if (!isFriend) {
-        LOG_ERROR << "User " << fromUserId << " tried to send message to non-friend user " << toUserId;
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You can only send messages to your friends");
+    if (result == RedisService::SendResult::NOT_FRIEND) {
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You can only send messages to your friends");
         return;
     }
-    
-    // 发送消息到Redis
-    bool success = RedisService::getInstance().sendPrivateMessage(fromUserId, toUserId, content);
-    
-    if (!success) {
+    if (result == RedisService::SendResult::FAILED) {
         LOG_ERROR << "Failed to send private message from user " << fromUserId << " to user " << toUserId;
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Failed to send message");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Failed to send message");
         return;
     }
     
@@ -95,7 +341,8 @@ void ChatServer::handlePrivateChat(const muduo::net::TcpConnectionPtr& conn, con
     
     // 构建消息
     std::string message = std::to_string(static_cast<int>(MessageType::PRIVATE_CHAT)) + 
-                        ":fromUserId=" + std::to_string(fromUserId) + 
+                        ":messageId=" + messageId + 
+                        ";fromUserId=" + std::to_string(fromUserId) + 
                         ";fromUsername=" + fromUser->getUsername() + 
                         ";content=" + content + 
                         ";timestamp=" + std::to_string(
@@ -107,39 +354,31 @@ void ChatServer::handlePrivateChat(const muduo::net::TcpConnectionPtr& conn, con
     // 发送消息给接收者
     auto toConn = getConnectionByUserId(toUserId);
     if (toConn && toConn->connected()) {
-        toConn->send(message);
+        deliver(toConn, message, std::move(record));
         LOG_INFO << "Private message sent from user " << fromUserId << " to user " << toUserId;
     } else {
         LOG_INFO << "Recipient user " << toUserId << " is offline. Message stored for later delivery.";
     }
     
     // 发送确认给发送者
-    conn->send(message);
+    codec_.send(conn, message);
 }
 
 // 处理群聊消息
-void ChatServer::handleGroupChat(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg) {
-    // 获取发送者ID
-    int fromUserId = getUserIdByConnection(conn);
-    if (fromUserId == -1) {
-        LOG_ERROR << "User not logged in. Cannot send group message.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You must be logged in to send messages");
-        return;
-    }
-    
+void ChatServer::handleGroupChat(const muduo::net::TcpConnectionPtr& conn, int fromUserId, const Request& msg) {
     // 获取群组ID和消息内容
     auto groupIdIt = msg.find("groupId");
     auto contentIt = msg.find("content");
     
     if (groupIdIt == msg.end() || contentIt == msg.end()) {
         LOG_ERROR << "Invalid group chat message format. Missing groupId or content.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid message format");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid message format");
         return;
     }
     
     int groupId = -1;
-    std::string groupIdStr = groupIdIt->second;
-    std::string content = contentIt->second;
+    std::string groupIdStr(groupIdIt->second);
+    std::string content(contentIt->second);
     
     // 尝试将groupId转换为整数，如果失败则可能是群组名称（未实现）
     try {
@@ -147,23 +386,33 @@ void ChatServer::handleGroupChat(const muduo::net::TcpConnectionPtr& conn, const
     } catch (const std::invalid_argument& e) {
         // 未来可以实现通过群组名称查找群组ID的功能
         LOG_ERROR << "Invalid group ID format: " << groupIdStr;
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid group ID format");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid group ID format");
         return;
     } catch (const std::out_of_range& e) {
         LOG_ERROR << "Group ID is out of range";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid group ID");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid group ID");
         return;
     }
     
-    // 更新连接活动时间
-    connectionLastActiveTime_[conn] = muduo::Timestamp::now();
-    
-    // 发送消息到Redis
-    bool success = RedisService::getInstance().sendGroupMessage(fromUserId, groupId, content);
+    // 发送消息到Redis，同时取回群成员列表
+    std::string record;
+    std::vector<int> members;
+    std::string messageId;
+    long long groupSeq = 0;
+    RedisService::SendResult result = RedisService::getInstance().sendGroupMessage(
+        fromUserId, groupId, content, &record, &members, &messageId, &groupSeq);
     
-    if (!success) {
+    if (result == RedisService::SendResult::NO_GROUP) {
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Group not found");
+        return;
+    }
+    if (result == RedisService::SendResult::NOT_MEMBER) {
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You are not a member of this group");
+        return;
+    }
+    if (result == RedisService::SendResult::FAILED) {
         LOG_ERROR << "Failed to send group message from user " << fromUserId << " to group " << groupId;
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Failed to send message");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Failed to send message");
         return;
     }
     
@@ -176,7 +425,8 @@ void ChatServer::handleGroupChat(const muduo::net::TcpConnectionPtr& conn, const
     
     // 构建消息
     std::string message = std::to_string(static_cast<int>(MessageType::GROUP_CHAT)) + 
-                        ":groupId=" + std::to_string(groupId) + 
+                        ":messageId=" + messageId + 
+                        ";groupId=" + std::to_string(groupId) + 
                         ";fromUserId=" + std::to_string(fromUserId) + 
                         ";fromUsername=" + fromUser->getUsername() + 
                         ";content=" + content + 
@@ -186,47 +436,29 @@ void ChatServer::handleGroupChat(const muduo::net::TcpConnectionPtr& conn, const
                             ).count()
                         );
     
-    // 获取群组成员列表
-    std::vector<int> members = RedisService::getInstance().getGroupMembers(groupId);
-    
-    // 发送消息给所有在线群组成员
-    for (int memberId : members) {
-        if (memberId == fromUserId) continue;  // 跳过发送者自己
-        
-        auto memberConn = getConnectionByUserId(memberId);
-        if (memberConn && memberConn->connected()) {
-            memberConn->send(message);
-        }
+    // 发送消息给所有在线群组成员，跳过发送者自己
+    broadcast(members, fromUserId, message, std::move(record), groupId, groupSeq);
+    if (groupSeq > 0) {
+        noteGroupMessage(conn, groupId, groupSeq);
     }
     
     // 发送确认给发送者
-    conn->send(message);
+    codec_.send(conn, message);
     
     LOG_INFO << "Group message sent from user " << fromUserId << " to group " << groupId;
 }
 
 // 处理创建群组
-void ChatServer::handleCreateGroup(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg) {
-    // 获取发送者ID
-    int fromUserId = getUserIdByConnection(conn);
-    if (fromUserId == -1) {
-        LOG_ERROR << "User not logged in. Cannot create group.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You must be logged in to create a group");
-        return;
-    }
-    
+void ChatServer::handleCreateGroup(const muduo::net::TcpConnectionPtr& conn, int fromUserId, const Request& msg) {
     // 获取群组名称
     auto groupNameIt = msg.find("groupName");
     if (groupNameIt == msg.end()) {
         LOG_ERROR << "Invalid create group request. Missing groupName.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
         return;
     }
     
-    std::string groupName = groupNameIt->second;
-    
-    // 更新连接活动时间
-    connectionLastActiveTime_[conn] = muduo::Timestamp::now();
+    std::string groupName(groupNameIt->second);
     
     // 生成一个新的群组ID (简化处理，实际应从数据库生成)
     int groupId = static_cast<int>(
@@ -240,7 +472,7 @@ void ChatServer::handleCreateGroup(const muduo::net::TcpConnectionPtr& conn, con
     
     if (!success) {
         LOG_ERROR << "Failed to create group " << groupName << " by user " << fromUserId;
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Failed to create group");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Failed to create group");
         return;
     }
     
@@ -251,41 +483,30 @@ void ChatServer::handleCreateGroup(const muduo::net::TcpConnectionPtr& conn, con
                          ";groupName=" + groupName;
     
     // 发送响应给创建者
-    conn->send(response);
+    codec_.send(conn, response);
     
     LOG_INFO << "Group " << groupId << " (" << groupName << ") created by user " << fromUserId;
 }
 
 // 处理加入群组
-void ChatServer::handleJoinGroup(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg) {
-    // 获取发送者ID
-    int fromUserId = getUserIdByConnection(conn);
-    if (fromUserId == -1) {
-        LOG_ERROR << "User not logged in. Cannot join group.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You must be logged in to join a group");
-        return;
-    }
-    
+void ChatServer::handleJoinGroup(const muduo::net::TcpConnectionPtr& conn, int fromUserId, const Request& msg) {
     // 获取群组ID
     auto groupIdIt = msg.find("groupId");
     if (groupIdIt == msg.end()) {
         LOG_ERROR << "Invalid join group request. Missing groupId.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
         return;
     }
     
     int groupId;
     try {
-        groupId = std::stoi(groupIdIt->second);
+        groupId = toInt(groupIdIt->second);
     } catch (const std::exception& e) {
         LOG_ERROR << "Invalid group ID: " << groupIdIt->second << ". Expected a number.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid group ID. Please enter a numeric ID");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid group ID. Please enter a numeric ID");
         return;
     }
     
-    // 更新连接活动时间
-    connectionLastActiveTime_[conn] = muduo::Timestamp::now();
-    
     // 加入群组
     bool success = RedisService::getInstance().joinGroup(fromUserId, groupId);
     
@@ -306,39 +527,28 @@ void ChatServer::handleJoinGroup(const muduo::net::TcpConnectionPtr& conn, const
     }
     
     // 发送响应给用户
-    conn->send(response);
+    codec_.send(conn, response);
 }
 
 // 处理离开群组
-void ChatServer::handleLeaveGroup(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg) {
-    // 获取发送者ID
-    int fromUserId = getUserIdByConnection(conn);
-    if (fromUserId == -1) {
-        LOG_ERROR << "User not logged in. Cannot leave group.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You must be logged in to leave a group");
-        return;
-    }
-    
+void ChatServer::handleLeaveGroup(const muduo::net::TcpConnectionPtr& conn, int fromUserId, const Request& msg) {
     // 获取群组ID
     auto groupIdIt = msg.find("groupId");
     if (groupIdIt == msg.end()) {
         LOG_ERROR << "Invalid leave group request. Missing groupId.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
         return;
     }
     
     int groupId;
     try {
-        groupId = std::stoi(groupIdIt->second);
+        groupId = toInt(groupIdIt->second);
     } catch (const std::exception& e) {
         LOG_ERROR << "Invalid group ID: " << groupIdIt->second << ". Expected a number.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid group ID. Please enter a numeric ID");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid group ID. Please enter a numeric ID");
         return;
     }
     
-    // 更新连接活动时间
-    connectionLastActiveTime_[conn] = muduo::Timestamp::now();
-    
     // 离开群组
     bool success = RedisService::getInstance().leaveGroup(fromUserId, groupId);
     
@@ -359,224 +569,182 @@ void ChatServer::handleLeaveGroup(const muduo::net::TcpConnectionPtr& conn, cons
     }
     
     // 发送响应给用户
-    conn->send(response);
+    codec_.send(conn, response);
 }
 
 // 处理获取用户列表
-void ChatServer::handleGetUserList(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& /* msg */) {
-    // 获取发送者ID
-    int fromUserId = getUserIdByConnection(conn);
-    if (fromUserId == -1) {
-        LOG_ERROR << "User not logged in. Cannot get user list.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You must be logged in to get user list");
-        return;
-    }
-    
-    // 更新连接活动时间
-    connectionLastActiveTime_[conn] = muduo::Timestamp::now();
-    
+void ChatServer::handleGetUserList(const muduo::net::TcpConnectionPtr& conn, int fromUserId, const Request& /* msg */) {
     // 获取在线用户列表
     std::vector<int> onlineUsers = RedisService::getInstance().getOnlineUsers();
     
-    // 构建用户列表JSON
-    Json::Value userList(Json::arrayValue);
+    // 构建用户列表
+    wire::UserListResponse userList;
     for (int userId : onlineUsers) {
         auto user = UserModel::getInstance().getUserById(userId);
         if (user) {
-            Json::Value userObj;
-            userObj["id"] = userId;
-            userObj["username"] = user->getUsername();
-            userObj["online"] = true;
-            userList.append(userObj);
+            wire::UserInfo& info = userList.users.emplace_back();
+            info.id = userId;
+            info.username = user->getUsername();
+            info.online = true;
         }
     }
     
-    // 转换为字符串（使用紧凑格式）
-    std::string userListStr = compactJsonString(userList);
-    
-    // 构建响应消息
-    std::string response = std::to_string(static_cast<int>(MessageType::USER_LIST_RESPONSE)) + 
-                         ":status=0" + 
-                         ";users=" + userListStr;
-    
-    // 发送响应给用户
-    conn->send(response);
+    if (usesWireFormat(conn)) {
+        sendWire(conn, MessageType::USER_LIST_RESPONSE, userList);
+    } else {
+        // 转换为字符串（使用紧凑格式）
+        std::string userListStr = compactJsonString(wire::toJson(userList)["users"]);
+        
+        // 构建响应消息
+        std::string response = std::to_string(static_cast<int>(MessageType::USER_LIST_RESPONSE)) + 
+                             ":status=0" + 
+                             ";users=" + userListStr;
+        
+        // 发送响应给用户
+        codec_.send(conn, response);
+    }
     
     LOG_INFO << "User list sent to user " << fromUserId;
 }
 
 // 处理获取群组列表
-void ChatServer::handleGetGroupList(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& /* msg */) {
-    // 获取发送者ID
-    int fromUserId = getUserIdByConnection(conn);
-    if (fromUserId == -1) {
-        LOG_ERROR << "User not logged in. Cannot get group list.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You must be logged in to get group list");
-        return;
-    }
-    
-    // 更新连接活动时间
-    connectionLastActiveTime_[conn] = muduo::Timestamp::now();
-    
+void ChatServer::handleGetGroupList(const muduo::net::TcpConnectionPtr& conn, int fromUserId, const Request& /* msg */) {
     // 获取用户的群组列表
     std::vector<int> userGroups = RedisService::getInstance().getUserGroups(fromUserId);
     
-    // 构建群组列表JSON
-    Json::Value groupList(Json::arrayValue);
+    // 构建群组列表
+    wire::GroupListResponse groupList;
     for (int groupId : userGroups) {
-        Json::Value groupObj;
-        groupObj["id"] = groupId;
+        wire::GroupInfo& info = groupList.groups.emplace_back();
+        info.id = groupId;
         // TODO: 从Redis获取群组名称，这里简化处理
-        groupObj["name"] = "Group-" + std::to_string(groupId);
-        groupList.append(groupObj);
+        info.name = "Group-" + std::to_string(groupId);
     }
     
-    // 转换为字符串 (使用紧凑输出格式)
-    std::string groupListStr = compactJsonString(groupList);
-    
-    // 构建响应消息
-    std::string response = std::to_string(static_cast<int>(MessageType::GROUP_LIST_RESPONSE)) + 
-                         ":status=0" + 
-                         ";groups=" + groupListStr;
-    
-    // 发送响应给用户
-    conn->send(response);
+    if (usesWireFormat(conn)) {
+        sendWire(conn, MessageType::GROUP_LIST_RESPONSE, groupList);
+    } else {
+        // 转换为字符串 (使用紧凑输出格式)
+        std::string groupListStr = compactJsonString(wire::toJson(groupList)["groups"]);
+        
+        // 构建响应消息
+        std::string response = std::to_string(static_cast<int>(MessageType::GROUP_LIST_RESPONSE)) + 
+                             ":status=0" + 
+                             ";groups=" + groupListStr;
+        
+        // 发送响应给用户
+        codec_.send(conn, response);
+    }
     
     LOG_INFO << "Group list sent to user " << fromUserId;
 }
 
 // 处理获取群成员
-void ChatServer::handleGetGroupMembers(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg) {
-    // 获取发送者ID
-    int fromUserId = getUserIdByConnection(conn);
-    if (fromUserId == -1) {
-        LOG_ERROR << "User not logged in. Cannot get group members.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You must be logged in to get group members");
-        return;
-    }
-    
+void ChatServer::handleGetGroupMembers(const muduo::net::TcpConnectionPtr& conn, int fromUserId, const Request& msg) {
     // 获取群组ID
     auto groupIdIt = msg.find("groupId");
     if (groupIdIt == msg.end()) {
         LOG_ERROR << "Invalid get group members request. Missing groupId.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
         return;
     }
     
     int groupId;
     try {
-        groupId = std::stoi(groupIdIt->second);
+        groupId = toInt(groupIdIt->second);
     } catch (const std::exception& e) {
         LOG_ERROR << "Invalid group ID: " << groupIdIt->second << ". Expected a number.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid group ID. Please enter a numeric ID");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid group ID. Please enter a numeric ID");
         return;
     }
     
-    // 更新连接活动时间
-    connectionLastActiveTime_[conn] = muduo::Timestamp::now();
-    
     // 获取群组成员列表
     std::vector<int> members = RedisService::getInstance().getGroupMembers(groupId);
     
-    // 构建成员列表JSON
-    Json::Value memberList(Json::arrayValue);
+    // 构建成员列表
+    wire::GroupMembersResponse memberList;
+    memberList.groupId = groupId;
     for (int memberId : members) {
         auto member = UserModel::getInstance().getUserById(memberId);
         if (member) {
-            Json::Value memberObj;
-            memberObj["id"] = memberId;
-            memberObj["username"] = member->getUsername();
-            memberObj["online"] = RedisService::getInstance().isUserOnline(memberId);
-            memberList.append(memberObj);
+            wire::UserInfo& info = memberList.members.emplace_back();
+            info.id = memberId;
+            info.username = member->getUsername();
+            info.online = RedisService::getInstance().isUserOnline(memberId);
         }
     }
     
-    // 转换为字符串（使用紧凑格式）
-    std::string memberListStr = compactJsonString(memberList);
-    
-    // 构建响应消息
-    std::string response = std::to_string(static_cast<int>(MessageType::GROUP_MEMBERS_RESPONSE)) + 
-                         ":status=0" + 
-                         ";groupId=" + std::to_string(groupId) + 
-                         ";members=" + memberListStr;
-    
-    // 发送响应给用户
-    conn->send(response);
+    if (usesWireFormat(conn)) {
+        sendWire(conn, MessageType::GROUP_MEMBERS_RESPONSE, memberList);
+    } else {
+        // 转换为字符串（使用紧凑格式）
+        std::string memberListStr = compactJsonString(wire::toJson(memberList)["members"]);
+        
+        // 构建响应消息
+        std::string response = std::to_string(static_cast<int>(MessageType::GROUP_MEMBERS_RESPONSE)) + 
+                             ":status=0" + 
+                             ";groupId=" + std::to_string(groupId) + 
+                             ";members=" + memberListStr;
+        
+        // 发送响应给用户
+        codec_.send(conn, response);
+    }
     
     LOG_INFO << "Group " << groupId << " members list sent to user " << fromUserId;
 }
 
 // 处理获取好友列表
-void ChatServer::handleGetUserFriends(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& /* msg */) {
-    // 获取发送者ID
-    int fromUserId = getUserIdByConnection(conn);
-    if (fromUserId == -1) {
-        LOG_ERROR << "User not logged in. Cannot get friends list.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You must be logged in to get friends list");
-        return;
-    }
-    
-    // 更新连接活动时间
-    connectionLastActiveTime_[conn] = muduo::Timestamp::now();
-    
+void ChatServer::handleGetUserFriends(const muduo::net::TcpConnectionPtr& conn, int fromUserId, const Request& /* msg */) {
     // 获取好友列表
     std::vector<int> friends = RedisService::getInstance().getUserFriends(fromUserId);
     
-    // 构建好友列表JSON
-    Json::Value friendList(Json::arrayValue);
+    // 构建好友列表
+    wire::UserFriendsResponse friendList;
     for (int friendId : friends) {
         auto friendUser = UserModel::getInstance().getUserById(friendId);
         if (friendUser) {
-            Json::Value friendObj;
-            friendObj["id"] = friendId;
-            friendObj["username"] = friendUser->getUsername();
-            friendObj["online"] = RedisService::getInstance().isUserOnline(friendId);
-            friendList.append(friendObj);
+            wire::UserInfo& info = friendList.friends.emplace_back();
+            info.id = friendId;
+            info.username = friendUser->getUsername();
+            info.online = RedisService::getInstance().isUserOnline(friendId);
         }
     }
     
-    // 转换为字符串（使用紧凑格式）
-    std::string friendListStr = compactJsonString(friendList);
-    
-    // 构建响应消息
-    std::string response = std::to_string(static_cast<int>(MessageType::USER_FRIENDS_RESPONSE)) + 
-                         ":status=0" + 
-                         ";friends=" + friendListStr;
-    
-    // 发送响应给用户
-    conn->send(response);
+    if (usesWireFormat(conn)) {
+        sendWire(conn, MessageType::USER_FRIENDS_RESPONSE, friendList);
+    } else {
+        // 转换为字符串（使用紧凑格式）
+        std::string friendListStr = compactJsonString(wire::toJson(friendList)["friends"]);
+        
+        // 构建响应消息
+        std::string response = std::to_string(static_cast<int>(MessageType::USER_FRIENDS_RESPONSE)) + 
+                             ":status=0" + 
+                             ";friends=" + friendListStr;
+        
+        // 发送响应给用户
+        codec_.send(conn, response);
+    }
     
     LOG_INFO << "Friends list sent to user " << fromUserId;
 }
 
 // 处理添加好友 (改为发送好友请求)
-void ChatServer::handleAddFriend(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg) {
+void ChatServer::handleAddFriend(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg) {
     // 为了向后兼容，将ADD_FRIEND消息重定向到ADD_FRIEND_REQUEST处理
-    handleAddFriendRequest(conn, msg);
+    handleAddFriendRequest(conn, userId, msg);
 }
 
 // 处理发送好友请求
-void ChatServer::handleAddFriendRequest(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg) {
-    // 获取发送者ID
-    int fromUserId = getUserIdByConnection(conn);
-    if (fromUserId == -1) {
-        LOG_ERROR << "User not logged in. Cannot send friend request.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You must be logged in to send a friend request");
-        return;
-    }
-    
+void ChatServer::handleAddFriendRequest(const muduo::net::TcpConnectionPtr& conn, int fromUserId, const Request& msg) {
     // 获取好友ID或用户名
     auto friendIdIt = msg.find("friendId");
     if (friendIdIt == msg.end()) {
         LOG_ERROR << "Invalid friend request. Missing friendId.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
         return;
     }
     
-    // 更新连接活动时间
-    connectionLastActiveTime_[conn] = muduo::Timestamp::now();
-    
-    std::string friendIdentifier = friendIdIt->second;
+    std::string friendIdentifier(friendIdIt->second);
     std::shared_ptr<User> friendUser;
     int friendId = -1;
     
@@ -596,21 +764,21 @@ void ChatServer::handleAddFriendRequest(const muduo::net::TcpConnectionPtr& conn
     // 检查好友是否存在
     if (!friendUser) {
         LOG_ERROR << "User '" << friendIdentifier << "' does not exist. Cannot send friend request.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=User does not exist");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=User does not exist");
         return;
     }
     
     // 检查是否是自己
     if (fromUserId == friendId) {
         LOG_ERROR << "User " << fromUserId << " tried to send friend request to himself.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You cannot send friend request to yourself");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You cannot send friend request to yourself");
         return;
     }
     
     // 检查是否已经是好友
     if (RedisService::getInstance().isFriend(fromUserId, friendId)) {
         LOG_ERROR << "User " << fromUserId << " and user " << friendId << " are already friends.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You are already friends with this user");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You are already friends with this user");
         return;
     }
     
@@ -637,7 +805,7 @@ void ChatServer::handleAddFriendRequest(const muduo::net::TcpConnectionPtr& conn
                                          ":fromUserId=" + std::to_string(fromUserId) +
                                          ";username=" + senderUser->getUsername() +
                                          ";message=You have a new friend request";
-                targetConn->send(notification);
+                deliver(targetConn, notification);
             }
         }
     } else {
@@ -649,36 +817,25 @@ void ChatServer::handleAddFriendRequest(const muduo::net::TcpConnectionPtr& conn
     }
     
     // 发送响应给用户
-    conn->send(response);
+    codec_.send(conn, response);
 }
 
 // 处理接受好友请求
-void ChatServer::handleAcceptFriendRequest(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg) {
-    // 获取发送者ID
-    int toUserId = getUserIdByConnection(conn);
-    if (toUserId == -1) {
-        LOG_ERROR << "User not logged in. Cannot accept friend request.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You must be logged in to accept friend request");
-        return;
-    }
-    
+void ChatServer::handleAcceptFriendRequest(const muduo::net::TcpConnectionPtr& conn, int toUserId, const Request& msg) {
     // 获取请求发送者的ID
     auto fromUserIdIt = msg.find("fromUserId");
     if (fromUserIdIt == msg.end()) {
         LOG_ERROR << "Invalid accept friend request. Missing fromUserId.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
         return;
     }
     
-    // 更新连接活动时间
-    connectionLastActiveTime_[conn] = muduo::Timestamp::now();
-    
     int fromUserId;
     try {
-        fromUserId = std::stoi(fromUserIdIt->second);
+        fromUserId = toInt(fromUserIdIt->second);
     } catch (const std::exception& e) {
         LOG_ERROR << "Invalid fromUserId: " << fromUserIdIt->second;
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid user ID");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid user ID");
         return;
     }
     
@@ -686,7 +843,7 @@ void ChatServer::handleAcceptFriendRequest(const muduo::net::TcpConnectionPtr& c
     auto fromUser = UserModel::getInstance().getUserById(fromUserId);
     if (!fromUser) {
         LOG_ERROR << "User " << fromUserId << " does not exist.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=User does not exist");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=User does not exist");
         return;
     }
     
@@ -713,7 +870,7 @@ void ChatServer::handleAcceptFriendRequest(const muduo::net::TcpConnectionPtr& c
                                          ":toUserId=" + std::to_string(toUserId) +
                                          ";username=" + toUser->getUsername() +
                                          ";message=Your friend request has been accepted";
-                fromConn->send(notification);
+                deliver(fromConn, notification);
             }
         }
     } else {
@@ -725,36 +882,25 @@ void ChatServer::handleAcceptFriendRequest(const muduo::net::TcpConnectionPtr& c
     }
     
     // 发送响应给用户
-    conn->send(response);
+    codec_.send(conn, response);
 }
 
 // 处理拒绝好友请求
-void ChatServer::handleRejectFriendRequest(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg) {
-    // 获取发送者ID
-    int toUserId = getUserIdByConnection(conn);
-    if (toUserId == -1) {
-        LOG_ERROR << "User not logged in. Cannot reject friend request.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You must be logged in to reject friend request");
-        return;
-    }
-    
+void ChatServer::handleRejectFriendRequest(const muduo::net::TcpConnectionPtr& conn, int toUserId, const Request& msg) {
     // 获取请求发送者的ID
     auto fromUserIdIt = msg.find("fromUserId");
     if (fromUserIdIt == msg.end()) {
         LOG_ERROR << "Invalid reject friend request. Missing fromUserId.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
         return;
     }
     
-    // 更新连接活动时间
-    connectionLastActiveTime_[conn] = muduo::Timestamp::now();
-    
     int fromUserId;
     try {
-        fromUserId = std::stoi(fromUserIdIt->second);
+        fromUserId = toInt(fromUserIdIt->second);
     } catch (const std::exception& e) {
         LOG_ERROR << "Invalid fromUserId: " << fromUserIdIt->second;
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid user ID");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid user ID");
         return;
     }
     
@@ -762,7 +908,7 @@ void ChatServer::handleRejectFriendRequest(const muduo::net::TcpConnectionPtr& c
     auto fromUser = UserModel::getInstance().getUserById(fromUserId);
     if (!fromUser) {
         LOG_ERROR << "User " << fromUserId << " does not exist.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=User does not exist");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=User does not exist");
         return;
     }
     
@@ -790,63 +936,47 @@ void ChatServer::handleRejectFriendRequest(const muduo::net::TcpConnectionPtr& c
     }
     
     // 发送响应给用户
-    conn->send(response);
+    codec_.send(conn, response);
 }
 
 // 处理获取好友请求列表
-void ChatServer::handleGetFriendRequests(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& /* msg */) {
-    // 获取发送者ID
-    int userId = getUserIdByConnection(conn);
-    if (userId == -1) {
-        LOG_ERROR << "User not logged in. Cannot get friend requests.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You must be logged in to get friend requests");
-        return;
-    }
-    
-    // 更新连接活动时间
-    connectionLastActiveTime_[conn] = muduo::Timestamp::now();
-    
+void ChatServer::handleGetFriendRequests(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& /* msg */) {
     // 获取好友请求列表
     std::vector<std::pair<int, std::string>> requests = RedisService::getInstance().getFriendRequests(userId);
     
-    // 构建好友请求列表JSON
-    Json::Value requestList(Json::arrayValue);
+    // 构建好友请求列表
+    wire::FriendRequestsResponse requestList;
     for (const auto& request : requests) {
         int requestUserId = request.first;
         auto requestUser = UserModel::getInstance().getUserById(requestUserId);
         if (requestUser) {
-            Json::Value requestObj;
-            requestObj["id"] = requestUserId;
-            requestObj["username"] = requestUser->getUsername();
-            requestObj["online"] = RedisService::getInstance().isUserOnline(requestUserId);
-            requestList.append(requestObj);
+            wire::UserInfo& info = requestList.requests.emplace_back();
+            info.id = requestUserId;
+            info.username = requestUser->getUsername();
+            info.online = RedisService::getInstance().isUserOnline(requestUserId);
         }
     }
     
-    // 转换为字符串（使用紧凑格式）
-    std::string requestListStr = compactJsonString(requestList);
-    
-    // 构建响应消息
-    std::string response = std::to_string(static_cast<int>(MessageType::FRIEND_REQUESTS_RESPONSE)) + 
-                         ":status=0" + 
-                         ";requests=" + requestListStr;
-    
-    // 发送响应给用户
-    conn->send(response);
+    if (usesWireFormat(conn)) {
+        sendWire(conn, MessageType::FRIEND_REQUESTS_RESPONSE, requestList);
+    } else {
+        // 转换为字符串（使用紧凑格式）
+        std::string requestListStr = compactJsonString(wire::toJson(requestList)["requests"]);
+        
+        // 构建响应消息
+        std::string response = std::to_string(static_cast<int>(MessageType::FRIEND_REQUESTS_RESPONSE)) + 
+                             ":status=0" + 
+                             ";requests=" + requestListStr;
+        
+        // 发送响应给用户
+        codec_.send(conn, response);
+    }
     
     LOG_INFO << "Friend requests list sent to user " << userId << ", found " << requests.size() << " requests";
 }
 
 // 处理获取聊天记录
-void ChatServer::handleGetChatHistory(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg) {
-    // 获取发送者ID
-    int fromUserId = getUserIdByConnection(conn);
-    if (fromUserId == -1) {
-        LOG_ERROR << "User not logged in. Cannot get chat history.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You must be logged in to get chat history");
-        return;
-    }
-    
+void ChatServer::handleGetChatHistory(const muduo::net::TcpConnectionPtr& conn, int fromUserId, const Request& msg) {
     // 获取聊天类型、目标ID和消息数量
     auto typeIt = msg.find("type");
     auto targetIdIt = msg.find("targetUserId");
@@ -856,19 +986,16 @@ void ChatServer::handleGetChatHistory(const muduo::net::TcpConnectionPtr& conn,
     if (typeIt == msg.end() || (typeIt->second == "private" && targetIdIt == msg.end()) || 
         (typeIt->second == "group" && groupIdIt == msg.end())) {
         LOG_ERROR << "Invalid get chat history request. Missing required parameters.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
         return;
     }
     
-    std::string type = typeIt->second;
-    int count = (countIt != msg.end()) ? std::stoi(countIt->second) : 20;  // 默认获取20条消息
+    std::string type(typeIt->second);
+    int count = (countIt != msg.end()) ? toInt(countIt->second) : 20;  // 默认获取20条消息
     int offset = 0; // 可以添加分页支持
     
-    // 更新连接活动时间
-    connectionLastActiveTime_[conn] = muduo::Timestamp::now();
-    
     if (type == "private") {
-        int targetUserId = std::stoi(targetIdIt->second);
+        int targetUserId = toInt(targetIdIt->second);
         
         // 获取私聊历史消息
         std::vector<std::string> messages = MessageArchiveService::getInstance().getHistoricalMessages(fromUserId, targetUserId, count, offset);
@@ -879,6 +1006,17 @@ void ChatServer::handleGetChatHistory(const muduo::net::TcpConnectionPtr& conn,
             messages.insert(messages.end(), recentMessages.begin(), recentMessages.end());
         }
         
+        if (usesWireFormat(conn)) {
+            wire::ChatHistoryResponse history;
+            history.type = "private";
+            history.userId = fromUserId;
+            history.targetId = targetUserId;
+            appendChatRecords(messages, &history.messages);
+            sendWire(conn, MessageType::CHAT_HISTORY_RESPONSE, history);
+            LOG_INFO << "Sent " << messages.size() << " private chat history messages to user " << fromUserId;
+            return;
+        }
+        
         // 转换为字符串
         Json::StreamWriterBuilder writer;
         std::string messagesJsonStr = Json::writeString(writer, Json::arrayValue);
@@ -900,11 +1038,11 @@ void ChatServer::handleGetChatHistory(const muduo::net::TcpConnectionPtr& conn,
                              ";targetId=" + std::to_string(targetUserId) +
                              ";messages=" + messagesJsonStr;
                              
-        conn->send(response);
+        codec_.send(conn, response);
         LOG_INFO << "Sent " << messages.size() << " private chat history messages to user " << fromUserId;
     } 
     else if (type == "group") {
-        int groupId = std::stoi(groupIdIt->second);
+        int groupId = toInt(groupIdIt->second);
         
         // 检查用户是否是群成员
         std::vector<int> groupMembers = RedisService::getInstance().getGroupMembers(groupId);
@@ -918,7 +1056,7 @@ void ChatServer::handleGetChatHistory(const muduo::net::TcpConnectionPtr& conn,
         
         if (!isMember) {
             LOG_ERROR << "User " << fromUserId << " is not a member of group " << groupId;
-            conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You are not a member of this group");
+            codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You are not a member of this group");
             return;
         }
         
@@ -932,6 +1070,16 @@ void ChatServer::handleGetChatHistory(const muduo::net::TcpConnectionPtr& conn,
             messages.insert(messages.end(), recentMessages.begin(), recentMessages.end());
         }
         
+        if (usesWireFormat(conn)) {
+            wire::ChatHistoryResponse history;
+            history.type = "group";
+            history.groupId = groupId;
+            appendChatRecords(messages, &history.messages);
+            sendWire(conn, MessageType::CHAT_HISTORY_RESPONSE, history);
+            LOG_INFO << "Sent " << messages.size() << " group chat history messages to user " << fromUserId;
+            return;
+        }
+        
         // 转换为字符串
         Json::StreamWriterBuilder writer;
         std::string messagesJsonStr = Json::writeString(writer, Json::arrayValue);
@@ -952,11 +1100,11 @@ void ChatServer::handleGetChatHistory(const muduo::net::TcpConnectionPtr& conn,
                              ";groupId=" + std::to_string(groupId) +
                              ";messages=" + messagesJsonStr;
         
-        conn->send(response);
+        codec_.send(conn, response);
         LOG_INFO << "Sent " << messages.size() << " group chat history messages to user " << fromUserId;
     }
     else {
         LOG_ERROR << "Invalid chat type: " << type;
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid chat type");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid chat type");
     }
 }
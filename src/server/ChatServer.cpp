@@ -11,97 +11,145 @@
 #include <sstream>
 #include <regex>
 #include <unordered_set>
+#include "muduo/base/CountDownLatch.h"
+#include "CpuAffinity.h"
 
 // 使用C++11的std::placeholders
 using namespace std::placeholders;
 
+namespace {
+
+// 消息内容长度上限
+constexpr size_t kControlPayloadLimit = 4 * 1024;   // 登录、群组、好友等控制类消息
+constexpr size_t kChatPayloadLimit = 64 * 1024;     // 聊天消息
+
+// 默认I/O线程数量
+constexpr int kDefaultIoThreads = 4;
+
+// 阻塞任务线程池的默认配置
+constexpr int kDefaultWorkerThreads = 8;
+constexpr size_t kWorkerQueueSize = 10000;
+
+// 输出缓冲区采样间隔（秒）
+constexpr double kBufferedBytesSampleInterval = 1.0;
+
+
+} // namespace
+
+thread_local ChatServer::LoopState* ChatServer::t_loopState = nullptr;
+
+constexpr ChatServer::HandlerTable ChatServer::makeHandlerTable()
+{
+    HandlerTable table{};
+    
+    auto add = [&table](MessageType type, MessageHandler handler, const char* name,
+                        bool requiresLogin, bool blocking, size_t maxPayload) {
+        HandlerEntry& entry = table[static_cast<int>(type)];
+        entry.handler = handler;
+        entry.name = name;
+        entry.requiresLogin = requiresLogin;
+        entry.blocking = blocking;
+        entry.maxPayload = maxPayload;
+    };
+    
+    // 无需登录的消息
+    add(MessageType::LOGIN_REQUEST, &ChatServer::handleLogin, "LOGIN_REQUEST",
+        false, true, kControlPayloadLimit);
+    add(MessageType::HEARTBEAT_REQUEST, &ChatServer::handleHeartbeat, "HEARTBEAT_REQUEST",
+        false, false, kControlPayloadLimit);
+    add(MessageType::VERIFY_CODE_REQUEST, &ChatServer::handleVerifyCodeRequest, "VERIFY_CODE_REQUEST",
+        false, true, kControlPayloadLimit);
+    add(MessageType::REGISTER_REQUEST, &ChatServer::handleRegister, "REGISTER_REQUEST",
+        false, true, kControlPayloadLimit);
+    
+    // 需要登录的消息
+    add(MessageType::LOGOUT_REQUEST, &ChatServer::handleLogout, "LOGOUT_REQUEST",
+        true, true, kControlPayloadLimit);
+    add(MessageType::PRIVATE_CHAT, &ChatServer::handlePrivateChat, "PRIVATE_CHAT",
+        true, true, kChatPayloadLimit);
+    add(MessageType::GROUP_CHAT, &ChatServer::handleGroupChat, "GROUP_CHAT",
+        true, true, kChatPayloadLimit);
+    add(MessageType::CREATE_GROUP, &ChatServer::handleCreateGroup, "CREATE_GROUP",
+        true, true, kControlPayloadLimit);
+    add(MessageType::JOIN_GROUP, &ChatServer::handleJoinGroup, "JOIN_GROUP",
+        true, true, kControlPayloadLimit);
+    add(MessageType::LEAVE_GROUP, &ChatServer::handleLeaveGroup, "LEAVE_GROUP",
+        true, true, kControlPayloadLimit);
+    add(MessageType::GET_USER_LIST, &ChatServer::handleGetUserList, "GET_USER_LIST",
+        true, true, kControlPayloadLimit);
+    add(MessageType::GET_GROUP_LIST, &ChatServer::handleGetGroupList, "GET_GROUP_LIST",
+        true, true, kControlPayloadLimit);
+    add(MessageType::GET_GROUP_MEMBERS, &ChatServer::handleGetGroupMembers, "GET_GROUP_MEMBERS",
+        true, true, kControlPayloadLimit);
+    add(MessageType::GET_USER_FRIENDS, &ChatServer::handleGetUserFriends, "GET_USER_FRIENDS",
+        true, true, kControlPayloadLimit);
+    // ADD_FRIEND_REQUEST 与旧的ADD_FRIEND共用编号28，经handleAddFriend转发以保持兼容
+    add(MessageType::ADD_FRIEND_REQUEST, &ChatServer::handleAddFriend, "ADD_FRIEND_REQUEST",
+        true, true, kControlPayloadLimit);
+    add(MessageType::ACCEPT_FRIEND_REQUEST, &ChatServer::handleAcceptFriendRequest, "ACCEPT_FRIEND_REQUEST",
+        true, true, kControlPayloadLimit);
+    add(MessageType::REJECT_FRIEND_REQUEST, &ChatServer::handleRejectFriendRequest, "REJECT_FRIEND_REQUEST",
+        true, true, kControlPayloadLimit);
+    add(MessageType::GET_FRIEND_REQUESTS, &ChatServer::handleGetFriendRequests, "GET_FRIEND_REQUESTS",
+        true, true, kControlPayloadLimit);
+    add(MessageType::GET_CHAT_HISTORY, &ChatServer::handleGetChatHistory, "GET_CHAT_HISTORY",
+        true, true, kControlPayloadLimit);
+    add(MessageType::RECALL_MESSAGE, &ChatServer::handleRecallMessage, "RECALL_MESSAGE",
+        true, true, kControlPayloadLimit);
+    add(MessageType::MARK_MESSAGE_READ, &ChatServer::handleMarkMessageRead, "MARK_MESSAGE_READ",
+        true, true, kControlPayloadLimit);
+    add(MessageType::OFFLINE_ACK, &ChatServer::handleOfflineAck, "OFFLINE_ACK",
+        true, true, kControlPayloadLimit);
+    
+    // 改变会话登录状态的消息总是单独按到达顺序执行
+    for (MessageType type : {MessageType::LOGIN_REQUEST, MessageType::LOGOUT_REQUEST,
+                             MessageType::REGISTER_REQUEST}) {
+        table[static_cast<int>(type)].exclusive = true;
+    }
+    
+    // 聊天消息按采样率追踪
+    for (MessageType type : {MessageType::PRIVATE_CHAT, MessageType::GROUP_CHAT}) {
+        table[static_cast<int>(type)].traced = true;
+    }
+    
+    return table;
+}
+
+constexpr ChatServer::HandlerTable ChatServer::kHandlerTable = ChatServer::makeHandlerTable();
+
 ChatServer::ChatServer(muduo::net::EventLoop* loop, 
                      const muduo::net::InetAddress& listenAddr, 
-                     const std::string& nameArg)
-    : server_(loop, listenAddr, nameArg),
-      loop_(loop)
+                     const std::string& nameArg,
+                     AcceptMode acceptMode)
+    : server_(loop, listenAddr, nameArg,
+              acceptMode == AcceptMode::REUSE_PORT ? muduo::net::TcpServer::kReusePort
+                                                   : muduo::net::TcpServer::kNoReusePort),
+      acceptMode_(acceptMode),
+      listenAddr_(listenAddr),
+      codec_(std::bind(&ChatServer::onMessage, this, _1, _2, _3)),
+      loop_(loop),
+      workerPool_("WorkerPool", kWorkerQueueSize),
+      workerThreads_(kDefaultWorkerThreads),
+      ioThreads_(kDefaultIoThreads)
 {
-    // 注册连接回调
-    server_.setConnectionCallback(
-        std::bind(&ChatServer::onConnection, this, _1)
-    );
+    setupServer(server_);
     
-    // 注册消息回调
-    server_.setMessageCallback(
-        std::bind(&ChatServer::onMessage, this, _1, _2, _3)
-    );
+    // 各消息类型的处理时间直方图
+    for (int type = 0; type <= kMaxMessageType; ++type) {
+        if (kHandlerTable[type].handler) {
+            dispatchLatency_[type] = &MetricsRegistry::getInstance().latency("dispatch", kHandlerTable[type].name);
+        }
+    }
     
-    // 设置服务器线程数量 - 一个I/O线程，四个工作线程
-    server_.setThreadNum(4);
+    // 抓取指标时由 MetricsServer 所在线程调用
+    metricsCollectorId_ = MetricsRegistry::getInstance().addCollector(
+        std::bind(&ChatServer::collectMetrics, this, _1));
+    
+    // 每个I/O线程启动时创建自己的时间轮
+    server_.setThreadInitCallback(
+        std::bind(&ChatServer::onThreadInit, this, _1)
+    );
     
-    // 注册消息处理器
-    msgHandlerMap_[static_cast<int>(MessageType::LOGIN_REQUEST)] = 
-        std::bind(&ChatServer::handleLogin, this, _1, _2);
-        
-    msgHandlerMap_[static_cast<int>(MessageType::HEARTBEAT_REQUEST)] =
-        std::bind(&ChatServer::handleHeartbeat, this, _1, _2);
-        
-    msgHandlerMap_[static_cast<int>(MessageType::LOGOUT_REQUEST)] =
-        std::bind(&ChatServer::handleLogout, this, _1, _2);
-        
-    msgHandlerMap_[static_cast<int>(MessageType::VERIFY_CODE_REQUEST)] =
-        std::bind(&ChatServer::handleVerifyCodeRequest, this, _1, _2);
-        
-    msgHandlerMap_[static_cast<int>(MessageType::REGISTER_REQUEST)] =
-        std::bind(&ChatServer::handleRegister, this, _1, _2);
-        
-    // 注册聊天相关消息处理器
-    msgHandlerMap_[static_cast<int>(MessageType::PRIVATE_CHAT)] =
-        std::bind(&ChatServer::handlePrivateChat, this, _1, _2);
-        
-    msgHandlerMap_[static_cast<int>(MessageType::GROUP_CHAT)] =
-        std::bind(&ChatServer::handleGroupChat, this, _1, _2);
-        
-    msgHandlerMap_[static_cast<int>(MessageType::CREATE_GROUP)] =
-        std::bind(&ChatServer::handleCreateGroup, this, _1, _2);
-        
-    msgHandlerMap_[static_cast<int>(MessageType::JOIN_GROUP)] =
-        std::bind(&ChatServer::handleJoinGroup, this, _1, _2);
-        
-    msgHandlerMap_[static_cast<int>(MessageType::LEAVE_GROUP)] =
-        std::bind(&ChatServer::handleLeaveGroup, this, _1, _2);
-        
-    msgHandlerMap_[static_cast<int>(MessageType::GET_USER_LIST)] =
-        std::bind(&ChatServer::handleGetUserList, this, _1, _2);
-        
-    msgHandlerMap_[static_cast<int>(MessageType::GET_GROUP_LIST)] =
-        std::bind(&ChatServer::handleGetGroupList, this, _1, _2);
-        
-    msgHandlerMap_[static_cast<int>(MessageType::GET_GROUP_MEMBERS)] =
-        std::bind(&ChatServer::handleGetGroupMembers, this, _1, _2);
-        
-    msgHandlerMap_[static_cast<int>(MessageType::GET_USER_FRIENDS)] =
-        std::bind(&ChatServer::handleGetUserFriends, this, _1, _2);
-        
-    msgHandlerMap_[static_cast<int>(MessageType::ADD_FRIEND_REQUEST)] =
-        std::bind(&ChatServer::handleAddFriendRequest, this, _1, _2);
-        
-    msgHandlerMap_[static_cast<int>(MessageType::ACCEPT_FRIEND_REQUEST)] =
-        std::bind(&ChatServer::handleAcceptFriendRequest, this, _1, _2);
-        
-    msgHandlerMap_[static_cast<int>(MessageType::REJECT_FRIEND_REQUEST)] =
-        std::bind(&ChatServer::handleRejectFriendRequest, this, _1, _2);
-        
-    msgHandlerMap_[static_cast<int>(MessageType::GET_FRIEND_REQUESTS)] =
-        std::bind(&ChatServer::handleGetFriendRequests, this, _1, _2);
-        
-    // 保留旧的ADD_FRIEND处理器以兼容性 (使用数字28作为向后兼容)
-    msgHandlerMap_[28] = std::bind(&ChatServer::handleAddFriend, this, _1, _2);
-        
-    msgHandlerMap_[static_cast<int>(MessageType::GET_CHAT_HISTORY)] =
-        std::bind(&ChatServer::handleGetChatHistory, this, _1, _2);
-        
-    msgHandlerMap_[static_cast<int>(MessageType::RECALL_MESSAGE)] =
-        std::bind(&ChatServer::handleRecallMessage, this, _1, _2);
-        
-    msgHandlerMap_[static_cast<int>(MessageType::MARK_MESSAGE_READ)] =
-        std::bind(&ChatServer::handleMarkMessageRead, this, _1, _2);
-        
     // 初始化邮件服务
     EmailService::getInstance().init(
         "smtp.163.com",       // SMTP服务器
@@ -113,28 +161,236 @@ ChatServer::ChatServer(muduo::net::EventLoop* loop,
     );
 }
 
+ChatServer::~ChatServer()
+{
+    MetricsRegistry::getInstance().removeCollector(metricsCollectorId_);
+    
+    // 先停止工作线程，之后不会再有任务投递到I/O线程
+    workerPool_.stop();
+    watchdog_.stop();
+    
+    // 在各自的线程中销毁 REUSE_PORT 模式下的TCP服务器，再退出这些线程
+    for (auto& server : reusePortServers_) {
+        muduo::net::EventLoop* ioLoop = server->getLoop();
+        muduo::CountDownLatch latch(1);
+        ioLoop->runInLoop([&server, &latch]() {
+            server.reset();
+            latch.countDown();
+        });
+        latch.wait();
+    }
+    reusePortServers_.clear();
+    reusePortLoops_.reset();
+}
+
+void ChatServer::setupServer(muduo::net::TcpServer& server)
+{
+    // 注册连接回调
+    server.setConnectionCallback(
+        std::bind(&ChatServer::onConnection, this, _1)
+    );
+    
+    // 注册消息回调，由编解码器负责分帧
+    server.setMessageCallback(
+        std::bind(&ChatCodec::onMessage, &codec_, _1, _2, _3)
+    );
+    
+    // 输出缓冲区清空时继续发送离线消息
+    server.setWriteCompleteCallback(
+        std::bind(&ChatServer::onWriteComplete, this, _1)
+    );
+}
+
 void ChatServer::start()
 {
+    workerPool_.start(workerThreads_);
+    
+    if (acceptMode_ == AcceptMode::SINGLE_ACCEPTOR) {
+        // 主线程只接受连接，连接轮询分配给I/O线程
+        server_.setThreadNum(ioThreads_);
+    } else {
+        // 主线程和另外 ioThreads_ - 1 个I/O线程各自监听、处理自己接受的连接
+        server_.setThreadNum(0);
+    }
     server_.start();
     
-    // 启动心跳检查定时器
-    heartbeatTimerId_ = loop_->runEvery(HEARTBEAT_CHECK_INTERVAL, 
-                                       std::bind(&ChatServer::checkHeartbeats, this));
+    if (acceptMode_ == AcceptMode::REUSE_PORT) {
+        reusePortLoops_ = std::make_unique<muduo::net::EventLoopThreadPool>(loop_, server_.name() + "-io");
+        reusePortLoops_->setThreadNum(ioThreads_ - 1);
+        reusePortLoops_->start(std::bind(&ChatServer::onThreadInit, this, _1));
+        
+        // 每个线程一个绑定同一端口的TcpServer，线程数为0时连接留在该线程处理
+        // TcpServer::start 必须在所属线程中调用
+        for (muduo::net::EventLoop* ioLoop : reusePortLoops_->getAllLoops()) {
+            std::string name = server_.name() + "-" + std::to_string(reusePortServers_.size() + 1);
+            auto server = std::make_unique<muduo::net::TcpServer>(
+                ioLoop, listenAddr_, name, muduo::net::TcpServer::kReusePort);
+            setupServer(*server);
+            muduo::net::TcpServer* serverPtr = server.get();
+            ioLoop->runInLoop([serverPtr]() { serverPtr->start(); });
+            reusePortServers_.push_back(std::move(server));
+        }
+    }
+    
+    watchdog_.start();
     
-    LOG_INFO << "ChatServer started on " << server_.ipPort();
-    LOG_INFO << "Heartbeat check started with interval " << HEARTBEAT_CHECK_INTERVAL 
-             << "s and timeout " << HEARTBEAT_TIMEOUT << "s";
+    LOG_INFO << "ChatServer started on " << server_.ipPort()
+             << (acceptMode_ == AcceptMode::REUSE_PORT ? " with SO_REUSEPORT acceptors" : "")
+             << (codec_.coalescing() ? " with write coalescing" : "");
+    LOG_INFO << "Heartbeat check started with interval " << idleTick_ 
+             << "s and timeout " << idleTimeout_ << "s";
 }
 
 void ChatServer::stop()
 {
-    // 取消心跳检查定时器
-    loop_->cancel(heartbeatTimerId_);
-    
-    // 关闭服务器
+    // 由信号处理函数调用，只让主事件循环退出，统计在 logStats 中输出
     server_.getLoop()->quit();
+}
+
+void ChatServer::logStats() const
+{
+    // 输出发送统计
+    ChatCodec::WriteStats stats = codec_.writeStats();
+    LOG_INFO << "Write stats: sends=" << stats.sends << " flushes=" << stats.flushes
+             << " writes=" << stats.writes << " bytes=" << stats.bytes
+             << " bytesPerWrite=" << (stats.writes > 0 ? stats.bytes / stats.writes : 0);
+    
+    // 输出各消息类型的压缩率和平均压缩耗时
+    for (int type = 0; type <= ChatCodec::kMaxStatsType; ++type) {
+        ChatCodec::CompressionStats compression = codec_.compressionStats(type);
+        uint64_t frames = compression.compressed + compression.incompressible;
+        if (frames == 0) {
+            continue;
+        }
+        LOG_INFO << "Compression stats: type=" << type << " frames=" << frames
+                 << " incompressible=" << compression.incompressible
+                 << " bytesIn=" << compression.bytesIn << " bytesOut=" << compression.bytesOut
+                 << " ratio=" << static_cast<double>(compression.bytesOut) / static_cast<double>(compression.bytesIn)
+                 << " usPerFrame=" << static_cast<double>(compression.cpuNanos) / 1000.0 / static_cast<double>(frames);
+    }
+    
+    // 输出各消息类型和后端调用的延迟分位数
+    LOG_INFO << "Operation latency:\n" << MetricsRegistry::getInstance().latencyReport();
+    
+    // 输出各I/O线程的定时器延迟
+    std::vector<LoopStats> loops = loopStats();
+    for (size_t i = 0; i < loops.size(); ++i) {
+        LOG_INFO << "Loop " << i << " timer lag: p50Us=" << loops[i].timerLag.percentile(0.5)
+                 << " p99Us=" << loops[i].timerLag.percentile(0.99) << " maxUs=" << loops[i].timerLag.max
+                 << " stalls=" << loops[i].stalls;
+    }
+}
+
+void ChatServer::setIoThreads(int numThreads)
+{
+    if (numThreads <= 0) {
+        LOG_WARN << "Invalid I/O thread count " << numThreads << ", keeping " << ioThreads_;
+        return;
+    }
+    ioThreads_ = numThreads;
+}
+
+void ChatServer::setWorkerThreads(int numThreads)
+{
+    if (numThreads <= 0) {
+        LOG_WARN << "Invalid worker thread count " << numThreads << ", keeping " << workerThreads_;
+        return;
+    }
+    workerThreads_ = numThreads;
+}
+
+void ChatServer::setCompression(bool enabled, size_t threshold)
+{
+    compressionEnabled_ = enabled;
+    codec_.setCompressionThreshold(threshold);
+}
+
+void ChatServer::setMaxInFlightRequests(int maxInFlight)
+{
+    if (maxInFlight <= 0) {
+        LOG_WARN << "Invalid max in-flight requests " << maxInFlight << ", keeping " << maxInFlightPerSession_;
+        return;
+    }
+    maxInFlightPerSession_ = maxInFlight;
+}
+
+void ChatServer::setIdleTimeout(int timeoutSeconds, int tickSeconds)
+{
+    if (timeoutSeconds <= 0 || tickSeconds <= 0 || tickSeconds > timeoutSeconds) {
+        LOG_WARN << "Invalid idle timeout " << timeoutSeconds << "s with tick " << tickSeconds
+                 << "s, keeping " << idleTimeout_ << "s/" << idleTick_ << "s";
+        return;
+    }
+    idleTimeout_ = timeoutSeconds;
+    idleTick_ = tickSeconds;
+}
+
+void ChatServer::setOutputWaterMarks(size_t highWaterMark, size_t lowWaterMark)
+{
+    if (highWaterMark == 0 || lowWaterMark >= highWaterMark) {
+        LOG_WARN << "Invalid output water marks " << highWaterMark << "/" << lowWaterMark
+                 << ", keeping " << highWaterMark_ << "/" << lowWaterMark_;
+        return;
+    }
+    highWaterMark_ = highWaterMark;
+    lowWaterMark_ = lowWaterMark;
+}
+
+std::vector<ChatServer::LoopStats> ChatServer::loopStats() const
+{
+    std::vector<LoopStats> result;
+    std::lock_guard<std::mutex> lock(loopStatesMutex_);
+    result.reserve(loopStates_.size());
+    for (const auto& state : loopStates_) {
+        LoopStats stats;
+        stats.connections = state->connectionCount.load(std::memory_order_relaxed);
+        stats.bufferedBytes = state->bufferedBytes.load(std::memory_order_relaxed);
+        stats.highWaterEvents = state->highWaterEvents.load(std::memory_order_relaxed);
+        stats.spilledMessages = state->spilledMessages.load(std::memory_order_relaxed);
+        stats.droppedMessages = state->droppedMessages.load(std::memory_order_relaxed);
+        stats.slowConsumerDisconnects = state->slowConsumerDisconnects.load(std::memory_order_relaxed);
+        if (state->probe) {
+            stats.timerLag = state->probe->timerLag.snapshot();
+            stats.stalls = state->probe->stalls.load(std::memory_order_relaxed);
+        }
+        result.push_back(stats);
+    }
+    return result;
+}
+
+Histogram::Snapshot ChatServer::dispatchLatency(MessageType type) const
+{
+    int index = static_cast<int>(type);
+    if (index < 0 || index > kMaxMessageType || !dispatchLatency_[index]) {
+        return Histogram::Snapshot();
+    }
+    return dispatchLatency_[index]->snapshot();
+}
+
+void ChatServer::onThreadInit(muduo::net::EventLoop* loop)
+{
+    // 按启动顺序把I/O线程绑定到各自的CPU
+    int index = nextLoopIndex_.fetch_add(1);
+    if (!ioCpus_.empty()) {
+        int cpu = ioCpus_[index % ioCpus_.size()];
+        if (CpuAffinity::pinCurrentThread(cpu)) {
+            LOG_INFO << "I/O loop " << index << " pinned to CPU " << cpu
+                     << " (NUMA node " << CpuAffinity::numaNodeOfCpu(cpu) << ")";
+        }
+    }
+    
+    auto state = std::make_unique<LoopState>();
+    state->timingWheel = std::make_unique<TimingWheel>(loop, idleTimeout_, idleTick_);
+    state->timingWheel->start();
+    state->probe = watchdog_.watch(loop);
+    
+    // 定期采样本线程的输出缓冲区总量
+    LoopState* statePtr = state.get();
+    loop->runEvery(kBufferedBytesSampleInterval, std::bind(&ChatServer::sampleBufferedBytes, statePtr));
+    t_loopState = statePtr;
     
-    LOG_INFO << "ChatServer stopped";
+    std::lock_guard<std::mutex> lock(loopStatesMutex_);
+    loopStates_.push_back(std::move(state));
 }
 
 void ChatServer::onConnection(const muduo::net::TcpConnectionPtr& conn)
@@ -144,95 +400,333 @@ void ChatServer::onConnection(const muduo::net::TcpConnectionPtr& conn)
     {
         LOG_INFO << "Client connected: " << conn->peerAddress().toIpPort();
         
-        // 记录连接最后活动时间
-        connectionLastActiveTime_[conn] = muduo::Timestamp::now();
+        // 绑定连接会话并加入空闲连接时间轮
+        SessionPtr session = std::make_shared<Session>();
+        if (t_loopState) {
+            session->idleEntry = t_loopState->timingWheel->add(conn);
+            t_loopState->connections.insert(conn);
+            t_loopState->connectionCount.store(t_loopState->connections.size(), std::memory_order_relaxed);
+        }
+        conn->setContext(session);
+        
+        // 输出缓冲区超过高水位时按慢速客户端策略处理
+        conn->setHighWaterMarkCallback(
+            std::bind(&ChatServer::onHighWaterMark, this, _1, _2), highWaterMark_);
     }
     else
     {
         LOG_INFO << "Client disconnected: " << conn->peerAddress().toIpPort();
         
-        // 查找断开的连接是否为已登录用户
-        for (auto it = userConnectionMap_.begin(); it != userConnectionMap_.end(); ++it)
+        // 断开的连接为已登录用户时，在工作线程中更新用户状态为离线（数据库和Redis）
+        int userId = unbindUser(conn);
+        if (userId != -1)
         {
-            if (it->second == conn)
-            {
-                // 用户断开连接，更新用户状态为离线（数据库和Redis）
-                UserModel::getInstance().updateUserOnlineState(it->first, false);
-                RedisService::getInstance().setUserOnline(it->first, false);
-                
-                // 从用户连接映射表移除
-                userConnectionMap_.erase(it);
-                break;
-            }
+            submitDisconnectCleanup(conn, userId);
         }
         
-        // 从活动时间映射表中移除
-        connectionLastActiveTime_.erase(conn);
+        // 从连接列表中移除
+        if (t_loopState) {
+            t_loopState->connections.erase(conn);
+            t_loopState->connectionCount.store(t_loopState->connections.size(), std::memory_order_relaxed);
+        }
     }
 }
 
 void ChatServer::onMessage(const muduo::net::TcpConnectionPtr& conn,
-                         muduo::net::Buffer* buffer,
+                         const ChatCodec::Frame& frame,
                          muduo::Timestamp /* time */)
 {
-    // 更新连接最后活动时间
-    connectionLastActiveTime_[conn] = muduo::Timestamp::now();
+    const int msgType = frame.type;
+    const bool known = msgType >= 0 && msgType <= kMaxMessageType && kHandlerTable[msgType].handler;
     
-    // 提取消息内容
-    std::string message = buffer->retrieveAllAsString();
+    // 处理期间若事件循环无响应，看门狗报告正在处理的消息类型
+    LoopWatchdog::Scope scope(t_loopState ? t_loopState->probe : nullptr,
+                              known ? kHandlerTable[msgType].name : "onMessage");
+    int64_t start = LoopWatchdog::nowMicros();
     
-    // 这里简化处理，暂时直接处理分隔符格式的消息
-    // 格式: msgType:key1=value1;key2=value2;...
-    std::stringstream ss(message);
-    std::string msgTypeStr;
-    std::getline(ss, msgTypeStr, ':');
+    handleFrame(conn, frame);
     
-    try {
-        int msgType = std::stoi(msgTypeStr);
+    if (known) {
+        messagesReceived_[msgType].add();
+        dispatchLatency_[msgType]->record(static_cast<uint64_t>(LoopWatchdog::nowMicros() - start));
+    }
+}
+
+void ChatServer::handleFrame(const muduo::net::TcpConnectionPtr& conn,
+                             const ChatCodec::Frame& frame)
+{
+    // 连接有活动，移到时间轮最新的格子
+    Session* session = getSession(conn);
+    if (session) {
+        if (t_loopState) {
+            t_loopState->timingWheel->touch(session->idleEntry);
+        }
+        ++session->messagesReceived;
+        session->bytesReceived += frame.payload.size();
+    }
+    
+    if (frame.type < 0) {
+        LOG_ERROR << "Invalid message format from " << conn->peerAddress().toIpPort();
         
-        // 解析消息内容到键值对
-        std::string content;
-        std::getline(ss, content);
+        // 发送错误消息给客户端
+        std::string errorMsg = std::to_string(static_cast<int>(MessageType::ERROR)) + 
+                               ":errorMsg=Invalid message format";
+        codec_.send(conn, errorMsg);
+        return;
+    }
+    
+    // 查表分发
+    const int msgType = frame.type;
+    const HandlerEntry* entry = (msgType <= kMaxMessageType) ? &kHandlerTable[msgType] : nullptr;
+    if (!entry || !entry->handler) {
+        LOG_ERROR << "Unknown message type: " << msgType;
         
-        // 创建一个简单的键值对集合
-        std::unordered_map<std::string, std::string> msgData;
+        // 发送错误消息给客户端
+        std::string errorMsg = std::to_string(static_cast<int>(MessageType::ERROR)) + 
+                               ":errorMsg=Unknown message type";
+        codec_.send(conn, errorMsg);
+        return;
+    }
+    
+    if (frame.payload.size() > static_cast<int>(entry->maxPayload)) {
+        LOG_ERROR << entry->name << " payload too large: " << frame.payload.size() << " bytes";
         
-        std::stringstream contentStream(content);
-        std::string item;
-        while (std::getline(contentStream, item, ';')) {
-            std::size_t pos = item.find('=');
-            if (pos != std::string::npos) {
-                std::string key = item.substr(0, pos);
-                std::string value = item.substr(pos + 1);
-                msgData[key] = value;
-            }
+        std::string errorMsg = std::to_string(static_cast<int>(MessageType::ERROR)) + 
+                               ":errorMsg=Message too large";
+        codec_.send(conn, errorMsg);
+        return;
+    }
+    
+    // 非阻塞消息直接在I/O线程处理，payload仍引用输入缓冲区
+    std::string_view payload(frame.payload.data(), frame.payload.size());
+    if (!entry->blocking) {
+        Request msgData;
+        if (!parseRequest(conn, payload, frame.flags, &msgData)) {
+            return;
+        }
+        RequestScope scope(conn.get(), requestRid(conn, msgData));
+        dispatch(conn, *entry, msgData);
+        return;
+    }
+    
+    // 阻塞消息复制payload后在副本上解析一次，工作线程直接使用解析结果
+    auto request = std::make_shared<BlockingRequest>();
+    request->payload.assign(payload.data(), payload.size());
+    if (!parseRequest(conn, request->payload, frame.flags, &request->fields)) {
+        return;
+    }
+    request->rid = requestRid(conn, request->fields);
+    
+    // 带 rid 的请求可以与同一连接的其他请求并发执行
+    bool exclusive = entry->exclusive || request->rid.empty();
+    
+    // 被采样或客户端要求追踪（trace=1）的聊天消息分配 trace id
+    uint64_t traceId = 0;
+    if (entry->traced) {
+        auto traceIt = request->fields.find("trace");
+        traceId = Tracer::getInstance().maybeStart(traceIt != request->fields.end() && traceIt->second == "1");
+        if (traceId) {
+            LOG_INFO << "Tracing " << entry->name << " from " << conn->peerAddress().toIpPort()
+                     << " as trace " << Tracer::format(traceId);
         }
+    }
+    Tracer::Scope traceScope(traceId);
+    Tracer::Span span("receive", entry->name);
+    
+    // 排队失败的响应同样回显 rid
+    RequestScope scope(conn.get(), request->rid);
+    submitBlocking(conn, *entry, std::move(request), exclusive);
+}
+
+bool ChatServer::parseRequest(const muduo::net::TcpConnectionPtr& conn,
+                              std::string_view payload,
+                              uint16_t flags,
+                              Request* request)
+{
+    // 消息内容格式: key1=value1;key2=value2;... 或二进制 Fields 消息，直接在缓冲区上解析
+    if (!request->parse(payload, flags & ChatCodec::kFlagWire)) {
+        LOG_ERROR << "Malformed message or too many fields from " << conn->peerAddress().toIpPort();
         
-        // 根据消息类型进行处理
-        auto it = msgHandlerMap_.find(msgType);
-        if (it != msgHandlerMap_.end()) {
-            // 调用对应的消息处理函数
-            it->second(conn, msgData);
-        } else {
-            LOG_ERROR << "Unknown message type: " << msgType;
-            
-            // 发送错误消息给客户端
-            std::string errorMsg = std::to_string(static_cast<int>(MessageType::ERROR)) + 
-                                   ":errorMsg=Unknown message type";
-            conn->send(errorMsg);
+        std::string errorMsg = std::to_string(static_cast<int>(MessageType::ERROR)) + 
+                               ":errorMsg=Invalid message format";
+        codec_.send(conn, errorMsg);
+        return false;
+    }
+    return true;
+}
+
+std::string_view ChatServer::requestRid(const muduo::net::TcpConnectionPtr& conn, const Request& request)
+{
+    auto ridIt = request.find("rid");
+    if (ridIt == request.end()) {
+        return std::string_view();
+    }
+    if (!RequestScope::isValidRid(ridIt->second)) {
+        LOG_WARN << "Ignored invalid rid from " << conn->peerAddress().toIpPort();
+        return std::string_view();
+    }
+    return ridIt->second;
+}
+
+void ChatServer::dispatch(const muduo::net::TcpConnectionPtr& conn,
+                          const HandlerEntry& entry,
+                          const Request& msgData)
+{
+    // 统一的登录检查，在执行时进行，保证排在登录请求之后的消息能看到登录结果
+    int userId = -1;
+    if (entry.requiresLogin) {
+        userId = getUserIdByConnection(conn);
+        if (userId == -1) {
+            LOG_ERROR << "User not logged in. Cannot handle " << entry.name;
+            codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + 
+                              ":message=You must be logged in to perform this operation");
+            return;
         }
+    }
+    
+    try {
+        // 调用对应的消息处理函数
+        (this->*(entry.handler))(conn, userId, msgData);
     } catch (const std::exception& e) {
         LOG_ERROR << "Invalid message format: " << e.what();
         
         // 发送错误消息给客户端
         std::string errorMsg = std::to_string(static_cast<int>(MessageType::ERROR)) + 
                                ":errorMsg=Invalid message format";
-        conn->send(errorMsg);
+        codec_.send(conn, errorMsg);
     }
 }
 
+void ChatServer::submitBlocking(const muduo::net::TcpConnectionPtr& conn,
+                                const HandlerEntry& entry,
+                                BlockingRequestPtr request,
+                                bool exclusive)
+{
+    Session* session = getSession(conn);
+    if (!session) {
+        return;
+    }
+    
+    if (session->pendingTasks.size() >= kMaxPendingTasksPerSession) {
+        rejectBusy(conn, entry);
+        return;
+    }
+    
+    // 被追踪的消息记录排队时间，并在工作线程中继续追踪
+    const HandlerEntry* handlerEntry = &entry;
+    const uint64_t traceId = Tracer::current();
+    const int64_t queuedAt = traceId ? Tracer::nowMicros() : 0;
+    std::string rid(request->rid);
+    WorkerPool::Task task = [this, conn, handlerEntry, traceId, queuedAt, request = std::move(request)]() {
+        if (traceId) {
+            Tracer::getInstance().record(traceId, "queue", handlerEntry->name, queuedAt, Tracer::nowMicros() - queuedAt);
+        }
+        Tracer::Scope traceScope(traceId);
+        Tracer::Span span("handler", handlerEntry->name);
+        RequestScope scope(conn.get(), request->rid);
+        dispatch(conn, *handlerEntry, request->fields);
+    };
+    session->pendingTasks.push_back(Session::PendingTask{std::move(task), exclusive, false, std::move(rid)});
+    schedulePendingTasks(conn);
+}
+
+void ChatServer::schedulePendingTasks(const muduo::net::TcpConnectionPtr& conn)
+{
+    Session* session = getSession(conn);
+    if (!session) {
+        return;
+    }
+    
+    while (!session->pendingTasks.empty()) {
+        // 单独执行的任务需要等待之前的任务全部完成，也阻止之后的任务开始
+        const Session::PendingTask& next = session->pendingTasks.front();
+        if (session->exclusiveRunning ||
+            (next.exclusive && session->inFlightTasks > 0) ||
+            session->inFlightTasks >= maxInFlightPerSession_) {
+            return;
+        }
+        
+        bool exclusive = next.exclusive;
+        bool required = next.required;
+        std::function<void()> body = std::move(session->pendingTasks.front().task);
+        std::string rid = std::move(session->pendingTasks.front().rid);
+        session->pendingTasks.pop_front();
+        
+        // 完成后回到连接所属线程，启动该连接的后续任务
+        WorkerPool::Task task = [this, conn, exclusive, body = std::move(body)]() {
+            body();
+            conn->getLoop()->runInLoop(std::bind(&ChatServer::onBlockingTaskDone, this, conn, exclusive));
+        };
+        bool submitted = required ? workerPool_.submit(task) : workerPool_.trySubmit(std::move(task));
+        if (!submitted) {
+            if (required) {
+                // 只在线程池已停止（服务器退出）时发生，直接在本线程执行，
+                // 完成回调同样在本线程中立即执行并继续调度后续任务
+                ++session->inFlightTasks;
+                session->exclusiveRunning = exclusive;
+                task();
+                return;
+            }
+            LOG_WARN << "Worker queue full, dropped pending request from " << conn->peerAddress().toIpPort();
+            RequestScope scope(conn.get(), rid);
+            codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + 
+                              ":errorMsg=Server busy, please retry later");
+            continue;
+        }
+        
+        ++session->inFlightTasks;
+        session->exclusiveRunning = exclusive;
+    }
+}
+
+void ChatServer::submitDisconnectCleanup(const muduo::net::TcpConnectionPtr& conn, int userId)
+{
+    Session* session = getSession(conn);
+    if (!session) {
+        return;
+    }
+    
+    auto cleanup = [this, conn, userId]() {
+        // 游标只向前推进，用户已在其他连接重新登录时同样保存本连接的投递进度
+        RedisService::getInstance().saveGroupCursors(userId, takeGroupCursors(conn));
+        
+        // 用户已在其他连接重新登录时不再置为离线
+        if (sessions_.find(userId)) {
+            return;
+        }
+        UserModel::getInstance().updateUserOnlineState(userId, false);
+        RedisService::getInstance().setUserOnline(userId, false);
+    };
+    session->pendingTasks.push_back(Session::PendingTask{std::move(cleanup), true, true, std::string()});
+    schedulePendingTasks(conn);
+}
+
+void ChatServer::onBlockingTaskDone(const muduo::net::TcpConnectionPtr& conn, bool exclusive)
+{
+    Session* session = getSession(conn);
+    if (!session) {
+        return;
+    }
+    
+    --session->inFlightTasks;
+    if (exclusive) {
+        session->exclusiveRunning = false;
+    }
+    schedulePendingTasks(conn);
+}
+
+void ChatServer::rejectBusy(const muduo::net::TcpConnectionPtr& conn, const HandlerEntry& entry)
+{
+    LOG_WARN << "Rejected " << entry.name << " from " << conn->peerAddress().toIpPort()
+             << ", worker queue " << workerPool_.queueSize() << "/" << workerPool_.maxQueueSize();
+    
+    std::string errorMsg = std::to_string(static_cast<int>(MessageType::ERROR)) + 
+                           ":errorMsg=Server busy, please retry later";
+    codec_.send(conn, errorMsg);
+}
+
 void ChatServer::handleLogin(const muduo::net::TcpConnectionPtr& conn, 
-                         const std::unordered_map<std::string, std::string>& msg)
+                         int /* userId */, const Request& msg)
 {
     auto usernameIt = msg.find("username");
     auto passwordIt = msg.find("password");
@@ -241,12 +735,12 @@ void ChatServer::handleLogin(const muduo::net::TcpConnectionPtr& conn,
         LOG_ERROR << "Invalid login request: missing username or password";
         std::string errorMsg = std::to_string(static_cast<int>(MessageType::LOGIN_RESPONSE)) + 
                              ":status=1;errorMsg=Missing username or password";
-        conn->send(errorMsg);
+        codec_.send(conn, errorMsg);
         return;
     }
     
-    std::string username = usernameIt->second;
-    std::string password = passwordIt->second;
+    std::string username(usernameIt->second);
+    std::string password(passwordIt->second);
     
     LOG_INFO << "Login request from user: " << username;
     
@@ -258,23 +752,35 @@ void ChatServer::handleLogin(const muduo::net::TcpConnectionPtr& conn,
         
         if (user)
         {
-            // 检查用户是否已经在其他客户端登录
-            auto it = userConnectionMap_.find(user->getId());
-            if (it != userConnectionMap_.end())
-            {
-                // 用户已经在其他客户端登录，需要通知之前的客户端被踢下线
-                std::string kickOutMsg = std::to_string(static_cast<int>(MessageType::ERROR)) + 
-                                      ":errorMsg=Your account logged in elsewhere";
-                
-                it->second->send(kickOutMsg);
-                
-                // 更新连接映射
-                it->second = conn;
+            // 绑定连接与用户，其他客户端上的同一账号会被踢下线；连接已断开时不再置为在线
+            if (!bindUser(conn, *user)) {
+                LOG_INFO << "Connection of user " << username << " closed during login";
+                return;
+            }
+            
+            // 二进制帧模式的客户端可以声明wire=1，之后的响应（包括登录响应）使用二进制消息
+            auto wireIt = msg.find("wire");
+            bool wireFormat = false;
+            Session* session = getSession(conn);
+            if (session && wireIt != msg.end() && wireIt->second == "1") {
+                wireFormat = session->mode == ChatCodec::Mode::BINARY;
+                session->wireFormat.store(wireFormat);
             }
-            else
-            {
-                // 添加用户连接映射
-                userConnectionMap_[user->getId()] = conn;
+            
+            // compress 为客户端支持的压缩算法列表，以逗号分隔，目前只支持deflate
+            auto compressIt = msg.find("compress");
+            bool compressed = false;
+            if (session && compressionEnabled_ && compressIt != msg.end() &&
+                session->mode == ChatCodec::Mode::BINARY) {
+                std::string_view algorithms = compressIt->second;
+                while (!algorithms.empty() && !compressed) {
+                    size_t comma = algorithms.find(',');
+                    compressed = algorithms.substr(0, comma) == "deflate";
+                    algorithms.remove_prefix(comma == std::string_view::npos ? algorithms.size() : comma + 1);
+                }
+                if (compressed) {
+                    session->compression.store(ChatCodec::Compression::DEFLATE);
+                }
             }
             
             // 更新用户在线状态在Redis中
@@ -293,7 +799,17 @@ void ChatServer::handleLogin(const muduo::net::TcpConnectionPtr& conn,
                 response << ";avatar=" << user->getAvatar();
             }
             
-            // 检查并发送离线消息
+            if (wireFormat) {
+                response << ";wire=1";
+            }
+            if (compressed) {
+                response << ";compress=deflate";
+            }
+            
+            // 大群中游标之后的消息先转入离线队列，再检查离线消息数量。
+            // 绑定之后到达的大群消息已暂存在会话中，序号不超过转入部分的不再推送
+            std::unordered_map<int, long long> pulled;
+            RedisService::getInstance().pullGroupBacklog(user->getId(), &pulled);
             int offlineMsgCount = RedisService::getInstance().getOfflineMessageCount(user->getId());
             if (offlineMsgCount > 0) {
                 response << ";offlineMsgCount=" << offlineMsgCount;
@@ -301,61 +817,19 @@ void ChatServer::handleLogin(const muduo::net::TcpConnectionPtr& conn,
             }
             
             LOG_INFO << "User " << username << " logged in successfully";
-            conn->send(response.str());
+            codec_.send(conn, response.str());
+            conn->getLoop()->runInLoop([this, conn, pulled = std::move(pulled)]() mutable {
+                startGroupDelivery(conn, std::move(pulled));
+            });
             
-            // 发送离线消息
+            // 登录响应之后分批发送离线消息，声明offlineAck=1的客户端确认后才删除
+            auto ackIt = msg.find("offlineAck");
+            bool needAck = ackIt != msg.end() && ackIt->second == "1";
+            if (session) {
+                session->offlineAck.store(needAck);
+            }
             if (offlineMsgCount > 0) {
-                // 延迟一小段时间后发送离线消息，确保客户端已准备好接收
-                std::this_thread::sleep_for(std::chrono::milliseconds(500));
-                
-                std::vector<std::string> offlineMessages = RedisService::getInstance().getOfflineMessages(user->getId());
-                for (const auto& msgJson : offlineMessages) {
-                    try {
-                        // 解析JSON消息
-                        Json::Value msg;
-                        Json::Reader reader;
-                        if (reader.parse(msgJson, msg)) {
-                            std::string type = msg["type"].asString();
-                            
-                            if (type == "private") {
-                                int fromUserId = msg["from"].asInt();
-                                auto fromUser = UserModel::getInstance().getUserById(fromUserId);
-                                if (!fromUser) continue;
-                                
-                                // 构建私聊消息
-                                std::string privateMessage = std::to_string(static_cast<int>(MessageType::PRIVATE_CHAT)) + 
-                                                  ":fromUserId=" + std::to_string(fromUserId) + 
-                                                  ";fromUsername=" + fromUser->getUsername() + 
-                                                  ";content=" + msg["content"].asString() + 
-                                                  ";timestamp=" + msg["timestamp"].asString() +
-                                                  ";offline=true";
-                                
-                                conn->send(privateMessage);
-                            } 
-                            else if (type == "group") {
-                                int fromUserId = msg["from"].asInt();
-                                int groupId = msg["group"].asInt();
-                                auto fromUser = UserModel::getInstance().getUserById(fromUserId);
-                                if (!fromUser) continue;
-                                
-                                // 构建群聊消息
-                                std::string groupMessage = std::to_string(static_cast<int>(MessageType::GROUP_CHAT)) + 
-                                                ":groupId=" + std::to_string(groupId) + 
-                                                ";fromUserId=" + std::to_string(fromUserId) + 
-                                                ";fromUsername=" + fromUser->getUsername() + 
-                                                ";content=" + msg["content"].asString() + 
-                                                ";timestamp=" + msg["timestamp"].asString() +
-                                                ";offline=true";
-                                
-                                conn->send(groupMessage);
-                            }
-                        }
-                    } catch (const std::exception& e) {
-                        LOG_ERROR << "Failed to process offline message: " << e.what();
-                    }
-                }
-                
-                LOG_INFO << "Sent " << offlineMessages.size() << " offline messages to user " << username;
+                startOfflineSync(conn, user->getId(), offlineMsgCount, needAck, true);
             }
         }
         else
@@ -363,7 +837,7 @@ void ChatServer::handleLogin(const muduo::net::TcpConnectionPtr& conn,
             // 用户信息获取失败
             std::string errorMsg = std::to_string(static_cast<int>(MessageType::LOGIN_RESPONSE)) + 
                                 ":status=1;errorMsg=System error, please try again later";
-            conn->send(errorMsg);
+            codec_.send(conn, errorMsg);
             
             LOG_ERROR << "Failed to retrieve user information for " << username;
         }
@@ -373,102 +847,62 @@ void ChatServer::handleLogin(const muduo::net::TcpConnectionPtr& conn,
         // 登录验证失败
         std::string errorMsg = std::to_string(static_cast<int>(MessageType::LOGIN_RESPONSE)) + 
                             ":status=1;errorMsg=Invalid username or password";
-        conn->send(errorMsg);
+        codec_.send(conn, errorMsg);
         
         LOG_INFO << "Login failed for user: " << username;
     }
 }
 
 void ChatServer::handleLogout(const muduo::net::TcpConnectionPtr& conn, 
-                          const std::unordered_map<std::string, std::string>& msg)
+                          int userId, const Request& /* msg */)
 {
-    auto userIdIt = msg.find("userId");
-    
-    if (userIdIt == msg.end()) {
-        LOG_ERROR << "Invalid logout request: missing userId";
-        std::string errorMsg = std::to_string(static_cast<int>(MessageType::LOGOUT_RESPONSE)) + 
-                             ":status=1;errorMsg=Missing userId";
-        conn->send(errorMsg);
-        return;
-    }
-    
-    int userId = std::stoi(userIdIt->second);
-    
+    // 登出的用户以连接上已登录的身份为准，忽略消息中的userId
     LOG_INFO << "Logout request from user: " << userId;
     
+    // 先解除连接与用户的绑定，之后不再向本连接推送，再按已投递的位置保存大群游标
+    unbindUser(conn);
+    RedisService::getInstance().saveGroupCursors(userId, takeGroupCursors(conn));
+    
     // 更新用户在线状态在数据库中
     UserModel::getInstance().updateUserOnlineState(userId, false);
     
     // 更新用户在线状态在Redis中
     RedisService::getInstance().setUserOnline(userId, false);
     
-    // 从映射表中移除
-    userConnectionMap_.erase(userId);
-    
     // 创建并发送响应消息
     std::string response = std::to_string(static_cast<int>(MessageType::LOGOUT_RESPONSE)) + 
                         ":status=0";  // 0表示成功
-    conn->send(response);
+    codec_.send(conn, response);
     
     LOG_INFO << "User " << userId << " logged out successfully";
 }
 
 void ChatServer::handleHeartbeat(const muduo::net::TcpConnectionPtr& conn, 
-                              const std::unordered_map<std::string, std::string>& /* msg */)
+                              int /* userId */, const Request& /* msg */)
 {
-    // 更新连接最后活动时间
-    connectionLastActiveTime_[conn] = muduo::Timestamp::now();
-    
     // 心跳响应格式：7:timestamp=当前时间戳
     std::string response = std::to_string(static_cast<int>(MessageType::HEARTBEAT_RESPONSE)) +
                           ":timestamp=" + 
                           std::to_string(muduo::Timestamp::now().microSecondsSinceEpoch());
     
-    conn->send(response);
+    codec_.send(conn, response);
     
     LOG_DEBUG << "Heartbeat from " << conn->peerAddress().toIpPort();
 }
 
-void ChatServer::checkHeartbeats()
-{
-    muduo::Timestamp now = muduo::Timestamp::now();
-    
-    LOG_DEBUG << "Checking heartbeats for " << connectionLastActiveTime_.size() << " connections";
-    
-    // 检查所有连接的最后活动时间
-    auto it = connectionLastActiveTime_.begin();
-    while (it != connectionLastActiveTime_.end()) {
-        muduo::Timestamp lastActive = it->second;
-        double inactive = muduo::timeDifference(now, lastActive);
-        
-        // 如果超时，关闭连接
-        if (inactive > HEARTBEAT_TIMEOUT) {
-            LOG_INFO << "Connection timeout: " << it->first->peerAddress().toIpPort()
-                     << ", inactive for " << inactive << " seconds";
-            
-            // 强制关闭连接 - 这将触发 onConnection 回调，进行资源清理
-            it->first->forceClose();
-            
-            // 移除这个连接记录
-            it = connectionLastActiveTime_.erase(it);
-        } else {
-            ++it;
-        }
-    }
-}
 // 处理验证码请求
 void ChatServer::handleVerifyCodeRequest(const muduo::net::TcpConnectionPtr& conn, 
-                                      const std::unordered_map<std::string, std::string>& msg) {
+                                      int /* userId */, const Request& msg) {
     auto emailIt = msg.find("email");
     if (emailIt == msg.end()) {
         LOG_ERROR << "Invalid verification code request: missing email";
         std::string errorMsg = std::to_string(static_cast<int>(MessageType::ERROR)) + 
                              ":errorMsg=Missing email address";
-        conn->send(errorMsg);
+        codec_.send(conn, errorMsg);
         return;
     }
     
-    std::string email = emailIt->second;
+    std::string email(emailIt->second);
     LOG_INFO << "Verification code requested for email: " << email;
     
     // 检查邮箱格式
@@ -476,7 +910,7 @@ void ChatServer::handleVerifyCodeRequest(const muduo::net::TcpConnectionPtr& con
         LOG_ERROR << "Invalid email format: " << email;
         std::string errorMsg = std::to_string(static_cast<int>(MessageType::ERROR)) + 
                              ":errorMsg=Invalid email format";
-        conn->send(errorMsg);
+        codec_.send(conn, errorMsg);
         return;
     }
     
@@ -485,7 +919,7 @@ void ChatServer::handleVerifyCodeRequest(const muduo::net::TcpConnectionPtr& con
         LOG_ERROR << "Email already registered: " << email;
         std::string errorMsg = std::to_string(static_cast<int>(MessageType::ERROR)) + 
                              ":errorMsg=Email already registered";
-        conn->send(errorMsg);
+        codec_.send(conn, errorMsg);
         return;
     }
     
@@ -514,12 +948,12 @@ void ChatServer::handleVerifyCodeRequest(const muduo::net::TcpConnectionPtr& con
     }
     
     // 发送响应
-    conn->send(response);
+    codec_.send(conn, response);
 }
 
 // 处理注册请求
 void ChatServer::handleRegister(const muduo::net::TcpConnectionPtr& conn, 
-                             const std::unordered_map<std::string, std::string>& msg) {
+                             int /* userId */, const Request& msg) {
     // 检查必要的参数
     auto usernameIt = msg.find("username");
     auto passwordIt = msg.find("password");
@@ -531,14 +965,14 @@ void ChatServer::handleRegister(const muduo::net::TcpConnectionPtr& conn,
         LOG_ERROR << "Invalid registration request: missing required parameters";
         std::string errorMsg = std::to_string(static_cast<int>(MessageType::REGISTER_RESPONSE)) + 
                              ":status=1;errorMsg=Missing required parameters";
-        conn->send(errorMsg);
+        codec_.send(conn, errorMsg);
         return;
     }
     
-    std::string username = usernameIt->second;
-    std::string password = passwordIt->second;
-    std::string email = emailIt->second;
-    std::string code = codeIt->second;
+    std::string username(usernameIt->second);
+    std::string password(passwordIt->second);
+    std::string email(emailIt->second);
+    std::string code(codeIt->second);
     
     LOG_INFO << "Registration request for user: " << username << ", email: " << email;
     
@@ -547,7 +981,7 @@ void ChatServer::handleRegister(const muduo::net::TcpConnectionPtr& conn,
         LOG_ERROR << "Invalid or expired verification code for " << email;
         std::string errorMsg = std::to_string(static_cast<int>(MessageType::REGISTER_RESPONSE)) + 
                              ":status=1;errorMsg=Invalid or expired verification code";
-        conn->send(errorMsg);
+        codec_.send(conn, errorMsg);
         return;
     }
     
@@ -556,7 +990,7 @@ void ChatServer::handleRegister(const muduo::net::TcpConnectionPtr& conn,
         LOG_ERROR << "Username already exists: " << username;
         std::string errorMsg = std::to_string(static_cast<int>(MessageType::REGISTER_RESPONSE)) + 
                              ":status=1;errorMsg=Username already exists";
-        conn->send(errorMsg);
+        codec_.send(conn, errorMsg);
         return;
     }
     
@@ -565,7 +999,7 @@ void ChatServer::handleRegister(const muduo::net::TcpConnectionPtr& conn,
         LOG_ERROR << "Email already exists: " << email;
         std::string errorMsg = std::to_string(static_cast<int>(MessageType::REGISTER_RESPONSE)) + 
                              ":status=1;errorMsg=Email already exists";
-        conn->send(errorMsg);
+        codec_.send(conn, errorMsg);
         return;
     }
     
@@ -600,13 +1034,21 @@ void ChatServer::handleRegister(const muduo::net::TcpConnectionPtr& conn,
         // 发送注册成功响应
         std::string response = std::to_string(static_cast<int>(MessageType::REGISTER_RESPONSE)) + 
                             ":status=0;username=" + username + ";email=" + email;
-        conn->send(response);
+        codec_.send(conn, response);
         
         // 获取用户信息并登录用户
         std::shared_ptr<User> user = UserModel::getInstance().getUserByName(username);
         if (user) {
-            // 将用户添加到连接映射
-            userConnectionMap_[user->getId()] = conn;
+            // 绑定连接与用户，连接已断开时不再发送登录响应
+            if (!bindUser(conn, *user)) {
+                LOG_INFO << "Connection of user " << username << " closed during registration";
+                return;
+            }
+            
+            // 新用户没有大群积压，直接开始实时推送
+            conn->getLoop()->runInLoop([this, conn]() {
+                startGroupDelivery(conn, {});
+            });
             
             // 发送登录成功响应
             std::stringstream loginResponse;
@@ -620,7 +1062,7 @@ void ChatServer::handleRegister(const muduo::net::TcpConnectionPtr& conn,
                 loginResponse << ";avatar=" << user->getAvatar();
             }
             
-            conn->send(loginResponse.str());
+            codec_.send(conn, loginResponse.str());
         }
     } else {
         LOG_ERROR << "Failed to register user: " << username;
@@ -628,6 +1070,6 @@ void ChatServer::handleRegister(const muduo::net::TcpConnectionPtr& conn,
         // 发送注册失败响应
         std::string errorMsg = std::to_string(static_cast<int>(MessageType::REGISTER_RESPONSE)) + 
                              ":status=1;errorMsg=Registration failed, please try again later";
-        conn->send(errorMsg);
+        codec_.send(conn, errorMsg);
     }
 }
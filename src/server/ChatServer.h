@@ -1,11 +1,18 @@
 #ifndef CHAT_SERVER_H
 #define CHAT_SERVER_H
 
+#include <array>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <vector>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 #include <functional>
 #include "muduo/net/TcpServer.h"
+#include "muduo/net/EventLoopThreadPool.h"
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/InetAddress.h"
 #include "muduo/net/TcpConnection.h"
@@ -15,6 +22,17 @@
 
 #include "../model/User.h"
 #include "../service/RedisService.h"
+#include "../metrics/Histogram.h"
+#include "../metrics/Metrics.h"
+#include "../metrics/Tracer.h"
+#include "ChatCodec.h"
+#include "LoopWatchdog.h"
+#include "Request.h"
+#include "Session.h"
+#include "SessionRegistry.h"
+#include "TimingWheel.h"
+#include "WorkerPool.h"
+#include "wire/Messages.h"
 
 // 消息类型
 enum class MessageType {
@@ -62,22 +80,100 @@ enum class MessageType {
     FILE_MESSAGE = 42,     // 文件消息
     FILE_MESSAGE_RESPONSE = 43, // 文件消息响应
     IMAGE_MESSAGE = 44,    // 图片消息
-    IMAGE_MESSAGE_RESPONSE = 45 // 图片消息响应
+    IMAGE_MESSAGE_RESPONSE = 45, // 图片消息响应
+    OFFLINE_SYNC_COMPLETE = 46, // 离线消息发送完毕
+    OFFLINE_ACK = 47        // 确认收到离线消息
 };
 
 // 聊天服务器类
 class ChatServer {
 public:
+    // 慢速客户端（输出缓冲区超过高水位）的处理策略
+    enum class SlowConsumerPolicy {
+        SPILL_OFFLINE,   // 暂停向该用户推送，聊天消息转存到离线队列，缓冲区排空后补发；其他事件丢弃
+        DROP_EPHEMERAL,  // 聊天消息照常发送，丢弃已读回执、撤回通知等临时事件
+        DISCONNECT       // 直接断开连接
+    };
+    
+    // 每个I/O线程的输出统计
+    struct LoopStats {
+        size_t connections = 0;             // 连接数量
+        size_t bufferedBytes = 0;           // 最近一次采样时所有连接输出缓冲区的总字节数
+        uint64_t highWaterEvents = 0;       // 超过高水位的次数
+        uint64_t spilledMessages = 0;       // 转存到离线队列的消息数量
+        uint64_t droppedMessages = 0;       // 丢弃的消息数量
+        uint64_t slowConsumerDisconnects = 0; // 因慢速被断开的连接数量
+        Histogram::Snapshot timerLag;       // 定时器延迟（微秒），反映事件循环被阻塞的程度
+        uint64_t stalls = 0;                // 看门狗检测到事件循环无响应的次数
+    };
+    
+    // 连接接受方式
+    enum class AcceptMode {
+        SINGLE_ACCEPTOR,  // 主线程接受所有连接，轮询分配给I/O线程
+        REUSE_PORT        // 每个I/O线程用 SO_REUSEPORT 监听同一端口，由内核分散连接
+    };
+    
     ChatServer(muduo::net::EventLoop* loop, 
                const muduo::net::InetAddress& listenAddr, 
-               const std::string& nameArg);
+               const std::string& nameArg,
+               AcceptMode acceptMode = AcceptMode::SINGLE_ACCEPTOR);
+    ~ChatServer();
     
     // 启动服务器
     void start();
     
-    // 停止服务器
+    // 停止服务器，可以在信号处理函数中调用
     void stop();
     
+    // 输出发送、压缩和延迟统计，在事件循环退出后调用，不能在信号处理函数中调用
+    void logStats() const;
+    
+    // 设置I/O线程数量，需在start之前调用
+    void setIoThreads(int numThreads);
+    
+    // 设置I/O线程绑定的CPU，第i个I/O线程绑定到 cpus[i % cpus.size()]，需在start之前调用
+    void setIoCpuAffinity(const std::vector<int>& cpus) { ioCpus_ = cpus; }
+    
+    // 设置阻塞任务线程池的线程数量，需在start之前调用
+    void setWorkerThreads(int numThreads);
+    
+    // 设置阻塞任务线程可以运行的CPU集合，需在start之前调用
+    void setWorkerCpuAffinity(const std::vector<int>& cpus) { workerPool_.setCpuAffinity(cpus); }
+    
+    // 设置每个连接同时在工作线程中执行的请求数量上限，需在start之前调用
+    void setMaxInFlightRequests(int maxInFlight);
+    
+    // 阻塞任务线程池，用于查询队列深度等统计信息
+    const WorkerPool& workerPool() const { return workerPool_; }
+    
+    // 开启写合并，同一轮事件处理中对一个连接的多次发送合并为一次写入，需在start之前调用
+    void setWriteCoalescing(bool on) { codec_.setCoalescing(on); }
+    
+    // 允许客户端在登录时协商压缩（compress=deflate），payload 达到 threshold 字节的帧压缩后发送
+    // 需在start之前调用
+    void setCompression(bool enabled, size_t threshold = ChatCodec::kDefaultCompressionThreshold);
+    
+    // 消息编解码器，用于查询发送统计
+    const ChatCodec& codec() const { return codec_; }
+    
+    // 设置输出缓冲区的高低水位（字节），需在start之前调用
+    void setOutputWaterMarks(size_t highWaterMark, size_t lowWaterMark);
+    
+    // 设置慢速客户端处理策略，需在start之前调用
+    void setSlowConsumerPolicy(SlowConsumerPolicy policy) { slowConsumerPolicy_ = policy; }
+    
+    // 获取各I/O线程的输出统计
+    std::vector<LoopStats> loopStats() const;
+    
+    // 设置空闲连接超时时间和检查粒度（秒），需在start之前调用
+    void setIdleTimeout(int timeoutSeconds, int tickSeconds);
+    
+    // 事件循环超过 thresholdMs 毫秒没有回到 epoll_wait 时输出警告，0 表示关闭，需在start之前调用
+    void setWatchdogThreshold(int thresholdMs) { watchdog_.setThreshold(thresholdMs); }
+    
+    // 各消息类型在I/O线程中的处理时间（微秒），阻塞消息只含解析和排队的时间
+    Histogram::Snapshot dispatchLatency(MessageType type) const;
+    
     // 添加辅助函数，生成紧凑格式的JSON字符串
     static std::string compactJsonString(const Json::Value& value) {
         Json::StreamWriterBuilder writer;
@@ -85,114 +181,359 @@ public:
         return Json::writeString(writer, value);
     }
     
+    // 连接登录时是否声明了使用二进制消息
+    static bool usesWireFormat(const muduo::net::TcpConnectionPtr& conn) {
+        Session* session = getSession(conn);
+        return session && session->wireFormat.load(std::memory_order_relaxed);
+    }
+    
+    // 发送二进制消息，只能发往 usesWireFormat 为 true 的连接
+    template <typename Message>
+    void sendWire(const muduo::net::TcpConnectionPtr& conn, MessageType type, const Message& message) {
+        std::string body;
+        body.reserve(wire::byteSize(message));
+        wire::encode(message, &body);
+        codec_.send(conn, static_cast<int>(type), body, ChatCodec::kFlagWire);
+    }
+    
 private:
+    // I/O线程初始化回调，为每个EventLoop创建时间轮
+    void onThreadInit(muduo::net::EventLoop* loop);
+    
     // 连接回调
     void onConnection(const muduo::net::TcpConnectionPtr& conn);
     
-    // 消息回调
+    // 消息回调，由编解码器在收到完整帧后调用，记录处理时间并标记看门狗
     void onMessage(const muduo::net::TcpConnectionPtr& conn,
-                  muduo::net::Buffer* buffer,
+                  const ChatCodec::Frame& frame,
                   muduo::Timestamp /* time */);
     
+    // 校验并分发一帧消息
+    void handleFrame(const muduo::net::TcpConnectionPtr& conn,
+                     const ChatCodec::Frame& frame);
+    
     // 处理登录消息
-    void handleLogin(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg);
+    void handleLogin(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
     
     // 处理登出消息
-    void handleLogout(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg);
+    void handleLogout(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
     
     // 处理验证码请求
-    void handleVerifyCodeRequest(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg);
+    void handleVerifyCodeRequest(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
     
     // 处理注册请求
-    void handleRegister(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg);
+    void handleRegister(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
     
     // 处理心跳消息
-    void handleHeartbeat(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& /* msg */);
-    
-    // 定期检查心跳
-    void checkHeartbeats();
+    void handleHeartbeat(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& /* msg */);
     
     // 处理私聊消息
-    void handlePrivateChat(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg);
+    void handlePrivateChat(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
     
     // 处理群聊消息
-    void handleGroupChat(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg);
+    void handleGroupChat(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
     
     // 处理创建群组
-    void handleCreateGroup(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg);
+    void handleCreateGroup(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
     
     // 处理加入群组
-    void handleJoinGroup(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg);
+    void handleJoinGroup(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
     
     // 处理离开群组
-    void handleLeaveGroup(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg);
+    void handleLeaveGroup(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
     
     // 处理获取用户列表
-    void handleGetUserList(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg);
+    void handleGetUserList(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
     
     // 处理获取群组列表
-    void handleGetGroupList(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg);
+    void handleGetGroupList(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
     
     // 处理获取群成员
-    void handleGetGroupMembers(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg);
+    void handleGetGroupMembers(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
     
     // 处理获取好友列表
-    void handleGetUserFriends(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg);
+    void handleGetUserFriends(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
     
     // 处理发送好友请求
-    void handleAddFriendRequest(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg);
+    void handleAddFriendRequest(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
     
     // 处理接受好友请求
-    void handleAcceptFriendRequest(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg);
+    void handleAcceptFriendRequest(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
     
     // 处理拒绝好友请求
-    void handleRejectFriendRequest(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg);
+    void handleRejectFriendRequest(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
     
     // 处理获取好友请求列表
-    void handleGetFriendRequests(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg);
+    void handleGetFriendRequests(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
     
     // 处理添加好友 (已废弃，保留向后兼容)
-    void handleAddFriend(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg);
+    void handleAddFriend(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
     
     // 处理获取聊天记录
-    void handleGetChatHistory(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg);
+    void handleGetChatHistory(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
     
     // 处理撤回消息
-    void handleRecallMessage(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg);
+    void handleRecallMessage(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
     
     // 处理标记消息已读
-    void handleMarkMessageRead(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg);
+    void handleMarkMessageRead(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
+    
+    // 处理离线消息确认
+    void handleOfflineAck(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg);
+    
+    // 写缓冲区清空回调，用于离线消息的流量控制
+    void onWriteComplete(const muduo::net::TcpConnectionPtr& conn);
+    
+    // 开始分批发送离线消息，在工作线程中调用。restart 为登录时从队列头部重新发送，
+    // 否则（补发转存的消息）接着已发送的部分继续，正在同步时并入本次同步
+    void startOfflineSync(const muduo::net::TcpConnectionPtr& conn, int userId, long long total, bool needAck,
+                          bool restart);
+    
+    // 输出缓冲区低于低水位且没有批次在读取时，读取下一批离线消息
+    void continueOfflineSync(const muduo::net::TcpConnectionPtr& conn);
+    
+    // 在工作线程中读取已发送部分之后的一批离线消息并批量解析发送者用户名
+    void fetchOfflineBatch(const muduo::net::TcpConnectionPtr& conn, int userId, long long count);
+    
+    // 在工作线程中删除最多count条已发送的离线消息，返回删除的数量，失败时返回-1
+    long long trimSentOfflineMessages(const muduo::net::TcpConnectionPtr& conn, int userId, long long count);
+    
+    // 在连接所属线程中发送读取到的一批离线消息
+    void onOfflineBatchFetched(const muduo::net::TcpConnectionPtr& conn,
+                               long long requested, long long fetched,
+                               const std::vector<std::string>& messages);
+    
+    // 离线消息全部发送完毕
+    void finishOfflineSync(const muduo::net::TcpConnectionPtr& conn);
     
     // 查找用户ID通过连接
     int getUserIdByConnection(const muduo::net::TcpConnectionPtr& conn);
     
+    // 将连接绑定到已登录用户，同一用户在其他连接上的登录会被踢下线
+    // 连接在登录期间已断开时解除绑定并返回false
+    bool bindUser(const muduo::net::TcpConnectionPtr& conn, const User& user);
+    
+    // 解除连接与用户的绑定，返回原来绑定的用户ID，未绑定时返回-1
+    int unbindUser(const muduo::net::TcpConnectionPtr& conn);
+    
     // 查找用户连接通过ID
     muduo::net::TcpConnectionPtr getConnectionByUserId(int userId);
     
-    // 消息分发
-    using MessageHandler = std::function<void(const muduo::net::TcpConnectionPtr&, const std::unordered_map<std::string, std::string>&)>;
-    std::unordered_map<int, MessageHandler> msgHandlerMap_;
+    // 向其他用户的连接发送消息，在该连接所属的EventLoop中执行编码和发送
+    // offlineRecord 为该消息在离线队列中的记录，为空表示临时事件（通知、回执等）
+    void deliver(const muduo::net::TcpConnectionPtr& conn, std::string message,
+                 std::string offlineRecord = std::string());
+    
+    // 向多个在线用户群发消息，消息只编码一次，每个EventLoop只投递一次任务
+    // groupSeq 为大群消息在群组日志中的序号，按各连接的投递进度推送（见 deliverGroupMessage）
+    void broadcast(const std::vector<int>& userIds, int excludeUserId, const std::string& message,
+                   std::string offlineRecord = std::string(), int groupId = 0, long long groupSeq = 0);
+    
+    // 在连接所属线程中推送一条大群消息：登录时的积压尚未转入离线队列时暂存（有上限），
+    // 已转入离线队列的跳过，推送或转存后记录序号；丢弃一条消息后该群不再推进游标
+    void deliverGroupMessage(const muduo::net::TcpConnectionPtr& conn, const Session::GroupMessage& message,
+                             uint64_t traceId);
+    
+    // 登录时的积压已转入离线队列，在连接所属线程中开始推送大群消息，pulled 为各群转入的最大序号
+    void startGroupDelivery(const muduo::net::TcpConnectionPtr& conn, std::unordered_map<int, long long> pulled);
+    
+    // 记录发送者自己的大群消息序号，下线后不再从群组日志读回
+    void noteGroupMessage(const muduo::net::TcpConnectionPtr& conn, int groupId, long long seq);
+    
+    // 取出并清空连接的大群投递进度，返回各群没有遗漏地投递到的序号，用于下线时保存游标
+    std::unordered_map<int, long long> takeGroupCursors(const muduo::net::TcpConnectionPtr& conn);
+    
+    // 输出缓冲区超过高水位回调
+    void onHighWaterMark(const muduo::net::TcpConnectionPtr& conn, size_t bufferedBytes);
+    
+    // 在连接所属线程中判断是否可以向其推送消息，拥塞时按策略转存或丢弃
+    bool admitDelivery(const muduo::net::TcpConnectionPtr& conn, const std::string& offlineRecord);
+    
+    // 输出缓冲区回落到低水位以下，恢复推送并补发转存的消息
+    void resumeDelivery(const muduo::net::TcpConnectionPtr& conn);
+    
+    // 在工作线程中完成一条转存消息的写入，最后一条写入完成且拥塞已解除时补发
+    void finishSpill(const muduo::net::TcpConnectionPtr& conn);
+    
+    // 在工作线程中按离线队列的当前长度补发转存的消息
+    void syncSpilledMessages(const muduo::net::TcpConnectionPtr& conn);
+    
+    // 因输出缓冲区过大断开连接
+    void disconnectSlowConsumer(const muduo::net::TcpConnectionPtr& conn, size_t bufferedBytes);
+    
+    // 每个I/O线程的状态，只在所属线程中修改，统计值可在其他线程读取
+    struct LoopState {
+        std::unique_ptr<TimingWheel> timingWheel;
+        std::unordered_set<muduo::net::TcpConnectionPtr> connections;
+        std::atomic<size_t> connectionCount{0};
+        std::atomic<size_t> bufferedBytes{0};
+        std::atomic<uint64_t> highWaterEvents{0};
+        std::atomic<uint64_t> spilledMessages{0};
+        std::atomic<uint64_t> droppedMessages{0};
+        std::atomic<uint64_t> slowConsumerDisconnects{0};
+        LoopWatchdog::Probe* probe = nullptr;  // 看门狗探针，由 watchdog_ 持有
+    };
+    
+    // 当前I/O线程的状态，不在I/O线程中时为nullptr
+    static thread_local LoopState* t_loopState;
+    
+    // 采样本线程所有连接输出缓冲区的总字节数
+    static void sampleBufferedBytes(LoopState* state);
+    
+    // 消息处理函数，userId为已登录用户ID，未登录时为-1
+    using MessageHandler = void (ChatServer::*)(const muduo::net::TcpConnectionPtr&, int, const Request&);
+    
+    // 消息处理表项
+    struct HandlerEntry {
+        MessageHandler handler = nullptr;  // 处理函数
+        const char* name = nullptr;        // 消息类型名称，用于日志
+        bool requiresLogin = false;        // 是否需要先登录
+        bool blocking = false;             // 是否会调用数据库、Redis或SMTP等阻塞操作
+        size_t maxPayload = 0;             // 消息内容最大长度
+        bool exclusive = false;            // 改变会话登录状态，必须单独按顺序执行
+        bool traced = false;               // 按采样率追踪各处理阶段
+    };
+    
+    // 消息类型的最大值，处理表按消息类型直接索引
+    static constexpr int kMaxMessageType = static_cast<int>(MessageType::OFFLINE_ACK);
+    using HandlerTable = std::array<HandlerEntry, kMaxMessageType + 1>;
+    
+    // 编译期构建消息处理表
+    static constexpr HandlerTable makeHandlerTable();
+    
+    // 消息分发表
+    static const HandlerTable kHandlerTable;
+    
+    // 排队的阻塞请求：payload 的副本和在副本上解析出的字段，工作线程直接使用，不再重新解析
+    // 字段和 rid 引用 payload，创建后通过 shared_ptr 共享，不能移动
+    struct BlockingRequest {
+        std::string payload;
+        Request fields;
+        std::string_view rid;
+    };
+    using BlockingRequestPtr = std::shared_ptr<const BlockingRequest>;
+    
+    // 解析消息内容，flags 含 ChatCodec::kFlagWire 时为二进制 Fields 消息；格式错误时回复错误并返回false
+    bool parseRequest(const muduo::net::TcpConnectionPtr& conn,
+                      std::string_view payload,
+                      uint16_t flags,
+                      Request* request);
+    
+    // 取出请求的 rid，没有或无效时返回空
+    std::string_view requestRid(const muduo::net::TcpConnectionPtr& conn, const Request& request);
+    
+    // 执行消息处理函数，阻塞消息在工作线程中调用；rid 的作用域由调用方设置
+    void dispatch(const muduo::net::TcpConnectionPtr& conn,
+                  const HandlerEntry& entry,
+                  const Request& msgData);
     
-    // TCP服务器
+    // 把阻塞消息交给工作线程池
+    // 不带 rid 的请求和 exclusive 请求按到达顺序单独执行；带 rid 的请求可以并发执行、乱序完成
+    void submitBlocking(const muduo::net::TcpConnectionPtr& conn,
+                        const HandlerEntry& entry,
+                        BlockingRequestPtr request,
+                        bool exclusive);
+    
+    // 在连接所属线程中按顺序和并发上限提交排队的阻塞任务
+    void schedulePendingTasks(const muduo::net::TcpConnectionPtr& conn);
+    
+    // 已登录的连接断开后，在工作线程中把用户置为离线（数据库和Redis）
+    // 排在该连接尚未完成的请求之后，例如正在执行的登录
+    void submitDisconnectCleanup(const muduo::net::TcpConnectionPtr& conn, int userId);
+    
+    // 阻塞任务完成后在连接所属线程中调用，提交该连接的后续任务
+    void onBlockingTaskDone(const muduo::net::TcpConnectionPtr& conn, bool exclusive);
+    
+    // 在连接所属线程中记录一次被追踪的投递，输出缓冲区写完时结束
+    void traceWrite(const muduo::net::TcpConnectionPtr& conn, uint64_t traceId);
+    
+    // 输出缓冲区写完，结束该连接上被追踪的投递
+    void finishTracedWrites(Session* session);
+    
+    // 线程池繁忙时拒绝请求
+    void rejectBusy(const muduo::net::TcpConnectionPtr& conn, const HandlerEntry& entry);
+    
+    // 各I/O线程的状态，需在server_之后析构，此时I/O线程已经退出
+    std::vector<std::unique_ptr<LoopState>> loopStates_;
+    mutable std::mutex loopStatesMutex_;
+    
+    // 事件循环看门狗，持有各I/O线程的探针，同样在server_之后析构
+    LoopWatchdog watchdog_;
+    
+    // 各消息类型在I/O线程中的处理时间（微秒），登记在指标注册表中，未知类型为空；以及接收数量
+    std::array<Histogram*, kMaxMessageType + 1> dispatchLatency_{};
+    std::array<Counter, kMaxMessageType + 1> messagesReceived_;
+    
+    // 群组广播（群聊消息、撤回通知）的在线接收者数量
+    Histogram groupFanout_;
+    
+    // 在指标注册表中的采集函数编号
+    int metricsCollectorId_ = -1;
+    
+    // 输出 Prometheus 指标
+    void collectMetrics(PrometheusWriter& writer);
+    
+    // 设置TCP服务器的回调
+    void setupServer(muduo::net::TcpServer& server);
+    
+    // TCP服务器，REUSE_PORT 模式下只负责主线程上的连接
     muduo::net::TcpServer server_;
     
+    // REUSE_PORT 模式下其余I/O线程及各自的TCP服务器，
+    // TcpServer 只能在所属线程中析构，由析构函数在线程退出前逐个销毁
+    AcceptMode acceptMode_;
+    muduo::net::InetAddress listenAddr_;
+    std::unique_ptr<muduo::net::EventLoopThreadPool> reusePortLoops_;
+    std::vector<std::unique_ptr<muduo::net::TcpServer>> reusePortServers_;
+    
+    // 消息帧编解码器
+    ChatCodec codec_;
+    
     // 事件循环指针
     muduo::net::EventLoop* loop_;
     
-    // 用户连接映射表 用户id -> 连接
-    std::unordered_map<int, muduo::net::TcpConnectionPtr> userConnectionMap_;
+    // 会话注册表，记录在线用户和所有连接，各I/O线程共享
+    SessionRegistry sessions_;
+    
+    // 阻塞任务线程池，在server_之后声明以便先于I/O线程析构
+    WorkerPool workerPool_;
     
-    // 连接最后活动时间映射
-    std::unordered_map<muduo::net::TcpConnectionPtr, muduo::Timestamp> connectionLastActiveTime_;
+    // 阻塞任务线程池的线程数量
+    int workerThreads_;
     
-    // 心跳检查定时器ID
-    muduo::net::TimerId heartbeatTimerId_;
+    // I/O线程数量，以及各I/O线程绑定的CPU
+    int ioThreads_;
+    std::vector<int> ioCpus_;
+    std::atomic<int> nextLoopIndex_{0};
     
-    // 心跳超时时间（秒）
+    // 每个连接最多排队的阻塞请求数量
+    static constexpr size_t kMaxPendingTasksPerSession = 64;
+    
+    // 每个连接最多保留的等待写完的追踪记录
+    static constexpr size_t kMaxTracedWritesPerSession = 64;
+    
+    // 每个连接同时在工作线程中执行的请求数量上限
+    int maxInFlightPerSession_ = 4;
+    
+    // 是否接受客户端的压缩协商
+    bool compressionEnabled_ = true;
+    
+    // 默认心跳超时时间（秒）
     static constexpr int HEARTBEAT_TIMEOUT = 60;
     
-    // 心跳检查间隔（秒）
+    // 默认心跳检查间隔（秒）
     static constexpr int HEARTBEAT_CHECK_INTERVAL = 20;
+    
+    // 空闲连接超时时间和时间轮粒度（秒）
+    int idleTimeout_ = HEARTBEAT_TIMEOUT;
+    int idleTick_ = HEARTBEAT_CHECK_INTERVAL;
+    
+    // 输出缓冲区高低水位（字节）
+    size_t highWaterMark_ = 1024 * 1024;
+    size_t lowWaterMark_ = 256 * 1024;
+    
+    // 慢速客户端处理策略
+    SlowConsumerPolicy slowConsumerPolicy_ = SlowConsumerPolicy::SPILL_OFFLINE;
 };
 
 #endif // CHAT_SERVER_H
@@ -4,30 +4,19 @@
 #include <json/json.h>
 
 // 处理撤回消息
-void ChatServer::handleRecallMessage(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg) {
-    // 获取发送者ID
-    int userId = getUserIdByConnection(conn);
-    if (userId == -1) {
-        LOG_ERROR << "User not logged in. Cannot recall message.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You must be logged in to recall messages");
-        return;
-    }
-    
+void ChatServer::handleRecallMessage(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg) {
     // 获取消息ID和类型
     auto messageIdIt = msg.find("messageId");
     auto typeIt = msg.find("type");
     
     if (messageIdIt == msg.end() || typeIt == msg.end()) {
         LOG_ERROR << "Invalid recall message request. Missing messageId or type.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
         return;
     }
     
-    std::string messageId = messageIdIt->second;
-    std::string type = typeIt->second;
-    
-    // 更新连接活动时间
-    connectionLastActiveTime_[conn] = muduo::Timestamp::now();
+    std::string messageId(messageIdIt->second);
+    std::string type(typeIt->second);
     
     bool success = false;
     
@@ -36,11 +25,11 @@ void ChatServer::handleRecallMessage(const muduo::net::TcpConnectionPtr& conn, c
         auto targetUserIdIt = msg.find("targetUserId");
         if (targetUserIdIt == msg.end()) {
             LOG_ERROR << "Invalid recall message request. Missing targetUserId for private message.";
-            conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
+            codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
             return;
         }
         
-        int targetUserId = std::stoi(targetUserIdIt->second);
+        int targetUserId = toInt(targetUserIdIt->second);
         
         // 撤回私聊消息
         success = RedisService::getInstance().recallPrivateMessage(userId, targetUserId, messageId);
@@ -55,7 +44,7 @@ void ChatServer::handleRecallMessage(const muduo::net::TcpConnectionPtr& conn, c
                                         ";type=private" +
                                         ";fromUserId=" + std::to_string(userId);
                 
-                targetConn->send(recallNotice);
+                deliver(targetConn, recallNotice);
             }
         }
     } else if (type == "group") {
@@ -63,11 +52,11 @@ void ChatServer::handleRecallMessage(const muduo::net::TcpConnectionPtr& conn, c
         auto groupIdIt = msg.find("groupId");
         if (groupIdIt == msg.end()) {
             LOG_ERROR << "Invalid recall message request. Missing groupId for group message.";
-            conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
+            codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
             return;
         }
         
-        int groupId = std::stoi(groupIdIt->second);
+        int groupId = toInt(groupIdIt->second);
         
         // 撤回群聊消息
         success = RedisService::getInstance().recallGroupMessage(userId, groupId, messageId);
@@ -83,18 +72,12 @@ void ChatServer::handleRecallMessage(const muduo::net::TcpConnectionPtr& conn, c
                                     ";groupId=" + std::to_string(groupId) +
                                     ";fromUserId=" + std::to_string(userId);
             
-            for (int memberId : members) {
-                if (memberId == userId) continue;  // 跳过发送者自己
-                
-                auto memberConn = getConnectionByUserId(memberId);
-                if (memberConn && memberConn->connected()) {
-                    memberConn->send(recallNotice);
-                }
-            }
+            // 跳过发送者自己
+            broadcast(members, userId, recallNotice);
         }
     } else {
         LOG_ERROR << "Invalid message type for recall: " << type;
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid message type");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid message type");
         return;
     }
     
@@ -103,42 +86,31 @@ void ChatServer::handleRecallMessage(const muduo::net::TcpConnectionPtr& conn, c
         std::string response = std::to_string(static_cast<int>(MessageType::RECALL_MESSAGE_RESPONSE)) + 
                             ":status=success" +
                             ";messageId=" + messageId;
-        conn->send(response);
+        codec_.send(conn, response);
         LOG_INFO << "Message " << messageId << " recalled successfully by user " << userId;
     } else {
         std::string response = std::to_string(static_cast<int>(MessageType::ERROR)) + 
                             ":message=Failed to recall message" +
                             ";messageId=" + messageId;
-        conn->send(response);
+        codec_.send(conn, response);
         LOG_ERROR << "Failed to recall message " << messageId << " by user " << userId;
     }
 }
 
 // 处理标记消息已读
-void ChatServer::handleMarkMessageRead(const muduo::net::TcpConnectionPtr& conn, const std::unordered_map<std::string, std::string>& msg) {
-    // 获取发送者ID
-    int userId = getUserIdByConnection(conn);
-    if (userId == -1) {
-        LOG_ERROR << "User not logged in. Cannot mark message as read.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=You must be logged in to mark messages as read");
-        return;
-    }
-    
+void ChatServer::handleMarkMessageRead(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg) {
     // 获取消息ID和类型
     auto messageIdIt = msg.find("messageId");
     auto typeIt = msg.find("type");
     
     if (messageIdIt == msg.end() || typeIt == msg.end()) {
         LOG_ERROR << "Invalid mark read request. Missing messageId or type.";
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
         return;
     }
     
-    std::string messageId = messageIdIt->second;
-    std::string type = typeIt->second;
-    
-    // 更新连接活动时间
-    connectionLastActiveTime_[conn] = muduo::Timestamp::now();
+    std::string messageId(messageIdIt->second);
+    std::string type(typeIt->second);
     
     bool success = false;
     
@@ -154,7 +126,7 @@ void ChatServer::handleMarkMessageRead(const muduo::net::TcpConnectionPtr& conn,
             // 这里简化处理，假设targetUserId是发送者ID
             auto targetUserIdIt = msg.find("fromUserId");
             if (targetUserIdIt != msg.end()) {
-                int fromUserId = std::stoi(targetUserIdIt->second);
+                int fromUserId = toInt(targetUserIdIt->second);
                 
                 auto fromConn = getConnectionByUserId(fromUserId);
                 if (fromConn && fromConn->connected()) {
@@ -164,7 +136,7 @@ void ChatServer::handleMarkMessageRead(const muduo::net::TcpConnectionPtr& conn,
                                          ";type=private" +
                                          ";userId=" + std::to_string(userId);
                     
-                    fromConn->send(readNotice);
+                    deliver(fromConn, readNotice);
                 }
             }
         }
@@ -173,17 +145,17 @@ void ChatServer::handleMarkMessageRead(const muduo::net::TcpConnectionPtr& conn,
         auto groupIdIt = msg.find("groupId");
         if (groupIdIt == msg.end()) {
             LOG_ERROR << "Invalid mark read request. Missing groupId for group message.";
-            conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
+            codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
             return;
         }
         
-        int groupId = std::stoi(groupIdIt->second);
+        int groupId = toInt(groupIdIt->second);
         
         // 标记群聊消息为已读
         success = RedisService::getInstance().markGroupMessageAsRead(userId, groupId, messageId);
     } else {
         LOG_ERROR << "Invalid message type for mark read: " << type;
-        conn->send(std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid message type");
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid message type");
         return;
     }
     
@@ -192,13 +164,13 @@ void ChatServer::handleMarkMessageRead(const muduo::net::TcpConnectionPtr& conn,
         std::string response = std::to_string(static_cast<int>(MessageType::MARK_MESSAGE_READ_RESPONSE)) + 
                             ":status=success" +
                             ";messageId=" + messageId;
-        conn->send(response);
+        codec_.send(conn, response);
         LOG_INFO << "Message " << messageId << " marked as read by user " << userId;
     } else {
         std::string response = std::to_string(static_cast<int>(MessageType::ERROR)) + 
                             ":message=Failed to mark message as read" +
                             ";messageId=" + messageId;
-        conn->send(response);
+        codec_.send(conn, response);
         LOG_ERROR << "Failed to mark message " << messageId << " as read by user " << userId;
     }
 }
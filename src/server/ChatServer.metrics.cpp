@@ -0,0 +1,114 @@
+#include "ChatServer.h"
+#include "../metrics/Metrics.h"
+
+namespace {
+
+std::string loopLabel(size_t index) {
+    return "loop=\"" + std::to_string(index) + "\"";
+}
+
+} // namespace
+
+void ChatServer::collectMetrics(PrometheusWriter& writer) {
+    // 各消息类型的接收数量，处理时间由注册表按 component="dispatch" 输出
+    writer.family("chat_messages_received_total", "counter", "Messages received by type");
+    for (int type = 0; type <= kMaxMessageType; ++type) {
+        if (kHandlerTable[type].handler) {
+            writer.sample("chat_messages_received_total", std::string("type=\"") + kHandlerTable[type].name + "\"",
+                          static_cast<double>(messagesReceived_[type].value()));
+        }
+    }
+    writer.family("chat_group_fanout_recipients", "histogram", "Online recipients per group broadcast");
+    writer.histogram("chat_group_fanout_recipients", "", groupFanout_.snapshot(), 1.0);
+    
+    // 在线用户和连接
+    writer.family("chat_online_users", "gauge", "Logged in users");
+    writer.sample("chat_online_users", "", static_cast<double>(sessions_.userCount()));
+    
+    // 各I/O线程的连接、输出缓冲区和事件循环延迟
+    std::vector<LoopStats> loops = loopStats();
+    writer.family("chat_loop_connections", "gauge", "Connections per I/O loop");
+    for (size_t i = 0; i < loops.size(); ++i) {
+        writer.sample("chat_loop_connections", loopLabel(i), static_cast<double>(loops[i].connections));
+    }
+    writer.family("chat_loop_output_buffer_bytes", "gauge", "Bytes queued in output buffers per I/O loop, sampled every second");
+    for (size_t i = 0; i < loops.size(); ++i) {
+        writer.sample("chat_loop_output_buffer_bytes", loopLabel(i), static_cast<double>(loops[i].bufferedBytes));
+    }
+    writer.family("chat_loop_high_water_events_total", "counter", "Connections crossing the output high water mark");
+    for (size_t i = 0; i < loops.size(); ++i) {
+        writer.sample("chat_loop_high_water_events_total", loopLabel(i), static_cast<double>(loops[i].highWaterEvents));
+    }
+    writer.family("chat_loop_slow_consumer_messages_total", "counter", "Messages spilled or dropped for slow consumers");
+    for (size_t i = 0; i < loops.size(); ++i) {
+        writer.sample("chat_loop_slow_consumer_messages_total", loopLabel(i) + ",action=\"spilled\"",
+                      static_cast<double>(loops[i].spilledMessages));
+        writer.sample("chat_loop_slow_consumer_messages_total", loopLabel(i) + ",action=\"dropped\"",
+                      static_cast<double>(loops[i].droppedMessages));
+    }
+    writer.family("chat_loop_slow_consumer_disconnects_total", "counter", "Connections closed as slow consumers");
+    for (size_t i = 0; i < loops.size(); ++i) {
+        writer.sample("chat_loop_slow_consumer_disconnects_total", loopLabel(i),
+                      static_cast<double>(loops[i].slowConsumerDisconnects));
+    }
+    writer.family("chat_loop_timer_lag_seconds", "histogram", "Delay between scheduled and actual timer firing");
+    for (size_t i = 0; i < loops.size(); ++i) {
+        writer.histogram("chat_loop_timer_lag_seconds", loopLabel(i), loops[i].timerLag, 1e-6);
+    }
+    writer.family("chat_loop_stalls_total", "counter", "Times the watchdog found an I/O loop unresponsive");
+    for (size_t i = 0; i < loops.size(); ++i) {
+        writer.sample("chat_loop_stalls_total", loopLabel(i), static_cast<double>(loops[i].stalls));
+    }
+    
+    // 阻塞任务线程池
+    writer.family("chat_worker_queue_size", "gauge", "Tasks waiting in the worker pool");
+    writer.sample("chat_worker_queue_size", "", static_cast<double>(workerPool_.queueSize()));
+    writer.family("chat_worker_tasks_total", "counter", "Worker pool tasks by outcome");
+    writer.sample("chat_worker_tasks_total", "outcome=\"submitted\"", static_cast<double>(workerPool_.submittedCount()));
+    writer.sample("chat_worker_tasks_total", "outcome=\"rejected\"", static_cast<double>(workerPool_.rejectedCount()));
+    writer.sample("chat_worker_tasks_total", "outcome=\"completed\"", static_cast<double>(workerPool_.completedCount()));
+    
+    // 发送统计
+    ChatCodec::WriteStats stats = codec_.writeStats();
+    writer.family("chat_write_sends_total", "counter", "Frames sent");
+    writer.sample("chat_write_sends_total", "", static_cast<double>(stats.sends));
+    writer.family("chat_write_flushes_total", "counter", "Coalesced batch writes");
+    writer.sample("chat_write_flushes_total", "", static_cast<double>(stats.flushes));
+    writer.family("chat_write_syscalls_total", "counter", "Direct write(2) calls on an empty output buffer");
+    writer.sample("chat_write_syscalls_total", "", static_cast<double>(stats.writes));
+    writer.family("chat_write_bytes_total", "counter", "Bytes sent");
+    writer.sample("chat_write_bytes_total", "", static_cast<double>(stats.bytes));
+    
+    // 各消息类型的压缩统计，只输出有压缩记录的类型
+    writer.family("chat_compression_frames_total", "counter", "Frames passed through the compressor by result");
+    for (int type = 0; type <= ChatCodec::kMaxStatsType; ++type) {
+        ChatCodec::CompressionStats compression = codec_.compressionStats(type);
+        if (compression.compressed + compression.incompressible == 0) {
+            continue;
+        }
+        std::string label = "type=\"" + std::to_string(type) + "\"";
+        writer.sample("chat_compression_frames_total", label + ",result=\"compressed\"",
+                      static_cast<double>(compression.compressed));
+        writer.sample("chat_compression_frames_total", label + ",result=\"incompressible\"",
+                      static_cast<double>(compression.incompressible));
+    }
+    writer.family("chat_compression_bytes_total", "counter", "Payload bytes before and after compression");
+    for (int type = 0; type <= ChatCodec::kMaxStatsType; ++type) {
+        ChatCodec::CompressionStats compression = codec_.compressionStats(type);
+        if (compression.compressed + compression.incompressible == 0) {
+            continue;
+        }
+        std::string label = "type=\"" + std::to_string(type) + "\"";
+        writer.sample("chat_compression_bytes_total", label + ",stage=\"in\"", static_cast<double>(compression.bytesIn));
+        writer.sample("chat_compression_bytes_total", label + ",stage=\"out\"", static_cast<double>(compression.bytesOut));
+    }
+    writer.family("chat_compression_cpu_seconds_total", "counter", "CPU time spent compressing");
+    for (int type = 0; type <= ChatCodec::kMaxStatsType; ++type) {
+        ChatCodec::CompressionStats compression = codec_.compressionStats(type);
+        if (compression.compressed + compression.incompressible == 0) {
+            continue;
+        }
+        writer.sample("chat_compression_cpu_seconds_total", "type=\"" + std::to_string(type) + "\"",
+                      static_cast<double>(compression.cpuNanos) * 1e-9);
+    }
+}
@@ -0,0 +1,279 @@
+#include "ChatServer.h"
+#include "../service/RedisService.h"
+#include "../model/UserModel.h"
+#include <json/json.h>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// 每批读取的离线消息数量
+constexpr long long kOfflineSyncBatchSize = 100;
+
+// 输出缓冲区低于该值时才发送下一批离线消息
+constexpr size_t kOfflineSyncLowWaterMark = 64 * 1024;
+
+// 线程池繁忙时重试读取的间隔（秒）
+constexpr double kOfflineSyncRetryDelay = 1.0;
+
+} // namespace
+
+// 处理离线消息确认
+void ChatServer::handleOfflineAck(const muduo::net::TcpConnectionPtr& conn, int userId, const Request& msg) {
+    auto countIt = msg.find("count");
+    if (countIt == msg.end()) {
+        LOG_ERROR << "Invalid offline ack. Missing count.";
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Invalid request format");
+        return;
+    }
+    
+    // 只能确认已经发送过的消息
+    long long acked = trimSentOfflineMessages(conn, userId, toInt(countIt->second));
+    if (acked < 0) {
+        // 删除失败时计数不变，客户端下次确认时重试
+        codec_.send(conn, std::to_string(static_cast<int>(MessageType::ERROR)) + ":message=Failed to acknowledge offline messages");
+        return;
+    }
+    if (acked == 0) {
+        return;
+    }
+    
+    LOG_INFO << "User " << userId << " acknowledged " << acked << " offline messages";
+}
+
+long long ChatServer::trimSentOfflineMessages(const muduo::net::TcpConnectionPtr& conn, int userId, long long count) {
+    Session* session = getSession(conn);
+    if (!session) {
+        return 0;
+    }
+    
+    // 与读取批次串行，删除之后读取的起点随之前移
+    std::lock_guard<std::mutex> lock(session->offlineMutex);
+    long long trimmed = std::min(count, session->offlineSent);
+    if (trimmed <= 0) {
+        return 0;
+    }
+    if (!RedisService::getInstance().trimOfflineMessages(userId, trimmed)) {
+        return -1;
+    }
+    session->offlineSent -= trimmed;
+    return trimmed;
+}
+
+void ChatServer::onWriteComplete(const muduo::net::TcpConnectionPtr& conn) {
+    Session* session = getSession(conn);
+    if (!session) {
+        return;
+    }
+    
+    if (!session->tracedWrites.empty()) {
+        finishTracedWrites(session);
+    }
+    
+    // 输出缓冲区已清空，恢复被暂停的推送
+    if (session->congested) {
+        resumeDelivery(conn);
+    }
+    if (session->offlineSync.active) {
+        continueOfflineSync(conn);
+    }
+}
+
+void ChatServer::startOfflineSync(const muduo::net::TcpConnectionPtr& conn, int userId, long long total, bool needAck,
+                                  bool restart) {
+    Session* session = getSession(conn);
+    if (!session) {
+        return;
+    }
+    
+    // 重复登录时从头开始，尚未确认的消息会重新发送
+    if (restart) {
+        std::lock_guard<std::mutex> lock(session->offlineMutex);
+        session->offlineSent = 0;
+    }
+    
+    conn->getLoop()->runInLoop([this, conn, userId, total, needAck, restart]() {
+        Session* session = getSession(conn);
+        if (!session || !conn->connected()) {
+            return;
+        }
+        
+        // total 包含已发送未确认的消息，只是上限，队列读完时同步提前结束
+        Session::OfflineSync& sync = session->offlineSync;
+        if (!restart && sync.active) {
+            sync.total = std::max(sync.total, sync.next + total);
+            return;
+        }
+        sync.active = true;
+        sync.needAck = needAck;
+        sync.userId = userId;
+        sync.total = total;
+        sync.next = 0;
+        
+        continueOfflineSync(conn);
+    });
+}
+
+void ChatServer::continueOfflineSync(const muduo::net::TcpConnectionPtr& conn) {
+    Session* session = getSession(conn);
+    if (!session || !conn->connected()) {
+        return;
+    }
+    
+    Session::OfflineSync& sync = session->offlineSync;
+    if (!sync.active || sync.fetching) {
+        return;
+    }
+    
+    // 客户端读取较慢时等待写完成回调，不继续堆积输出缓冲区
+    if (conn->outputBuffer()->readableBytes() > kOfflineSyncLowWaterMark) {
+        return;
+    }
+    
+    if (sync.next >= sync.total) {
+        finishOfflineSync(conn);
+        return;
+    }
+    
+    sync.fetching = true;
+    int userId = sync.userId;
+    long long count = std::min(kOfflineSyncBatchSize, sync.total - sync.next);
+    bool submitted = workerPool_.trySubmit([this, conn, userId, count]() {
+        fetchOfflineBatch(conn, userId, count);
+    });
+    
+    if (!submitted) {
+        // 线程池繁忙，稍后重试
+        sync.fetching = false;
+        LOG_WARN << "Worker queue full, delaying offline sync for user " << userId;
+        std::weak_ptr<muduo::net::TcpConnection> weakConn(conn);
+        conn->getLoop()->runAfter(kOfflineSyncRetryDelay, [this, weakConn]() {
+            muduo::net::TcpConnectionPtr conn = weakConn.lock();
+            if (conn) {
+                continueOfflineSync(conn);
+            }
+        });
+    }
+}
+
+void ChatServer::fetchOfflineBatch(const muduo::net::TcpConnectionPtr& conn, int userId, long long count) {
+    Session* session = getSession(conn);
+    if (!session) {
+        return;
+    }
+    
+    // 确认会删除队列头部的消息，读取的起点按已发送未删除的数量计算，读取与删除不能交错
+    std::vector<std::string> rawMessages;
+    {
+        std::lock_guard<std::mutex> lock(session->offlineMutex);
+        rawMessages = RedisService::getInstance().getOfflineMessageRange(userId, session->offlineSent, count);
+        session->offlineSent += static_cast<long long>(rawMessages.size());
+    }
+    
+    // 解析消息并收集发送者ID
+    std::vector<Json::Value> parsed;
+    parsed.reserve(rawMessages.size());
+    std::unordered_set<int> senderIds;
+    for (const auto& msgJson : rawMessages) {
+        Json::Value msg;
+        Json::Reader reader;
+        if (reader.parse(msgJson, msg) && msg.isMember("from")) {
+            senderIds.insert(msg["from"].asInt());
+            parsed.push_back(std::move(msg));
+        }
+    }
+    
+    // 一次查询这一批的所有发送者
+    std::unordered_map<int, std::string> usernames =
+        UserModel::getInstance().getUsernamesByIds(std::vector<int>(senderIds.begin(), senderIds.end()));
+    
+    std::vector<std::string> messages;
+    messages.reserve(parsed.size());
+    for (const auto& msg : parsed) {
+        try {
+            std::string type = msg["type"].asString();
+            int fromUserId = msg["from"].asInt();
+            auto nameIt = usernames.find(fromUserId);
+            if (nameIt == usernames.end()) continue;
+            
+            // 旧版本写入的消息没有ID
+            std::string idField = msg.isMember("id") ? "messageId=" + msg["id"].asString() + ";" : "";
+            
+            if (type == "private") {
+                // 构建私聊消息
+                messages.push_back(std::to_string(static_cast<int>(MessageType::PRIVATE_CHAT)) + 
+                                   ":" + idField +
+                                   "fromUserId=" + std::to_string(fromUserId) + 
+                                   ";fromUsername=" + nameIt->second + 
+                                   ";content=" + msg["content"].asString() + 
+                                   ";timestamp=" + msg["timestamp"].asString() +
+                                   ";offline=true");
+            } 
+            else if (type == "group") {
+                // 构建群聊消息
+                messages.push_back(std::to_string(static_cast<int>(MessageType::GROUP_CHAT)) + 
+                                   ":" + idField +
+                                   "groupId=" + std::to_string(msg["group"].asInt()) + 
+                                   ";fromUserId=" + std::to_string(fromUserId) + 
+                                   ";fromUsername=" + nameIt->second + 
+                                   ";content=" + msg["content"].asString() + 
+                                   ";timestamp=" + msg["timestamp"].asString() +
+                                   ";offline=true");
+            }
+        } catch (const std::exception& e) {
+            LOG_ERROR << "Failed to process offline message: " << e.what();
+        }
+    }
+    
+    long long fetched = static_cast<long long>(rawMessages.size());
+    conn->getLoop()->runInLoop([this, conn, count, fetched, messages = std::move(messages)]() {
+        onOfflineBatchFetched(conn, count, fetched, messages);
+    });
+}
+
+void ChatServer::onOfflineBatchFetched(const muduo::net::TcpConnectionPtr& conn,
+                                       long long requested, long long fetched,
+                                       const std::vector<std::string>& messages) {
+    Session* session = getSession(conn);
+    if (!session || !conn->connected()) {
+        return;
+    }
+    
+    Session::OfflineSync& sync = session->offlineSync;
+    sync.fetching = false;
+    
+    for (const auto& message : messages) {
+        codec_.send(conn, message);
+    }
+    
+    // 列表比预期的短（例如被其他连接确认删除），提前结束
+    sync.next += fetched;
+    if (fetched < requested) {
+        sync.total = sync.next;
+    }
+    
+    continueOfflineSync(conn);
+}
+
+void ChatServer::finishOfflineSync(const muduo::net::TcpConnectionPtr& conn) {
+    Session* session = getSession(conn);
+    Session::OfflineSync& sync = session->offlineSync;
+    sync.active = false;
+    
+    LOG_INFO << "Sent " << sync.total << " offline messages to user " << sync.userId;
+    
+    std::string complete = std::to_string(static_cast<int>(MessageType::OFFLINE_SYNC_COMPLETE)) + 
+                           ":count=" + std::to_string(sync.total);
+    codec_.send(conn, complete);
+    
+    // 旧客户端不会确认，发送完毕后直接删除，与原来读取即删除的行为一致。
+    // 删除不能丢弃，否则下次登录会重复发送，不受工作队列上限限制
+    if (!sync.needAck) {
+        int userId = sync.userId;
+        long long count = sync.total;
+        workerPool_.submit([this, conn, userId, count]() {
+            trimSentOfflineMessages(conn, userId, count);
+        });
+    }
+}
@@ -0,0 +1,52 @@
+#include "Compressor.h"
+#include "muduo/base/Logging.h"
+#include <cstring>
+
+Compressor::Compressor()
+    : initialized_(false),
+      outputSize_(0)
+{
+    ::memset(&stream_, 0, sizeof stream_);
+
+    // 聊天消息以延迟为先，使用最快的压缩级别
+    int ret = ::deflateInit2(&stream_, Z_BEST_SPEED, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    if (ret != Z_OK) {
+        LOG_ERROR << "deflateInit2 failed: " << ret;
+        return;
+    }
+    initialized_ = true;
+}
+
+Compressor::~Compressor()
+{
+    if (initialized_) {
+        ::deflateEnd(&stream_);
+    }
+}
+
+bool Compressor::compress(const muduo::StringPiece& input)
+{
+    outputSize_ = 0;
+    if (!initialized_ || ::deflateReset(&stream_) != Z_OK) {
+        return false;
+    }
+
+    // 输出缓冲区只增不减，稳定后不再分配内存
+    size_t bound = ::deflateBound(&stream_, static_cast<uLong>(input.size()));
+    if (output_.size() < bound) {
+        output_.resize(bound);
+    }
+
+    stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    stream_.avail_in = static_cast<uInt>(input.size());
+    stream_.next_out = reinterpret_cast<Bytef*>(&output_[0]);
+    stream_.avail_out = static_cast<uInt>(output_.size());
+
+    if (::deflate(&stream_, Z_FINISH) != Z_STREAM_END) {
+        LOG_ERROR << "deflate failed for " << input.size() << " bytes";
+        return false;
+    }
+
+    outputSize_ = stream_.total_out;
+    return outputSize_ < static_cast<size_t>(input.size());
+}
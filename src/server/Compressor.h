@@ -0,0 +1,33 @@
+#ifndef COMPRESSOR_H
+#define COMPRESSOR_H
+
+#include <string>
+#include <zlib.h>
+#include "muduo/base/noncopyable.h"
+#include "muduo/base/StringPiece.h"
+
+// 帧压缩器
+//
+// 每帧独立压缩为 raw deflate 数据（无 zlib 头和校验和），客户端用 inflateInit2(-15) 解压。
+// 压缩上下文和输出缓冲区在多次调用之间复用，不是线程安全的，每个I/O线程使用一个实例。
+class Compressor : muduo::noncopyable {
+public:
+    Compressor();
+    ~Compressor();
+
+    // 压缩一帧，成功时返回true，压缩结果在下次调用前有效
+    // 压缩后不比原数据小时返回false，调用方应发送原数据
+    bool compress(const muduo::StringPiece& input);
+
+    muduo::StringPiece output() const {
+        return muduo::StringPiece(output_.data(), static_cast<int>(outputSize_));
+    }
+
+private:
+    z_stream stream_;
+    bool initialized_;
+    std::string output_;
+    size_t outputSize_;
+};
+
+#endif // COMPRESSOR_H
@@ -0,0 +1,166 @@
+#include "CpuAffinity.h"
+#include "muduo/base/Logging.h"
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+namespace {
+
+// 读取sysfs文件的第一行
+bool readFirstLine(const std::string& path, std::string* line)
+{
+    std::ifstream file(path);
+    return file && std::getline(file, *line);
+}
+
+bool parseInt(std::string_view text, int* value)
+{
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), *value);
+    return ec == std::errc() && ptr == text.data() + text.size();
+}
+
+// NUMA节点上的CPU列表
+bool cpusOfNode(int node, std::vector<int>* cpus)
+{
+    std::string list;
+    std::string path = "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+    if (!readFirstLine(path, &list)) {
+        LOG_ERROR << "Cannot read " << path;
+        return false;
+    }
+    return CpuAffinity::parseCpuList(list, cpus);
+}
+
+} // namespace
+
+bool CpuAffinity::parseCpuList(std::string_view list, std::vector<int>* cpus)
+{
+    cpus->clear();
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        std::string_view item = list.substr(0, comma);
+        list.remove_prefix(comma == std::string_view::npos ? list.size() : comma + 1);
+
+        // 去掉首尾空白
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) {
+            item.remove_prefix(1);
+        }
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t' || item.back() == '\n')) {
+            item.remove_suffix(1);
+        }
+        if (item.empty()) {
+            continue;
+        }
+
+        int first = 0;
+        int last = 0;
+        size_t dash = item.find('-');
+        if (dash == std::string_view::npos) {
+            if (!parseInt(item, &first)) {
+                return false;
+            }
+            last = first;
+        } else if (!parseInt(item.substr(0, dash), &first) || !parseInt(item.substr(dash + 1), &last)) {
+            return false;
+        }
+        if (first < 0 || last < first || last >= CPU_SETSIZE) {
+            return false;
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus->push_back(cpu);
+        }
+    }
+
+    std::sort(cpus->begin(), cpus->end());
+    cpus->erase(std::unique(cpus->begin(), cpus->end()), cpus->end());
+    return true;
+}
+
+bool CpuAffinity::resolve(const std::string& spec, std::vector<int>* cpus)
+{
+    cpus->clear();
+    if (spec.empty()) {
+        return true;
+    }
+
+    bool ok = false;
+    if (spec.compare(0, 5, "node:") == 0) {
+        int node = -1;
+        ok = parseInt(std::string_view(spec).substr(5), &node) && node >= 0 && cpusOfNode(node, cpus);
+    } else if (spec.compare(0, 4, "nic:") == 0) {
+        // 网卡的NUMA节点，虚拟网卡或单节点机器上为-1或不存在
+        std::string nic = spec.substr(4);
+        std::string line;
+        int node = -1;
+        if (!readFirstLine("/sys/class/net/" + nic + "/device/numa_node", &line) || !parseInt(line, &node)) {
+            LOG_ERROR << "Cannot determine NUMA node of network interface " << nic;
+            return false;
+        }
+        if (node < 0) {
+            LOG_WARN << "Network interface " << nic << " has no NUMA affinity, using node 0";
+            node = 0;
+        }
+        ok = cpusOfNode(node, cpus);
+    } else {
+        ok = parseCpuList(spec, cpus);
+    }
+
+    if (!ok || cpus->empty()) {
+        LOG_ERROR << "Invalid CPU set: " << spec;
+        cpus->clear();
+        return false;
+    }
+    return true;
+}
+
+bool CpuAffinity::pinCurrentThread(const std::vector<int>& cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+    int ret = ::pthread_setaffinity_np(::pthread_self(), sizeof set, &set);
+    if (ret != 0) {
+        LOG_ERROR << "Failed to pin thread to CPUs " << format(cpus) << ": error " << ret;
+        return false;
+    }
+    return true;
+}
+
+int CpuAffinity::numaNodeOfCpu(int cpu)
+{
+    // /sys/devices/system/cpu/cpuN/ 下有一个 nodeM 目录
+    std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/node";
+    for (int node = 0; node < 64; ++node) {
+        struct stat st;
+        if (::stat((dir + std::to_string(node)).c_str(), &st) == 0) {
+            return node;
+        }
+    }
+    return -1;
+}
+
+std::string CpuAffinity::format(const std::vector<int>& cpus)
+{
+    std::string result;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+            ++j;
+        }
+        if (!result.empty()) {
+            result += ',';
+        }
+        result += std::to_string(cpus[i]);
+        if (j > i) {
+            result += '-';
+            result += std::to_string(cpus[j]);
+        }
+        i = j + 1;
+    }
+    return result;
+}
@@ -0,0 +1,36 @@
+#ifndef CPU_AFFINITY_H
+#define CPU_AFFINITY_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// CPU亲和性设置
+//
+// CPU集合的写法:
+//   0-7,16-23   CPU编号列表，支持区间
+//   node:1      NUMA节点1上的所有CPU
+//   nic:eth0    网卡eth0所在NUMA节点上的所有CPU，I/O线程与网卡中断处理在同一节点上
+// 网卡中断本身的亲和性（/proc/irq/*/smp_affinity）属于系统配置，由部署脚本设置。
+class CpuAffinity {
+public:
+    // 解析 "0-3,8,10-11" 格式的CPU列表，格式错误时返回false
+    static bool parseCpuList(std::string_view list, std::vector<int>* cpus);
+
+    // 解析上述三种写法之一，空字符串得到空集合；无法解析或集合为空时返回false
+    static bool resolve(const std::string& spec, std::vector<int>* cpus);
+
+    // 把当前线程绑定到给定CPU集合
+    static bool pinCurrentThread(const std::vector<int>& cpus);
+
+    // 把当前线程绑定到单个CPU
+    static bool pinCurrentThread(int cpu) { return pinCurrentThread(std::vector<int>{cpu}); }
+
+    // CPU所在的NUMA节点，未知时返回-1
+    static int numaNodeOfCpu(int cpu);
+
+    // 格式化为 "0-3,8" 形式，用于日志
+    static std::string format(const std::vector<int>& cpus);
+};
+
+#endif // CPU_AFFINITY_H
@@ -0,0 +1,136 @@
+#include "LoopWatchdog.h"
+#include "muduo/base/CurrentThread.h"
+#include "muduo/base/Logging.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+constexpr int64_t kProbeIntervalMicros = static_cast<int64_t>(LoopWatchdog::kProbeInterval * 1000000);
+
+} // namespace
+
+LoopWatchdog::Scope::Scope(Probe* probe, const char* tag)
+    : probe_(probe),
+      prevTag_(nullptr),
+      prevSince_(0)
+{
+    if (probe_) {
+        prevTag_ = probe_->activeTag.load(std::memory_order_relaxed);
+        prevSince_ = probe_->activeSince.load(std::memory_order_relaxed);
+        probe_->activeSince.store(nowMicros(), std::memory_order_relaxed);
+        probe_->activeTag.store(tag, std::memory_order_release);
+    }
+}
+
+LoopWatchdog::Scope::~Scope()
+{
+    if (probe_) {
+        probe_->activeSince.store(prevSince_, std::memory_order_relaxed);
+        probe_->activeTag.store(prevTag_, std::memory_order_release);
+    }
+}
+
+LoopWatchdog::~LoopWatchdog()
+{
+    stop();
+}
+
+int64_t LoopWatchdog::nowMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+LoopWatchdog::Probe* LoopWatchdog::watch(muduo::net::EventLoop* loop)
+{
+    auto probe = std::make_unique<Probe>();
+    probe->name = muduo::CurrentThread::name();
+    probe->tid = muduo::CurrentThread::tid();
+    probe->lastBeat.store(nowMicros(), std::memory_order_relaxed);
+    
+    Probe* probePtr = probe.get();
+    loop->runEvery(kProbeInterval, [probePtr]() {
+        int64_t now = nowMicros();
+        if (probePtr->expectedBeat > 0) {
+            probePtr->timerLag.record(static_cast<uint64_t>(std::max<int64_t>(0, now - probePtr->expectedBeat)));
+        }
+        probePtr->expectedBeat = now + kProbeIntervalMicros;
+        probePtr->lastBeat.store(now, std::memory_order_relaxed);
+    });
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    probes_.push_back(std::move(probe));
+    return probePtr;
+}
+
+void LoopWatchdog::start()
+{
+    if (thresholdMs_ <= 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    thread_ = std::thread(&LoopWatchdog::run, this);
+    LOG_INFO << "Event loop watchdog started with threshold " << thresholdMs_ << "ms";
+}
+
+void LoopWatchdog::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    stopCond_.notify_all();
+    thread_.join();
+}
+
+void LoopWatchdog::run()
+{
+    // 检查间隔为阈值的四分之一，报警时间最多比阈值晚四分之一
+    const auto interval = std::chrono::milliseconds(std::max(10, thresholdMs_ / 4));
+    
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        stopCond_.wait_for(lock, interval, [this]() { return !running_; });
+        int64_t now = nowMicros();
+        for (auto& probe : probes_) {
+            check(*probe, now);
+        }
+    }
+}
+
+void LoopWatchdog::check(Probe& probe, int64_t now)
+{
+    // 定时器本应在 lastBeat + kProbeInterval 触发
+    int64_t blockedMicros = now - probe.lastBeat.load(std::memory_order_relaxed) - kProbeIntervalMicros;
+    if (blockedMicros <= static_cast<int64_t>(thresholdMs_) * 1000) {
+        if (probe.stalled) {
+            probe.stalled = false;
+            LOG_WARN << "Event loop " << probe.name << " (tid " << probe.tid << ") recovered";
+        }
+        return;
+    }
+    if (probe.stalled) {
+        return;
+    }
+    
+    // 每次阻塞只报警一次
+    probe.stalled = true;
+    probe.stalls.fetch_add(1, std::memory_order_relaxed);
+    const char* tag = probe.activeTag.load(std::memory_order_acquire);
+    if (tag) {
+        int64_t activeMicros = now - probe.activeSince.load(std::memory_order_relaxed);
+        LOG_WARN << "Event loop " << probe.name << " (tid " << probe.tid << ") blocked for "
+                 << blockedMicros / 1000 << "ms, in " << tag << " for " << activeMicros / 1000 << "ms";
+    } else {
+        LOG_WARN << "Event loop " << probe.name << " (tid " << probe.tid << ") blocked for "
+                 << blockedMicros / 1000 << "ms outside message handlers";
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef LOOP_WATCHDOG_H
+#define LOOP_WATCHDOG_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "muduo/base/noncopyable.h"
+#include "muduo/net/EventLoop.h"
+#include "../metrics/Histogram.h"
+
+// 事件循环看门狗
+//
+// 每个I/O线程注册一个探针，探针定时器每 kProbeInterval 触发一次，记录实际触发时间与计划时间之差，
+// 即事件循环的延迟；定时器迟迟不触发说明事件循环没有回到 epoll_wait。
+// 看门狗线程定期检查各探针，超过阈值时输出警告，并带上该线程当前正在执行的操作（由 Scope 标记）。
+class LoopWatchdog : muduo::noncopyable {
+public:
+    // 探针定时器间隔（秒）
+    static constexpr double kProbeInterval = 0.05;
+
+    // 一个事件循环的探针
+    struct Probe {
+        std::string name;
+        int tid = 0;
+        std::atomic<int64_t> lastBeat{0};               // 最近一次定时器触发的时间（微秒）
+        std::atomic<const char*> activeTag{nullptr};    // 正在执行的操作，为空时表示空闲
+        std::atomic<int64_t> activeSince{0};            // 开始执行该操作的时间（微秒）
+        std::atomic<uint64_t> stalls{0};                // 超过阈值的次数
+        Histogram timerLag;                             // 定时器延迟（微秒）
+
+        int64_t expectedBeat = 0;   // 只在所属线程中访问
+        bool stalled = false;       // 只在看门狗线程中访问
+    };
+
+    // 标记当前线程正在执行的操作，可以嵌套，看门狗报告最内层的标记
+    class Scope : muduo::noncopyable {
+    public:
+        Scope(Probe* probe, const char* tag);
+        ~Scope();
+
+    private:
+        Probe* probe_;
+        const char* prevTag_;
+        int64_t prevSince_;
+    };
+
+    LoopWatchdog() = default;
+    ~LoopWatchdog();
+
+    // 事件循环超过 thresholdMs 毫秒没有响应时报警，0 表示不启动看门狗线程（探针照常记录延迟）
+    // 需在start之前调用
+    void setThreshold(int thresholdMs) { thresholdMs_ = thresholdMs; }
+    int threshold() const { return thresholdMs_; }
+
+    // 在事件循环所属线程中调用，注册探针并启动探针定时器
+    Probe* watch(muduo::net::EventLoop* loop);
+
+    // 启动、停止看门狗线程
+    void start();
+    void stop();
+
+    // 当前单调时钟（微秒）
+    static int64_t nowMicros();
+
+private:
+    void run();
+    void check(Probe& probe, int64_t now);
+
+    int thresholdMs_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable stopCond_;
+    bool running_ = false;
+    std::thread thread_;
+    std::vector<std::unique_ptr<Probe>> probes_;
+};
+
+#endif // LOOP_WATCHDOG_H
@@ -0,0 +1,128 @@
+#include "Request.h"
+#include "../wire/WireFormat.h"
+#include <charconv>
+#include <stdexcept>
+
+bool Request::parse(std::string_view payload)
+{
+    count_ = 0;
+
+    while (!payload.empty()) {
+        size_t end = payload.find(';');
+        std::string_view item = payload.substr(0, end);
+        payload.remove_prefix(end == std::string_view::npos ? payload.size() : end + 1);
+
+        // 没有等号的片段直接忽略，与旧解析逻辑一致
+        size_t pos = item.find('=');
+        if (pos == std::string_view::npos) {
+            continue;
+        }
+
+        if (count_ == kMaxFields) {
+            return false;
+        }
+        fields_[count_].first = item.substr(0, pos);
+        fields_[count_].second = item.substr(pos + 1);
+        ++count_;
+    }
+    return true;
+}
+
+bool Request::parseFields(std::string_view payload)
+{
+    count_ = 0;
+
+    int fieldNumber = 0;
+    wire::WireType type = wire::VARINT;
+    wire::Reader reader(payload);
+    while (reader.next(&fieldNumber, &type)) {
+        if (fieldNumber != 1 && fieldNumber != wire::kRidField) {
+            if (!reader.skip(type)) {
+                return false;
+            }
+            continue;
+        }
+
+        std::string_view bytes;
+        if (type != wire::LENGTH_DELIMITED || !reader.readBytes(&bytes)) {
+            return false;
+        }
+        if (count_ == kMaxFields) {
+            return false;
+        }
+
+        Field& field = fields_[count_];
+        if (fieldNumber == wire::kRidField) {
+            field.first = "rid";
+            field.second = bytes;
+            ++count_;
+            continue;
+        }
+
+        // Field { string key = 1; string value = 2; }
+        field.first = std::string_view();
+        field.second = std::string_view();
+        wire::Reader item(bytes);
+        int itemNumber = 0;
+        wire::WireType itemType = wire::VARINT;
+        while (item.next(&itemNumber, &itemType)) {
+            std::string_view* target = itemNumber == 1 ? &field.first :
+                                       itemNumber == 2 ? &field.second : nullptr;
+            if (!target) {
+                if (!item.skip(itemType)) {
+                    return false;
+                }
+                continue;
+            }
+            if (itemType != wire::LENGTH_DELIMITED || !item.readBytes(target)) {
+                return false;
+            }
+        }
+        if (!item.ok()) {
+            return false;
+        }
+        ++count_;
+    }
+    return reader.ok();
+}
+
+thread_local RequestScope* RequestScope::current_ = nullptr;
+
+bool RequestScope::isValidRid(std::string_view rid)
+{
+    if (rid.empty() || rid.size() > kMaxRidLength) {
+        return false;
+    }
+    for (char c : rid) {
+        bool valid = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+                     (c >= 'A' && c <= 'Z') || c == '-' || c == '_';
+        if (!valid) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int toInt(std::string_view value)
+{
+    const char* begin = value.data();
+    const char* end = begin + value.size();
+
+    // 兼容std::stoi允许的前导空白和正号
+    while (begin != end && (*begin == ' ' || *begin == '\t')) {
+        ++begin;
+    }
+    if (begin != end && *begin == '+') {
+        ++begin;
+    }
+
+    int result = 0;
+    auto [ptr, ec] = std::from_chars(begin, end, result);
+    if (ec == std::errc::result_out_of_range) {
+        throw std::out_of_range("toInt");
+    }
+    if (ec != std::errc() || ptr == begin) {
+        throw std::invalid_argument("toInt");
+    }
+    return result;
+}
@@ -0,0 +1,105 @@
+#ifndef REQUEST_H
+#define REQUEST_H
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include "muduo/base/LogStream.h"
+
+// 请求消息
+//
+// 直接在输入缓冲区上切分 key1=value1;key2=value2;... 格式的内容，
+// 键值对以 string_view 形式保存在定长数组中，解析过程不分配内存。
+// 引用的缓冲区必须在请求处理期间保持有效。
+class Request {
+public:
+    // 与 std::unordered_map 的迭代器保持一致的字段名，便于处理函数使用
+    struct Field {
+        std::string_view first;   // 键
+        std::string_view second;  // 值
+    };
+
+    using const_iterator = const Field*;
+
+    // 单个请求允许的最大字段数量
+    static constexpr size_t kMaxFields = 16;
+
+    Request() = default;
+
+    // 解析消息内容，字段数量超过上限时返回false
+    bool parse(std::string_view payload);
+
+    // 解析二进制 Fields 消息（见 src/wire/Messages.schema），同样直接引用输入数据，
+    // 保留字段 rid 作为名为 "rid" 的字段。格式错误或字段数量超过上限时返回false
+    bool parseFields(std::string_view payload);
+
+    // 按帧标志位选择解析方式
+    bool parse(std::string_view payload, bool wireFormat) {
+        return wireFormat ? parseFields(payload) : parse(payload);
+    }
+
+    // 查找字段，同名字段以最后一次出现的为准；未找到时返回end()
+    const_iterator find(std::string_view key) const {
+        for (size_t i = count_; i > 0; --i) {
+            if (fields_[i - 1].first == key) {
+                return &fields_[i - 1];
+            }
+        }
+        return end();
+    }
+
+    const_iterator begin() const { return fields_.data(); }
+    const_iterator end() const { return fields_.data() + count_; }
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+
+private:
+    std::array<Field, kMaxFields> fields_;
+    size_t count_ = 0;
+};
+
+// 请求作用域
+//
+// 处理带 rid 字段的请求期间在栈上创建，编解码器据此在发往同一连接的响应中回显 rid，
+// 客户端可以用它匹配乱序完成的响应。作用域只对当前线程有效，可以嵌套。
+class RequestScope {
+public:
+    // 单个 rid 的最大长度
+    static constexpr size_t kMaxRidLength = 64;
+
+    RequestScope(const void* connection, std::string_view rid)
+        : connection_(connection), rid_(rid), previous_(current_) {
+        current_ = this;
+    }
+    ~RequestScope() { current_ = previous_; }
+
+    RequestScope(const RequestScope&) = delete;
+    RequestScope& operator=(const RequestScope&) = delete;
+
+    // 当前线程正在处理该连接的请求时返回其 rid，否则返回空
+    static std::string_view ridFor(const void* connection) {
+        return (current_ && current_->connection_ == connection) ? current_->rid_ : std::string_view();
+    }
+
+    // rid 只能由字母、数字、'-'、'_' 组成，长度不超过 kMaxRidLength
+    static bool isValidRid(std::string_view rid);
+
+private:
+    const void* connection_;
+    std::string_view rid_;
+    RequestScope* previous_;
+
+    static thread_local RequestScope* current_;
+};
+
+// 将字段值转换为整数，失败时与std::stoi一样抛出
+// std::invalid_argument 或 std::out_of_range
+int toInt(std::string_view value);
+
+// 允许直接输出字段值到日志
+inline muduo::LogStream& operator<<(muduo::LogStream& stream, std::string_view value) {
+    stream.append(value.data(), static_cast<int>(value.size()));
+    return stream;
+}
+
+#endif // REQUEST_H
@@ -0,0 +1,220 @@
+#include "ServerConfig.h"
+#include "../service/IdGenerator.h"
+#include "muduo/base/Logging.h"
+#include <charconv>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+std::string trim(const std::string& text)
+{
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(begin, end - begin + 1);
+}
+
+template <typename T>
+bool parseNumber(const std::string& text, T* value)
+{
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), *value);
+    return ec == std::errc() && ptr == text.data() + text.size();
+}
+
+bool parseBool(const std::string& text, bool* value)
+{
+    if (text == "1" || text == "true" || text == "on" || text == "yes") {
+        *value = true;
+        return true;
+    }
+    if (text == "0" || text == "false" || text == "off" || text == "no") {
+        *value = false;
+        return true;
+    }
+    return false;
+}
+
+// 正整数配置项
+bool parsePositive(const std::string& text, int* value)
+{
+    int parsed = 0;
+    if (!parseNumber(text, &parsed) || parsed <= 0) {
+        return false;
+    }
+    *value = parsed;
+    return true;
+}
+
+} // namespace
+
+bool ServerConfig::set(const std::string& key, const std::string& value)
+{
+    bool ok = true;
+    if (key == "ip") {
+        ip = value;
+    } else if (key == "port") {
+        ok = parseNumber(value, &port) && port != 0;
+    } else if (key == "reuse_port") {
+        ok = parseBool(value, &reusePort);
+    } else if (key == "metrics_ip") {
+        metricsIp = value;
+    } else if (key == "metrics_port") {
+        ok = parseNumber(value, &metricsPort);
+    } else if (key == "node_id") {
+        ok = parseNumber(value, &nodeId) && nodeId >= 0 && nodeId <= 255;
+    } else if (key == "io_threads") {
+        ok = parsePositive(value, &ioThreads);
+    } else if (key == "worker_threads") {
+        // 消息ID由工作线程生成，每个工作线程占用一个ID线程槽
+        ok = parsePositive(value, &workerThreads) && workerThreads <= IdGenerator::kMaxThreads;
+    } else if (key == "max_in_flight") {
+        ok = parsePositive(value, &maxInFlight);
+    } else if (key == "io_cpus") {
+        ioCpus = value;
+    } else if (key == "worker_cpus") {
+        workerCpus = value;
+    } else if (key == "redis_host") {
+        redisHost = value;
+    } else if (key == "redis_port") {
+        ok = parsePositive(value, &redisPort);
+    } else if (key == "redis_password") {
+        redisPassword = value;
+    } else if (key == "redis_db") {
+        ok = parseNumber(value, &redisDb) && redisDb >= 0;
+    } else if (key == "redis_pool_size") {
+        ok = parsePositive(value, &redisPoolSize);
+    } else if (key == "large_group_threshold") {
+        ok = parseNumber(value, &largeGroupThreshold) && largeGroupThreshold >= 0;
+    } else if (key == "group_log_length") {
+        ok = parsePositive(value, &groupLogLength);
+    } else if (key == "message_stream_max_length") {
+        ok = parseNumber(value, &messageStreamMaxLength) && messageStreamMaxLength > 0;
+    } else if (key == "pg_conninfo") {
+        pgConninfo = value;
+    } else if (key == "pg_pool_size") {
+        ok = parsePositive(value, &pgPoolSize);
+    } else if (key == "write_coalescing") {
+        ok = parseBool(value, &writeCoalescing);
+    } else if (key == "compression") {
+        ok = parseBool(value, &compression);
+    } else if (key == "compression_threshold") {
+        ok = parseNumber(value, &compressionThreshold);
+    } else if (key == "idle_timeout") {
+        ok = parsePositive(value, &idleTimeout);
+    } else if (key == "idle_tick") {
+        ok = parsePositive(value, &idleTick);
+    } else if (key == "trace_sample_rate") {
+        ok = parseNumber(value, &traceSampleRate) && traceSampleRate >= 0.0 && traceSampleRate <= 1.0;
+    } else if (key == "trace_buffer_spans") {
+        ok = parsePositive(value, &traceBufferSpans);
+    } else if (key == "trace_file") {
+        traceFile = value;
+    } else if (key == "watchdog_threshold_ms") {
+        ok = parseNumber(value, &watchdogThresholdMs) && watchdogThresholdMs >= 0;
+    } else {
+        LOG_ERROR << "Unknown config key: " << key;
+        return false;
+    }
+    
+    if (!ok) {
+        LOG_ERROR << "Invalid value for " << key << ": " << value;
+    }
+    return ok;
+}
+
+bool ServerConfig::loadFile(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file) {
+        LOG_ERROR << "Cannot open config file " << path;
+        return false;
+    }
+    
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(file, line)) {
+        ++lineNo;
+        // 只支持整行注释，值（如密码）中可以包含 #
+        line = trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            LOG_ERROR << path << ":" << lineNo << ": expected key = value";
+            return false;
+        }
+        if (!set(trim(line.substr(0, eq)), trim(line.substr(eq + 1)))) {
+            LOG_ERROR << path << ":" << lineNo << ": invalid setting";
+            return false;
+        }
+    }
+    
+    LOG_INFO << "Loaded config file " << path;
+    return true;
+}
+
+bool ServerConfig::load(int argc, char* argv[])
+{
+    std::vector<std::string> positional;
+    std::vector<std::pair<std::string, std::string>> options;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0) {
+            positional.push_back(arg);
+            continue;
+        }
+        
+        size_t eq = arg.find('=');
+        if (eq == std::string::npos) {
+            LOG_ERROR << "Expected --key=value, got " << arg;
+            return false;
+        }
+        // 命令行中的键允许用 - 代替 _
+        std::string key = arg.substr(2, eq - 2);
+        for (char& c : key) {
+            if (c == '-') {
+                c = '_';
+            }
+        }
+        options.emplace_back(key, arg.substr(eq + 1));
+    }
+    
+    // 先加载配置文件，命令行中的其他选项覆盖文件中的设置
+    for (const auto& [key, value] : options) {
+        if (key == "config" && !loadFile(value)) {
+            return false;
+        }
+    }
+    
+    // 旧的位置参数：端口 [IP] [reuseport]
+    if (positional.size() > 3) {
+        LOG_ERROR << "Too many positional arguments";
+        return false;
+    }
+    if (positional.size() > 0 && !set("port", positional[0])) {
+        return false;
+    }
+    if (positional.size() > 1) {
+        ip = positional[1];
+    }
+    if (positional.size() > 2) {
+        if (positional[2] != "reuseport") {
+            LOG_ERROR << "Unknown argument " << positional[2];
+            return false;
+        }
+        reusePort = true;
+    }
+    
+    for (const auto& [key, value] : options) {
+        if (key != "config" && !set(key, value)) {
+            return false;
+        }
+    }
+    return true;
+}
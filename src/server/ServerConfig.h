@@ -0,0 +1,79 @@
+#ifndef SERVER_CONFIG_H
+#define SERVER_CONFIG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 服务器启动配置
+//
+// 配置来源按优先级从低到高：内置默认值、配置文件（--config=路径）、命令行参数。
+// 配置文件每行一个 key = value，# 开头的行为注释；命令行写作 --key=value，键名与配置文件相同。
+// 为兼容旧的启动方式，仍接受 "端口 [IP] [reuseport]" 形式的位置参数。
+struct ServerConfig {
+    // 监听
+    std::string ip = "0.0.0.0";
+    uint16_t port = 8888;
+    bool reusePort = false;
+    
+    // 指标HTTP服务（GET /metrics），端口为0时不启动
+    std::string metricsIp = "127.0.0.1";
+    uint16_t metricsPort = 8889;
+
+    // 节点ID（0~255），写入消息ID，多个服务器实例必须不同
+    int nodeId = 0;
+
+    // 线程
+    int ioThreads = 4;
+    int workerThreads = 8;    // 不超过 IdGenerator::kMaxThreads
+    int maxInFlight = 4;
+    std::string ioCpus;       // I/O线程绑定的CPU集合，写法见 CpuAffinity，为空时不绑定
+    std::string workerCpus;   // 工作线程可运行的CPU集合
+
+    // Redis
+    std::string redisHost = "127.0.0.1";
+    int redisPort = 6379;
+    std::string redisPassword;   // 为空时不认证
+    int redisDb = 0;
+    int redisPoolSize = 8;
+    
+    // 成员数超过该值的群组改用读扩散（群组日志 + 成员游标），0 表示所有群组都写扩散；
+    // 以及每个大群日志保留的消息条数
+    int largeGroupThreshold = 500;
+    int groupLogLength = 1000;
+    
+    // 消息流（归档队列）保留的记录条数，归档停止期间积压超过该值时最早的记录会被裁剪
+    long long messageStreamMaxLength = 1000000;
+
+    // PostgreSQL，连接串中未给出的用户名和密码由 libpq 从 PGUSER、PGPASSWORD 或 ~/.pgpass 读取
+    std::string pgConninfo = "host=localhost port=5432 dbname=chat_server";
+    int pgPoolSize = 8;
+
+    // 发送
+    bool writeCoalescing = false;
+    bool compression = true;     // 是否接受客户端的压缩协商
+    size_t compressionThreshold = 1024;
+
+    // 空闲连接超时和检查粒度（秒）
+    int idleTimeout = 60;
+    int idleTick = 20;
+    
+    // 事件循环无响应超过该时间（毫秒）时报警，0 表示关闭看门狗
+    int watchdogThresholdMs = 100;
+    
+    // 聊天消息的追踪采样率（0~1）、环形缓冲区容量（span 数量），以及退出时导出追踪记录的文件，为空时不导出
+    double traceSampleRate = 0.001;
+    int traceBufferSpans = 65536;
+    std::string traceFile;
+
+    // 从命令行（及其中指定的配置文件）加载，出错时返回false
+    bool load(int argc, char* argv[]);
+
+    // 加载配置文件
+    bool loadFile(const std::string& path);
+
+    // 设置单个配置项，未知的键或无法解析的值返回false
+    bool set(const std::string& key, const std::string& value);
+};
+
+#endif // SERVER_CONFIG_H
@@ -0,0 +1,126 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <boost/any.hpp>
+#include "muduo/base/Timestamp.h"
+#include "muduo/net/TcpConnection.h"
+#include "ChatCodec.h"
+#include "TimingWheel.h"
+
+// 连接会话状态，通过 TcpConnection::setContext 绑定到连接上
+//
+// userId 可能被其他I/O线程修改（踢下线），使用原子变量；
+// username 和 loginTime 由登录处理函数在该连接的阻塞任务中写入，
+// 登录类任务总是单独执行；groupProgress 由 groupMutex 保护；其余字段只在连接所属的EventLoop中访问。
+struct Session {
+    // 协议模式，由收到的第一个字节决定
+    ChatCodec::Mode mode = ChatCodec::Mode::UNKNOWN;
+    
+    // 已登录的用户ID，未登录时为-1
+    std::atomic<int> userId{-1};
+    
+    // 已登录的用户名
+    std::string username;
+    
+    // 登录时间
+    muduo::Timestamp loginTime;
+    
+    // 收到的消息数量和字节数
+    uint64_t messagesReceived = 0;
+    uint64_t bytesReceived = 0;
+    
+    // 空闲连接时间轮中的条目
+    TimingWheel::WeakEntryPtr idleEntry;
+    
+    // 输出缓冲区超过高水位，暂停推送
+    bool congested = false;
+    
+    // 拥塞期间转存到离线队列的消息数量
+    uint64_t spilledMessages = 0;
+    
+    // 正在工作线程中写入离线队列的转存消息数量；拥塞已解除、等这些写入完成后再补发
+    std::atomic<int> spillsInFlight{0};
+    std::atomic<bool> spillResumePending{false};
+    
+    // 客户端登录时声明会确认离线消息（offlineAck=1）
+    std::atomic<bool> offlineAck{false};
+    
+    // 客户端登录时声明使用二进制消息（wire=1），只在二进制帧模式下生效
+    std::atomic<bool> wireFormat{false};
+    
+    // 登录时协商的压缩算法，只在二进制帧模式下生效
+    std::atomic<ChatCodec::Compression> compression{ChatCodec::Compression::NONE};
+    
+    // 写合并模式下本轮尚未写出的数据
+    muduo::net::Buffer pendingOutput;
+    
+    // 离线消息同步状态，只在连接所属的EventLoop中访问
+    struct OfflineSync {
+        bool active = false;     // 正在发送离线消息
+        bool fetching = false;   // 有一批消息正在工作线程中读取
+        bool needAck = false;    // 客户端确认后才删除离线消息
+        int userId = -1;
+        long long total = 0;     // 开始同步时的离线消息数量，之后到达的消息留到下次登录
+        long long next = 0;      // 下一批的起始下标
+    };
+    OfflineSync offlineSync;
+    
+    // 离线队列头部已读出发送、尚未确认删除的消息数量。读取批次和确认删除都在工作线程中进行，
+    // 由 offlineMutex 串行执行：读取总是从这些消息之后开始，确认只删除其中的消息
+    std::mutex offlineMutex;
+    long long offlineSent = 0;
+    
+    // 大群消息的投递进度。推送在连接所属的EventLoop中进行，登录和下线在工作线程中读写
+    struct GroupMessage {
+        int groupId;
+        long long seq;                                // 群组日志中的序号
+        ChatCodec::EncodedMessagePtr encoded;
+        std::shared_ptr<const std::string> record;    // 离线队列中的记录，拥塞时转存
+    };
+    struct GroupProgress {
+        bool ready = false;                            // 登录时的积压已转入离线队列，可以实时推送
+        std::unordered_map<int, long long> pulled;     // 登录时转入离线队列的最大序号，不超过的消息不再推送
+        std::unordered_map<int, long long> delivered;  // 已连续推送或转存到的序号，下线时保存为游标
+        std::unordered_set<int> stalled;               // 有消息既未推送也未转存的群组，游标不再推进
+        std::vector<GroupMessage> held;                // ready 之前到达的消息
+    };
+    std::mutex groupMutex;
+    GroupProgress groupProgress;
+    
+    // 等待执行的阻塞任务
+    struct PendingTask {
+        std::function<void()> task;
+        bool exclusive;         // 需要等前面的任务完成后单独执行
+        bool required = false;  // 不能丢弃（断开后的清理），不受工作队列上限限制
+        std::string rid;        // 请求的 rid，工作队列已满时的拒绝响应同样回显
+    };
+    std::deque<PendingTask> pendingTasks;
+    
+    // 正在工作线程中执行的任务数量，以及其中是否有单独执行的任务
+    int inFlightTasks = 0;
+    bool exclusiveRunning = false;
+    
+    // 已写入输出缓冲区、等待写完的被追踪消息：trace id 和写入时间（微秒）
+    std::deque<std::pair<uint64_t, int64_t>> tracedWrites;
+};
+
+using SessionPtr = std::shared_ptr<Session>;
+
+// 获取连接绑定的会话，未绑定时返回nullptr
+inline Session* getSession(const muduo::net::TcpConnectionPtr& conn) {
+    const SessionPtr* session = boost::any_cast<SessionPtr>(&conn->getContext());
+    return session ? session->get() : nullptr;
+}
+
+#endif // SESSION_H
@@ -0,0 +1,47 @@
+#include "SessionRegistry.h"
+
+muduo::net::TcpConnectionPtr SessionRegistry::bind(int userId, const muduo::net::TcpConnectionPtr& conn)
+{
+    UserShard& shard = userShard(userId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    muduo::net::TcpConnectionPtr& slot = shard.users[userId];
+    muduo::net::TcpConnectionPtr previous;
+    if (slot != conn) {
+        previous.swap(slot);
+        slot = conn;
+    }
+    return previous;
+}
+
+bool SessionRegistry::unbind(int userId, const muduo::net::TcpConnectionPtr& conn)
+{
+    UserShard& shard = userShard(userId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.users.find(userId);
+    if (it == shard.users.end() || it->second != conn) {
+        return false;
+    }
+    shard.users.erase(it);
+    return true;
+}
+
+muduo::net::TcpConnectionPtr SessionRegistry::find(int userId) const
+{
+    const UserShard& shard = userShard(userId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.users.find(userId);
+    return it != shard.users.end() ? it->second : muduo::net::TcpConnectionPtr();
+}
+
+size_t SessionRegistry::userCount() const
+{
+    size_t count = 0;
+    for (const UserShard& shard : userShards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        count += shard.users.size();
+    }
+    return count;
+}
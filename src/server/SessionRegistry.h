@@ -0,0 +1,48 @@
+#ifndef SESSION_REGISTRY_H
+#define SESSION_REGISTRY_H
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include "muduo/base/noncopyable.h"
+#include "muduo/net/TcpConnection.h"
+
+// 会话注册表
+//
+// 多个I/O线程会同时登录、登出和查找其他用户的连接，
+// 用户映射按userId分片，每个分片独立加锁，不同用户之间的操作互不阻塞。
+// 返回的连接只能通过其所属的EventLoop操作会话状态。
+class SessionRegistry : muduo::noncopyable {
+public:
+    static constexpr size_t kShardCount = 16;
+
+    // 绑定用户与连接，返回被挤下线的旧连接，没有时返回nullptr
+    muduo::net::TcpConnectionPtr bind(int userId, const muduo::net::TcpConnectionPtr& conn);
+
+    // 解除绑定，仅当用户当前绑定的仍是conn时才移除，返回是否移除
+    bool unbind(int userId, const muduo::net::TcpConnectionPtr& conn);
+
+    // 查找用户的连接，不在线时返回nullptr
+    muduo::net::TcpConnectionPtr find(int userId) const;
+
+    // 在线用户数量
+    size_t userCount() const;
+
+private:
+    struct UserShard {
+        mutable std::mutex mutex;
+        std::unordered_map<int, muduo::net::TcpConnectionPtr> users;
+    };
+
+    UserShard& userShard(int userId) {
+        return userShards_[static_cast<unsigned>(userId) % kShardCount];
+    }
+    const UserShard& userShard(int userId) const {
+        return userShards_[static_cast<unsigned>(userId) % kShardCount];
+    }
+
+    std::array<UserShard, kShardCount> userShards_;
+};
+
+#endif // SESSION_REGISTRY_H
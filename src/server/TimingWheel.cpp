@@ -0,0 +1,64 @@
+#include "TimingWheel.h"
+#include "muduo/base/Logging.h"
+
+TimingWheel::Entry::~Entry()
+{
+    muduo::net::TcpConnectionPtr conn = connection.lock();
+    if (conn && conn->connected()) {
+        LOG_INFO << "Connection timeout: " << conn->peerAddress().toIpPort();
+        
+        // 强制关闭连接 - 这将触发 onConnection 回调，进行资源清理
+        conn->forceClose();
+    }
+}
+
+TimingWheel::TimingWheel(muduo::net::EventLoop* loop, int timeoutSeconds, int tickSeconds)
+    : loop_(loop),
+      timeoutSeconds_(timeoutSeconds),
+      tickSeconds_(tickSeconds > 0 ? tickSeconds : 1),
+      buckets_((timeoutSeconds + tickSeconds_ - 1) / tickSeconds_ + 1)
+{
+    // 预先填满，tick时push_back会自动丢弃最旧的格子
+    buckets_.resize(buckets_.capacity());
+}
+
+void TimingWheel::start()
+{
+    loop_->runEvery(tickSeconds_, std::bind(&TimingWheel::onTick, this));
+}
+
+TimingWheel::WeakEntryPtr TimingWheel::add(const muduo::net::TcpConnectionPtr& conn)
+{
+    loop_->assertInLoopThread();
+    EntryPtr entry = std::make_shared<Entry>(conn);
+    entry->lastTick = tick_;
+    buckets_.back().insert(entry);
+    return entry;
+}
+
+void TimingWheel::touch(const WeakEntryPtr& weakEntry)
+{
+    loop_->assertInLoopThread();
+    EntryPtr entry = weakEntry.lock();
+    if (entry && entry->lastTick != tick_) {
+        entry->lastTick = tick_;
+        buckets_.back().insert(std::move(entry));
+    }
+}
+
+size_t TimingWheel::size() const
+{
+    size_t count = 0;
+    for (const Bucket& bucket : buckets_) {
+        count += bucket.size();
+    }
+    return count;
+}
+
+void TimingWheel::onTick()
+{
+    ++tick_;
+    
+    // 丢弃最旧的格子，其中不再出现在其他格子里的条目随之析构并关闭连接
+    buckets_.push_back(Bucket());
+}
@@ -0,0 +1,63 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <cstdint>
+#include <memory>
+#include <unordered_set>
+#include <boost/circular_buffer.hpp>
+#include "muduo/base/noncopyable.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpConnection.h"
+
+// 空闲连接时间轮
+//
+// 每个I/O线程一个实例，只在所属EventLoop中使用，无需加锁。
+// 轮上每个格子保存一段时间内活跃过的连接条目，连接收到消息时把条目放入最新的格子；
+// 每次tick丢弃最旧的格子，条目的最后一个引用释放时关闭对应连接。
+// 每次tick的开销只与最旧格子中的条目数有关，不再遍历全部连接。
+class TimingWheel : muduo::noncopyable {
+public:
+    // 时间轮条目，析构时关闭超时连接
+    struct Entry {
+        explicit Entry(const muduo::net::TcpConnectionPtr& conn)
+            : connection(conn) {}
+        ~Entry();
+
+        std::weak_ptr<muduo::net::TcpConnection> connection;
+        uint64_t lastTick = 0;  // 最近一次放入的格子对应的tick，避免同一格子重复插入
+    };
+
+    using EntryPtr = std::shared_ptr<Entry>;
+    using WeakEntryPtr = std::weak_ptr<Entry>;
+
+    // timeoutSeconds 为空闲超时时间，tickSeconds 为检查粒度，超时精度为一个tick
+    TimingWheel(muduo::net::EventLoop* loop, int timeoutSeconds, int tickSeconds);
+
+    // 开始周期性tick
+    void start();
+
+    // 加入新连接，返回的条目由连接会话保存
+    WeakEntryPtr add(const muduo::net::TcpConnectionPtr& conn);
+
+    // 连接有活动时调用，把条目移到最新的格子
+    void touch(const WeakEntryPtr& weakEntry);
+
+    // 当前各格子中的条目总数（同一条目可能出现在多个格子中）
+    size_t size() const;
+
+    int timeoutSeconds() const { return timeoutSeconds_; }
+    int tickSeconds() const { return tickSeconds_; }
+
+private:
+    using Bucket = std::unordered_set<EntryPtr>;
+
+    void onTick();
+
+    muduo::net::EventLoop* loop_;
+    const int timeoutSeconds_;
+    const int tickSeconds_;
+    uint64_t tick_ = 0;
+    boost::circular_buffer<Bucket> buckets_;
+};
+
+#endif // TIMING_WHEEL_H
@@ -0,0 +1,111 @@
+#include "WorkerPool.h"
+#include "CpuAffinity.h"
+#include "muduo/base/Logging.h"
+#include <exception>
+
+WorkerPool::WorkerPool(const std::string& name, size_t maxQueueSize)
+    : name_(name),
+      maxQueueSize_(maxQueueSize > 0 ? maxQueueSize : 1)
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+    stop();
+}
+
+void WorkerPool::start(int numThreads)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    
+    threads_.reserve(numThreads);
+    for (int i = 0; i < numThreads; ++i) {
+        threads_.emplace_back(&WorkerPool::workerThread, this);
+    }
+    LOG_INFO << name_ << " started with " << numThreads << " threads, max queue size " << maxQueueSize_
+             << (cpus_.empty() ? "" : ", CPUs " + CpuAffinity::format(cpus_));
+}
+
+void WorkerPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+        
+        if (!queue_.empty()) {
+            LOG_WARN << name_ << " stopping with " << queue_.size() << " pending tasks dropped";
+            queue_.clear();
+        }
+    }
+    notEmpty_.notify_all();
+    
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads_.clear();
+}
+
+bool WorkerPool::enqueue(Task task, bool bounded)
+{
+    size_t depth = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_ || (bounded && queue_.size() >= maxQueueSize_)) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        queue_.push_back(std::move(task));
+        depth = queue_.size();
+    }
+    notEmpty_.notify_one();
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    
+    // 记录队列峰值
+    size_t peak = peakQueueSize_.load(std::memory_order_relaxed);
+    while (depth > peak && !peakQueueSize_.compare_exchange_weak(peak, depth, std::memory_order_relaxed)) {
+    }
+    return true;
+}
+
+size_t WorkerPool::queueSize() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+void WorkerPool::workerThread()
+{
+    // 工作线程可以在整个集合内调度，不绑定到单个CPU
+    if (!cpus_.empty()) {
+        CpuAffinity::pinCurrentThread(cpus_);
+    }
+    
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            notEmpty_.wait(lock, [this] { return !queue_.empty() || !running_; });
+            if (!running_) {
+                return;
+            }
+            task = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        
+        try {
+            task();
+        } catch (const std::exception& e) {
+            LOG_ERROR << name_ << " task threw exception: " << e.what();
+        }
+        completed_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "muduo/base/noncopyable.h"
+
+// 阻塞任务线程池
+//
+// 数据库、Redis、SMTP等阻塞调用在这里执行，避免占用I/O线程。
+// 队列有上限，满时 trySubmit 立即返回false，由调用方拒绝请求，I/O线程永远不会被阻塞。
+// 少量不能丢弃的任务通过 submit 提交，不受上限限制。
+class WorkerPool : muduo::noncopyable {
+public:
+    using Task = std::function<void()>;
+
+    WorkerPool(const std::string& name, size_t maxQueueSize);
+    ~WorkerPool();
+
+    // 设置工作线程可以运行的CPU集合，需在start之前调用，为空时不限制
+    void setCpuAffinity(const std::vector<int>& cpus) { cpus_ = cpus; }
+
+    // 启动工作线程
+    void start(int numThreads);
+
+    // 停止工作线程，队列中尚未执行的任务被丢弃
+    void stop();
+
+    // 提交任务，队列已满或线程池已停止时返回false
+    bool trySubmit(Task task) { return enqueue(std::move(task), true); }
+
+    // 提交不能丢弃的任务（如连接断开后的清理），不受队列上限限制，线程池已停止时返回false
+    bool submit(Task task) { return enqueue(std::move(task), false); }
+
+    const std::string& name() const { return name_; }
+    size_t maxQueueSize() const { return maxQueueSize_; }
+
+    // 当前排队的任务数量
+    size_t queueSize() const;
+
+    // 统计信息
+    size_t peakQueueSize() const { return peakQueueSize_.load(std::memory_order_relaxed); }
+    uint64_t submittedCount() const { return submitted_.load(std::memory_order_relaxed); }
+    uint64_t rejectedCount() const { return rejected_.load(std::memory_order_relaxed); }
+    uint64_t completedCount() const { return completed_.load(std::memory_order_relaxed); }
+
+private:
+    // 任务入队，bounded 为true时检查队列上限
+    bool enqueue(Task task, bool bounded);
+
+    // 工作线程函数
+    void workerThread();
+
+    const std::string name_;
+    const size_t maxQueueSize_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::deque<Task> queue_;
+    bool running_ = false;
+    std::vector<std::thread> threads_;
+    std::vector<int> cpus_;
+
+    std::atomic<size_t> peakQueueSize_{0};
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> completed_{0};
+};
+
+#endif // WORKER_POOL_H
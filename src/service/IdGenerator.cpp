@@ -0,0 +1,72 @@
+#include "IdGenerator.h"
+#include <muduo/base/Logging.h>
+#include <chrono>
+
+namespace {
+
+constexpr uint32_t kMaxSequence = (1u << IdGenerator::kSequenceBits) - 1;
+
+// 每个线程的生成状态
+struct ThreadState {
+    int slot = -1;
+    int64_t lastMs = -1;     // 上一个ID使用的时间戳（相对kEpochMs）
+    uint32_t sequence = 0;   // 上一个ID的序号
+};
+
+thread_local ThreadState t_state;
+
+int64_t nowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+IdGenerator& IdGenerator::getInstance() {
+    static IdGenerator instance;
+    return instance;
+}
+
+bool IdGenerator::setNodeId(int nodeId) {
+    if (nodeId < 0 || nodeId > kMaxNodeId) {
+        LOG_ERROR << "Invalid node id " << nodeId << ", must be between 0 and " << kMaxNodeId;
+        return false;
+    }
+    nodeId_.store(nodeId, std::memory_order_relaxed);
+    return true;
+}
+
+uint64_t IdGenerator::next() {
+    ThreadState& state = t_state;
+    if (state.slot < 0) {
+        state.slot = nextSlot_.fetch_add(1, std::memory_order_relaxed);
+        if (state.slot >= kMaxThreads) {
+            LOG_ERROR << "More than " << kMaxThreads << " threads generating message ids, refusing to reuse a thread slot";
+        }
+    }
+    if (state.slot >= kMaxThreads) {
+        // 复用线程槽会让两个线程在同一毫秒内生成相同的ID
+        return 0;
+    }
+
+    int64_t now = nowMs() - kEpochMs;
+    if (now > state.lastMs) {
+        state.lastMs = now;
+        state.sequence = 0;
+    } else if (state.sequence < kMaxSequence) {
+        ++state.sequence;
+    } else {
+        ++state.lastMs;
+        state.sequence = 0;
+    }
+
+    return (static_cast<uint64_t>(state.lastMs) << (kNodeBits + kThreadBits + kSequenceBits)) |
+           (static_cast<uint64_t>(nodeId()) << (kThreadBits + kSequenceBits)) |
+           (static_cast<uint64_t>(state.slot) << kSequenceBits) |
+           state.sequence;
+}
+
+int64_t IdGenerator::timestampOf(uint64_t id) {
+    return static_cast<int64_t>(id >> (kNodeBits + kThreadBits + kSequenceBits)) + kEpochMs;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// 消息ID生成器（Snowflake）
+//
+// 64位ID由高到低为: 1位保留为0 | 41位毫秒时间戳（自2024-01-01起，约69年）| 8位节点ID |
+// 6位线程槽 | 8位线程内序号。
+// 每个线程第一次生成ID时分配一个线程槽，之后只使用自己的序号，不需要加锁，多个节点之间也不需要协调。
+// 线程槽不会回收也不会复用，超过 kMaxThreads 的线程无法生成ID。
+// 同一线程生成的ID严格递增，不同线程和节点之间按毫秒大致有序。
+// 同一毫秒内序号用完时借用下一毫秒；时钟回拨时沿用上次的时间戳，不会产生重复ID。
+class IdGenerator {
+public:
+    static constexpr int kNodeBits = 8;
+    static constexpr int kThreadBits = 6;
+    static constexpr int kSequenceBits = 8;
+    static constexpr int kMaxNodeId = (1 << kNodeBits) - 1;
+    static constexpr int kMaxThreads = 1 << kThreadBits;
+
+    // 2024-01-01 00:00:00 UTC
+    static constexpr int64_t kEpochMs = 1704067200000LL;
+
+    // 单例模式
+    static IdGenerator& getInstance();
+
+    // 设置节点ID（0~255），多个服务器实例必须使用不同的值，需在生成ID之前调用
+    bool setNodeId(int nodeId);
+    int nodeId() const { return nodeId_.load(std::memory_order_relaxed); }
+
+    // 生成下一个ID，线程槽已用完时返回0（有效ID不会为0）
+    uint64_t next();
+
+    // 从ID中取出生成时间（Unix毫秒）
+    static int64_t timestampOf(uint64_t id);
+
+private:
+    IdGenerator() = default;
+    ~IdGenerator() = default;
+
+    // 禁止拷贝和赋值
+    IdGenerator(const IdGenerator&) = delete;
+    IdGenerator& operator=(const IdGenerator&) = delete;
+
+    std::atomic<int> nodeId_{0};
+
+    // 下一个分配的线程槽
+    std::atomic<int> nextSlot_{0};
+};
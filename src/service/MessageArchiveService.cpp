@@ -1,9 +1,14 @@
 #include "MessageArchiveService.h"
 #include "RedisService.h"
+#include "IdGenerator.h"
+#include "../model/ConnectionPool.h"
+#include "../metrics/Metrics.h"
 #include <pqxx/pqxx>
 #include <json/json.h>
+#include <algorithm>
 #include <chrono>
 #include <thread>
+#include <stdexcept>
 #include <muduo/base/Logging.h>
 
 MessageArchiveService& MessageArchiveService::getInstance() {
@@ -11,14 +16,60 @@ MessageArchiveService& MessageArchiveService::getInstance() {
     return instance;
 }
 
-MessageArchiveService::MessageArchiveService() : running_(false) {}
+namespace {
+
+long long nowMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+}
+
+// 归档消费组名称
+const char* const kConsumerGroup = "archiver";
+
+// 按消息ID去重写入，发送者、接收者或群组在数据库中不存在时跳过（受外键约束，整批事务会失败）
+const char* const kInsertPrivateMessage =
+    "INSERT INTO private_messages (message_id, from_user_id, to_user_id, content, timestamp, message_type) "
+    "SELECT $1::bigint, $2::integer, $3::integer, $4::text, TO_TIMESTAMP($5::bigint/1000), $6::varchar "
+    "WHERE EXISTS (SELECT 1 FROM users WHERE id = $2::integer) "
+    "AND EXISTS (SELECT 1 FROM users WHERE id = $3::integer) "
+    "ON CONFLICT (message_id) DO NOTHING";
+
+const char* const kInsertGroupMessage =
+    "INSERT INTO group_messages (message_id, group_id, from_user_id, content, timestamp, message_type) "
+    "SELECT $1::bigint, $2::integer, $3::integer, $4::text, TO_TIMESTAMP($5::bigint/1000), $6::varchar "
+    "WHERE EXISTS (SELECT 1 FROM groups WHERE id = $2::integer) "
+    "AND EXISTS (SELECT 1 FROM users WHERE id = $3::integer) "
+    "ON CONFLICT (message_id) DO NOTHING";
+
+// 由记录内容引起、原样重试也不会成功的错误：数据格式或约束错误，JSON字段类型不符
+bool isRejection(const std::exception& e) {
+    return dynamic_cast<const pqxx::data_exception*>(&e) ||
+           dynamic_cast<const pqxx::integrity_constraint_violation*>(&e) ||
+           dynamic_cast<const Json::Exception*>(&e);
+}
+
+} // namespace
+
+MessageArchiveService::MessageArchiveService()
+    : running_(false),
+      createdTime_(nowMillis()) {
+    MetricsRegistry::getInstance().addCollector([this](PrometheusWriter& writer) {
+        collectMetrics(writer);
+    });
+}
 
 MessageArchiveService::~MessageArchiveService() {
     stop();
 }
 
 bool MessageArchiveService::init() {
-    // TODO: 初始化数据库连接
+    // 节点ID在多个服务器实例之间唯一，重启后不变
+    consumer_ = "archiver-" + std::to_string(IdGenerator::getInstance().nodeId());
+    if (!RedisService::getInstance().createStreamGroup(kConsumerGroup)) {
+        return false;
+    }
+    LOG_INFO << "Message archive consumer " << consumer_ << " ready";
     return true;
 }
 
@@ -52,303 +103,218 @@ void MessageArchiveService::stop() {
 }
 
 void MessageArchiveService::archiveThread() {
+    long long nextFriendshipArchive = 0;
+    int retryDelay = 0;
     while (running_) {
-        // 执行归档操作
-        bool success = archiveMessages();
-        if (success) {
-            LOG_INFO << "Messages archived successfully";
-        } else {
-            LOG_ERROR << "Failed to archive messages";
+        // 好友关系按固定间隔同步
+        if (nowMillis() >= nextFriendshipArchive) {
+            if (archiveFriendships()) {
+                LOG_INFO << "好友关系归档成功";
+            } else {
+                LOG_ERROR << "好友关系归档失败";
+            }
+            nextFriendshipArchive = nowMillis() + ARCHIVE_INTERVAL * 1000LL;
         }
-
-        // 休眠指定时间
+        
+        if (archiveMessages()) {
+            retryDelay = 0;
+            continue;
+        }
+        
+        // 失败的记录留在待确认列表中，退避后重试
+        retryDelay = std::min(std::max(retryDelay * 2, 1), MAX_RETRY_DELAY);
+        LOG_ERROR << "Failed to archive messages, retrying in " << retryDelay << "s";
         std::unique_lock<std::mutex> lock(mutex_);
-        cv_.wait_for(lock, std::chrono::seconds(ARCHIVE_INTERVAL), [this]() { return !running_; });
+        cv_.wait_for(lock, std::chrono::seconds(retryDelay), [this]() { return !running_; });
     }
 }
 
 bool MessageArchiveService::archiveMessages() {
-    try {
-        LOG_INFO << "开始执行消息归档...";
-        bool privateSuccess = true;
-        bool groupSuccess = true;
-        bool friendsSuccess = true;
-        
-        try {
-            privateSuccess = archivePrivateMessages();
-            if (privateSuccess) {
-                LOG_INFO << "私聊消息归档成功";
-            } else {
-                LOG_ERROR << "私聊消息归档失败";
-            }
-        } catch (const std::exception& e) {
-            LOG_ERROR << "私聊消息归档异常: " << e.what();
-            privateSuccess = false;
+    auto& redis = RedisService::getInstance();
+    std::vector<RedisService::StreamEntry> entries;
+    
+    // 先读回上次未能确认的记录（数据库失败或进程重启），没有时等待新记录
+    bool success = redis.readStream(kConsumerGroup, consumer_, BATCH_SIZE, 0, true, &entries);
+    if (success && entries.empty()) {
+        success = redis.readStream(kConsumerGroup, consumer_, BATCH_SIZE, STREAM_BLOCK_MS, false, &entries);
+    }
+    
+    if (success && !entries.empty()) {
+        long long start = nowMillis();
+        BatchResult result = archiveBatch(entries);
+        if (result == BatchResult::REJECTED) {
+            // 整批事务已回滚，逐条写入以免一条记录阻塞整批
+            result = archiveEntries(entries);
         }
-        
-        try {
-            groupSuccess = archiveGroupMessages();
-            if (groupSuccess) {
-                LOG_INFO << "群聊消息归档成功";
-            } else {
-                LOG_ERROR << "群聊消息归档失败";
-            }
-        } catch (const std::exception& e) {
-            LOG_ERROR << "群聊消息归档异常: " << e.what();
-            groupSuccess = false;
+        success = result == BatchResult::DONE;
+        lastDurationMs_.store(nowMillis() - start, std::memory_order_relaxed);
+        archiveRuns_.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    if (success) {
+        lastSuccessTime_.store(nowMillis(), std::memory_order_relaxed);
+    } else {
+        archiveFailures_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return success;
+}
+
+void MessageArchiveService::collectMetrics(PrometheusWriter& writer) {
+    // 归档延迟：距最近一次成功归档（或确认没有积压）的时间，从未成功时从服务创建开始计算
+    long long lastSuccess = lastSuccessTime_.load(std::memory_order_relaxed);
+    long long lagMs = nowMillis() - (lastSuccess > 0 ? lastSuccess : createdTime_);
+    
+    writer.family("chat_archive_lag_seconds", "gauge", "Seconds since the archiver last caught up with the message stream");
+    writer.sample("chat_archive_lag_seconds", "", static_cast<double>(lagMs) / 1000.0);
+    writer.family("chat_archive_last_duration_seconds", "gauge", "Duration of the last archive batch");
+    writer.sample("chat_archive_last_duration_seconds", "",
+                  static_cast<double>(lastDurationMs_.load(std::memory_order_relaxed)) / 1000.0);
+    writer.family("chat_archive_runs_total", "counter", "Archive batches by result");
+    uint64_t failures = archiveFailures_.load(std::memory_order_relaxed);
+    uint64_t runs = std::max(archiveRuns_.load(std::memory_order_relaxed), failures);
+    writer.sample("chat_archive_runs_total", "result=\"success\"", static_cast<double>(runs - failures));
+    writer.sample("chat_archive_runs_total", "result=\"failure\"", static_cast<double>(failures));
+    writer.family("chat_archive_messages_total", "counter", "Messages read from the stream by archive result");
+    writer.sample("chat_archive_messages_total", "result=\"archived\"",
+                  static_cast<double>(archivedMessages_.load(std::memory_order_relaxed)));
+    writer.sample("chat_archive_messages_total", "result=\"skipped\"",
+                  static_cast<double>(skippedMessages_.load(std::memory_order_relaxed)));
+    writer.sample("chat_archive_messages_total", "result=\"dead_letter\"",
+                  static_cast<double>(deadLetterMessages_.load(std::memory_order_relaxed)));
+    writer.family("chat_archive_trimmed_messages_total", "counter",
+                  "Skipped messages that were trimmed from the stream before they were archived");
+    writer.sample("chat_archive_trimmed_messages_total", "",
+                  static_cast<double>(trimmedMessages_.load(std::memory_order_relaxed)));
+}
+
+MessageArchiveService::BatchResult MessageArchiveService::archiveEntries(
+    const std::vector<std::pair<std::string, std::string>>& entries) {
+    BatchResult overall = BatchResult::DONE;
+    for (const auto& entry : entries) {
+        BatchResult result = archiveBatch({entry});
+        if (result == BatchResult::RETRY) {
+            // 数据库不可用，之前写入的记录已确认，其余的下次重新读取
+            return result;
         }
-        
-        try {
-            friendsSuccess = archiveFriendships();
-            if (friendsSuccess) {
-                LOG_INFO << "好友关系归档成功";
-            } else {
-                LOG_ERROR << "好友关系归档失败";
-            }
-        } catch (const std::exception& e) {
-            LOG_ERROR << "好友关系归档异常: " << e.what();
-            friendsSuccess = false;
+        if (result == BatchResult::DONE) {
+            rejectedAttempts_.erase(entry.first);
+            continue;
         }
         
-        return privateSuccess || groupSuccess || friendsSuccess; // 只要有一种归档成功，就返回true
-    } catch (const std::exception& e) {
-        LOG_ERROR << "Archive messages error: " << e.what();
-        return false;
+        int attempts = ++rejectedAttempts_[entry.first];
+        if (attempts < MAX_ENTRY_ATTEMPTS) {
+            LOG_WARN << "Stream entry " << entry.first << " rejected by the archive (attempt " << attempts
+                     << "/" << MAX_ENTRY_ATTEMPTS << ")";
+            overall = BatchResult::REJECTED;
+            continue;
+        }
+        if (!deadLetter(entry)) {
+            return BatchResult::RETRY;
+        }
+        rejectedAttempts_.erase(entry.first);
     }
+    return overall;
 }
 
-bool MessageArchiveService::archivePrivateMessages() {
-    try {
-        // 创建数据库连接
-        pqxx::connection conn("host=localhost port=5432 dbname=chat_server user=sqhh99 password=2932897504xu");
-        
-        // 获取所有聊天会话
-        auto& redis = RedisService::getInstance();
-        
-        // 从Redis获取所有聊天会话键
-        // 这里假设Redis中以chat:userId1:userId2格式存储私聊消息
-        std::vector<std::string> chatKeys = redis.getKeys("chat:*");
-        
-        for (const auto& chatKey : chatKeys) {
-            // 获取上次归档时间
-            long long lastArchiveTime = getLastArchiveTime(chatKey);
-            
-            // 解析用户ID
-            size_t pos1 = chatKey.find(':');
-            size_t pos2 = chatKey.find(':', pos1 + 1);
-            if (pos1 == std::string::npos || pos2 == std::string::npos) {
-                continue;
-            }
-            
-            // 这些用户ID可以用于归档日志或未来扩展功能
-            // int userId1 = std::stoi(chatKey.substr(pos1 + 1, pos2 - pos1 - 1));
-            // int userId2 = std::stoi(chatKey.substr(pos2 + 1));
-            
-            // 获取需要归档的消息
-            std::vector<std::string> messages = redis.getAllListItems(chatKey);
-            
-            if (messages.empty()) {
-                continue;
-            }
-            
-            // 开始事务
-            pqxx::work txn(conn);
-            
-            // 当前时间戳，用于记录归档时间
-            long long currentTime = std::chrono::duration_cast<std::chrono::milliseconds>(
-                std::chrono::system_clock::now().time_since_epoch()
-            ).count();
-            
-            // 处理每条消息
-            for (const auto& messageStr : messages) {
-                Json::Value message;
-                Json::Reader reader;
-                if (!reader.parse(messageStr, message)) {
-                    LOG_ERROR << "Failed to parse message JSON: " << messageStr;
-                    continue;
-                }
-                
-                // 获取消息时间戳
-                long long timestamp = message["timestamp"].asInt64();
-                
-                // 跳过已归档的消息
-                if (timestamp <= lastArchiveTime) {
-                    continue;
-                }
-                
-                // 插入消息到数据库
-                txn.exec_params(
-                    "INSERT INTO private_messages (from_user_id, to_user_id, content, timestamp, message_type) "
-                    "VALUES ($1, $2, $3, TO_TIMESTAMP($4::bigint/1000), $5)",
-                    message["from"].asString(),
-                    message["to"].asString(),
-                    message["content"].asString(),
-                    std::to_string(timestamp),
-                    message["type"].asString());
-            }
-            
-            // 提交事务
-            txn.commit();
-            
-            // 更新最后归档时间
-            updateLastArchiveTime(chatKey, currentTime);
-            
-            // 清理已归档的消息
-            cleanupArchivedMessages(chatKey, currentTime);
-        }
-        
-        return true;
-    } catch (const std::exception& e) {
-        LOG_ERROR << "Archive private messages error: " << e.what();
+bool MessageArchiveService::deadLetter(const std::pair<std::string, std::string>& entry) {
+    // 先写日志再确认，确认失败时下次重新读取，日志中可能出现两次
+    LOG_ERROR << "Dead-lettered stream entry " << entry.first << " after " << MAX_ENTRY_ATTEMPTS
+              << " rejected attempts: " << entry.second;
+    if (!RedisService::getInstance().ackStream(kConsumerGroup, {entry.first})) {
         return false;
     }
+    deadLetterMessages_.fetch_add(1, std::memory_order_relaxed);
+    return true;
 }
 
-bool MessageArchiveService::archiveGroupMessages() {
+MessageArchiveService::BatchResult MessageArchiveService::archiveBatch(
+    const std::vector<std::pair<std::string, std::string>>& entries) {
+    METRICS_LATENCY_SCOPE("archive", "archiveBatch");
     try {
-        // 创建数据库连接
-        pqxx::connection conn("host=localhost port=5432 dbname=chat_server user=sqhh99 password=2932897504xu");
-        
-        // 获取所有群组
-        std::vector<std::string> groupMsgKeys;
-        auto& redis = RedisService::getInstance();
+        // 从连接池借出数据库连接，获取失败时由下面的异常处理返回
+        ConnectionPool::Handle handle = ConnectionPool::getInstance().acquire();
+        if (!handle) {
+            throw std::runtime_error("no database connection available");
+        }
+        pqxx::work txn(*handle);
         
-        // 从Redis获取所有群组消息键
-        groupMsgKeys = redis.getKeys("group:*:messages");
+        Json::CharReaderBuilder builder;
+        std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+        std::vector<std::string> ids;
+        ids.reserve(entries.size());
+        uint64_t archived = 0;
+        uint64_t skipped = 0;
+        uint64_t trimmed = 0;
         
-        for (const auto& groupMsgKey : groupMsgKeys) {
-            // 获取上次归档时间
-            long long lastArchiveTime = getLastArchiveTime(groupMsgKey);
-            
-            // 解析群组ID
-            size_t pos1 = groupMsgKey.find(':');
-            size_t pos2 = groupMsgKey.find(':', pos1 + 1);
-            if (pos1 == std::string::npos || pos2 == std::string::npos) {
-                LOG_WARN << "Invalid group message key format: " << groupMsgKey << ". Skipping archive.";
-                continue;
-            }
-            
-            // 提取群组ID
-            std::string groupIdStr = groupMsgKey.substr(pos1 + 1, pos2 - pos1 - 1);
-            int groupId;
-            try {
-                groupId = std::stoi(groupIdStr);
-            } catch (const std::exception& e) {
-                LOG_ERROR << "Invalid group ID in key " << groupMsgKey << ": " << e.what() << ". Skipping archive.";
-                continue;
-            }
-            
-            // 检查键是否存在且是列表类型
-            if (!redis.keyExists(groupMsgKey)) {
-                LOG_WARN << "Key " << groupMsgKey << " does not exist. Skipping archive.";
-                continue;
-            }
+        for (const auto& entry : entries) {
+            ids.push_back(entry.first);
             
-            if (!redis.isListType(groupMsgKey)) {
-                LOG_WARN << "Key " << groupMsgKey << " is not a list type. Skipping archive.";
-                // 可能需要清理此键，因为它类型错误
-                // redis.delKey(groupMsgKey);
+            // 等待确认期间被 MAXLEN 裁剪掉的记录内容已丢失，计入跳过并记录下来
+            const std::string& messageStr = entry.second;
+            if (messageStr.empty()) {
+                LOG_ERROR << "Stream entry " << entry.first << " was trimmed before it was archived, message lost";
+                ++trimmed;
+                ++skipped;
                 continue;
             }
             
-            // 首先验证数据库中群组是否存在
-            pqxx::work txn(conn);
-            pqxx::result groupExists = txn.exec_params(
-                "SELECT id FROM groups WHERE id = $1",
-                groupId
-            );
-            
-            // 如果群组不存在，跳过归档
-            if (groupExists.empty()) {
-                LOG_WARN << "Group with ID " << groupId << " does not exist in the database. Skipping archive.";
-                txn.abort(); // 确保事务被回滚
+            // 无法解析的记录没有重试的意义，跳过并确认
+            Json::Value message;
+            if (!reader->parse(messageStr.data(), messageStr.data() + messageStr.size(), &message, nullptr) ||
+                !message.isMember("id") || !message.isMember("from")) {
+                LOG_WARN << "Skipped malformed stream entry " << entry.first << ": " << messageStr;
+                ++skipped;
                 continue;
             }
-            txn.commit(); // 提交查询事务
             
-            // 获取需要归档的消息
-            std::vector<std::string> messages = redis.getAllListItems(groupMsgKey);
-            
-            if (messages.empty()) {
+            std::string type = message["type"].asString();
+            std::string timestamp = std::to_string(message["timestamp"].asInt64());
+            pqxx::result result;
+            if (type == "private") {
+                result = txn.exec_params(kInsertPrivateMessage,
+                                         message["id"].asString(),
+                                         message["from"].asString(),
+                                         message["to"].asString(),
+                                         message["content"].asString(),
+                                         timestamp,
+                                         type);
+            } else if (type == "group") {
+                result = txn.exec_params(kInsertGroupMessage,
+                                         message["id"].asString(),
+                                         message["group"].asString(),
+                                         message["from"].asString(),
+                                         message["content"].asString(),
+                                         timestamp,
+                                         type);
+            } else {
+                LOG_WARN << "Skipped stream entry " << entry.first << " with unknown type " << type;
+                ++skipped;
                 continue;
             }
             
-            // 开始新的事务
-            pqxx::work insertTxn(conn);
-            
-            // 当前时间戳，用于记录归档时间
-            long long currentTime = std::chrono::duration_cast<std::chrono::milliseconds>(
-                std::chrono::system_clock::now().time_since_epoch()
-            ).count();
-            
-            // 处理每条消息
-            for (const auto& messageStr : messages) {
-                Json::Value message;
-                Json::Reader reader;
-                if (!reader.parse(messageStr, message)) {
-                    LOG_ERROR << "Failed to parse message JSON: " << messageStr;
-                    continue;
-                }
-                
-                // 获取消息时间戳
-                long long timestamp = message["timestamp"].asInt64();
-                
-                // 跳过已归档的消息
-                if (timestamp <= lastArchiveTime) {
-                    continue;
-                }
-                
-                // 检查消息中的群组ID是否与键中一致
-                if (!message.isMember("group") || message["group"].asString() != groupIdStr) {
-                    LOG_WARN << "Message group ID mismatch or missing. Key: " << groupMsgKey 
-                             << ", Message: " << messageStr << ". Skipping this message.";
-                    continue;
-                }
-                
-                // 检查发送者是否存在
-                if (!message.isMember("from")) {
-                    LOG_WARN << "Message missing sender ID: " << messageStr << ". Skipping this message.";
-                    continue;
-                }
-                
-                try {
-                    // 插入消息到数据库
-                    insertTxn.exec_params(
-                        "INSERT INTO group_messages (group_id, from_user_id, content, timestamp, message_type) "
-                        "VALUES ($1, $2, $3, TO_TIMESTAMP($4::bigint/1000), $5)",
-                        message["group"].asString(),
-                        message["from"].asString(),
-                        message["content"].asString(),
-                        std::to_string(timestamp),
-                        message["type"].asString());
-                } catch (const std::exception& e) {
-                    LOG_ERROR << "Error inserting group message: " << e.what() 
-                              << ". Message: " << messageStr;
-                    continue; // 继续处理其他消息，而不是整体失败
-                }
-            }
-            
-            try {
-                // 提交事务
-                insertTxn.commit();
-                
-                // 更新最后归档时间
-                updateLastArchiveTime(groupMsgKey, currentTime);
-                
-                // 清理已归档的消息
-                cleanupArchivedMessages(groupMsgKey, currentTime);
-                
-                LOG_INFO << "Successfully archived messages for group " << groupId;
-            } catch (const std::exception& e) {
-                LOG_ERROR << "Archive group messages error: " << e.what() << " for group " << groupId;
-                // 事务自动回滚，无需额外操作
+            // 已归档过（重新读取的记录）或关联的用户、群组不在数据库中
+            if (result.affected_rows() > 0) {
+                ++archived;
+            } else {
+                ++skipped;
             }
         }
         
-        return true;
+        txn.commit();
+        
+        // 提交之后才确认，确认失败时这些记录会被重新读取，重复写入被忽略
+        if (!RedisService::getInstance().ackStream(kConsumerGroup, ids)) {
+            return BatchResult::RETRY;
+        }
+        
+        archivedMessages_.fetch_add(archived, std::memory_order_relaxed);
+        skippedMessages_.fetch_add(skipped, std::memory_order_relaxed);
+        trimmedMessages_.fetch_add(trimmed, std::memory_order_relaxed);
+        LOG_DEBUG << "Archived " << archived << " messages, skipped " << skipped;
+        return BatchResult::DONE;
     } catch (const std::exception& e) {
-        LOG_ERROR << "Archive group messages error: " << e.what();
-        return false;
+        LOG_ERROR << "Archive message batch error: " << e.what();
+        return isRejection(e) ? BatchResult::REJECTED : BatchResult::RETRY;
     }
 }
 
@@ -357,8 +323,12 @@ bool MessageArchiveService::archiveFriendships() {
     try {
         LOG_INFO << "开始归档好友关系...";
         
-        // 创建数据库连接
-        pqxx::connection conn("host=localhost port=5432 dbname=chat_server user=sqhh99 password=2932897504xu");
+        // 从连接池借出数据库连接，获取失败时由下面的异常处理返回
+        ConnectionPool::Handle handle = ConnectionPool::getInstance().acquire();
+        if (!handle) {
+            throw std::runtime_error("no database connection available");
+        }
+        pqxx::connection& conn = *handle;
         auto& redis = RedisService::getInstance();
         
         // 获取所有好友关系键
@@ -441,49 +411,8 @@ bool MessageArchiveService::archiveFriendships() {
     }
 }
 
-long long MessageArchiveService::getLastArchiveTime(const std::string& key) {
-    try {
-        std::string archiveKey = key + ":last_archive";
-        std::string timeStr;
-        
-        auto& redis = RedisService::getInstance();
-        if (!redis.keyExists(archiveKey)) {
-            return 0;
-        }
-        
-        timeStr = redis.getValue(archiveKey, "0");
-        return std::stoll(timeStr);
-    } catch (const std::exception& e) {
-        LOG_ERROR << "Get last archive time error: " << e.what();
-        return 0;
-    }
-}
-
-bool MessageArchiveService::updateLastArchiveTime(const std::string& key, long long timestamp) {
-    try {
-        std::string archiveKey = key + ":last_archive";
-        RedisService::getInstance().setValue(archiveKey, std::to_string(timestamp));
-        return true;
-    } catch (const std::exception& e) {
-        LOG_ERROR << "Update last archive time error: " << e.what();
-        return false;
-    }
-}
-
-bool MessageArchiveService::cleanupArchivedMessages(const std::string& key, long long /* timestamp */) {
-    try {
-        // 此处可以实现删除已归档的消息，或者保留最近的N条
-        // 为了安全起见，我们这里只保留最近的100条消息
-        // timestamp参数预留给未来按时间戳清理的功能使用
-        RedisService::getInstance().trimList(key, -100, -1);
-        return true;
-    } catch (const std::exception& e) {
-        LOG_ERROR << "Cleanup archived messages error: " << e.what();
-        return false;
-    }
-}
-
 std::vector<std::string> MessageArchiveService::getHistoricalMessages(int userId1, int userId2, int count, int offset) {
+    METRICS_LATENCY_SCOPE("archive", "getHistoricalMessages");
     std::vector<std::string> messages;
     
     try {
@@ -492,8 +421,12 @@ std::vector<std::string> MessageArchiveService::getHistoricalMessages(int userId
             std::swap(userId1, userId2);
         }
         
-        // 创建数据库连接
-        pqxx::connection conn("host=localhost port=5432 dbname=chat_server user=sqhh99 password=2932897504xu");
+        // 从连接池借出数据库连接，获取失败时由下面的异常处理返回
+        ConnectionPool::Handle handle = ConnectionPool::getInstance().acquire();
+        if (!handle) {
+            throw std::runtime_error("no database connection available");
+        }
+        pqxx::connection& conn = *handle;
         pqxx::work txn(conn);
         
         // 查询历史消息
@@ -531,11 +464,16 @@ std::vector<std::string> MessageArchiveService::getHistoricalMessages(int userId
 }
 
 std::vector<std::string> MessageArchiveService::getHistoricalGroupMessages(int groupId, int count, int offset) {
+    METRICS_LATENCY_SCOPE("archive", "getHistoricalGroupMessages");
     std::vector<std::string> messages;
     
     try {
-        // 创建数据库连接
-        pqxx::connection conn("host=localhost port=5432 dbname=chat_server user=sqhh99 password=2932897504xu");
+        // 从连接池借出数据库连接，获取失败时由下面的异常处理返回
+        ConnectionPool::Handle handle = ConnectionPool::getInstance().acquire();
+        if (!handle) {
+            throw std::runtime_error("no database connection available");
+        }
+        pqxx::connection& conn = *handle;
         pqxx::work txn(conn);
         
         // 查询历史消息
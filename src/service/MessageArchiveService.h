@@ -6,15 +6,25 @@
 #include <thread>
 #include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <mutex>
+#include <unordered_map>
+#include <utility>
 
 // 消息归档服务
+//
+// 私聊和群聊消息在发送时追加到Redis消息流（stream:messages），归档线程以消费组方式持续读取，
+// 每批消息在一个事务中写入PostgreSQL，提交之后才确认（XACK）。数据库失败或进程重启时，
+// 未确认的记录由同一个消费者（按节点ID命名）重新读取，重复写入由 message_id 唯一索引忽略。
+// 被数据库拒绝的批次改为逐条写入，同一条记录被拒绝 MAX_ENTRY_ATTEMPTS 次后记入死信日志并确认，
+// 不再阻塞后面的记录；数据库不可用时不计次数，一直重试。
+// 好友关系仍按固定间隔从Redis同步到数据库。
 class MessageArchiveService {
 public:
     // 单例模式
     static MessageArchiveService& getInstance();
     
-    // 初始化归档服务
+    // 初始化归档服务，创建消息流的消费组，需在Redis服务初始化之后调用
     bool init();
     
     // 启动归档线程
@@ -23,7 +33,8 @@ public:
     // 停止归档线程
     void stop();
     
-    // 手动触发归档
+    // 归档一批消息: 先处理本消费者尚未确认的记录，没有时等待新记录（最多 STREAM_BLOCK_MS 毫秒）
+    // 读取、写入数据库或确认失败时返回false，未确认的记录留待下次重试
     bool archiveMessages();
     
     // 获取消息历史记录从数据库（当Redis中没有时）
@@ -41,23 +52,27 @@ private:
     // 归档线程函数
     void archiveThread();
     
-    // 归档私聊消息
-    bool archivePrivateMessages();
+    // 一批记录的归档结果
+    enum class BatchResult {
+        DONE,      // 已写入并确认
+        RETRY,     // 数据库不可用或确认失败，稍后原样重试
+        REJECTED   // 某条记录被数据库拒绝或无法转换，需要逐条写入找出它
+    };
     
-    // 归档群组消息
-    bool archiveGroupMessages();
+    // 把一批消息流记录写入数据库，提交后确认；entries 为 {流记录ID, 消息记录}
+    BatchResult archiveBatch(const std::vector<std::pair<std::string, std::string>>& entries);
     
-    // 归档好友关系
-    bool archiveFriendships();
+    // 逐条写入被拒绝的批次，多次被拒绝的记录转入死信
+    BatchResult archiveEntries(const std::vector<std::pair<std::string, std::string>>& entries);
     
-    // 清理Redis中已归档的消息
-    bool cleanupArchivedMessages(const std::string& key, long long timestamp);
+    // 放弃一条记录：完整内容写入错误日志以便人工补录，然后确认
+    bool deadLetter(const std::pair<std::string, std::string>& entry);
     
-    // 查询最后归档时间
-    long long getLastArchiveTime(const std::string& key);
+    // 归档好友关系
+    bool archiveFriendships();
     
-    // 更新最后归档时间
-    bool updateLastArchiveTime(const std::string& key, long long timestamp);
+    // 输出归档指标
+    void collectMetrics(class PrometheusWriter& writer);
     
     // 线程相关
     std::unique_ptr<std::thread> archiveThread_;
@@ -65,7 +80,28 @@ private:
     std::mutex mutex_;
     std::condition_variable cv_;
     
+    // 消费者名称，init时按节点ID生成，重启后沿用以便读回未确认的记录
+    std::string consumer_;
+    
+    // 归档统计：服务创建时间、最近一次成功归档（或确认没有积压）的时间（毫秒），最近一批的写入耗时，
+    // 写入的批次数和失败次数，写入和跳过的消息数量，跳过的消息中等待确认期间被裁剪的数量，转入死信的消息数量
+    const long long createdTime_;
+    std::atomic<long long> lastSuccessTime_{0};
+    std::atomic<long long> lastDurationMs_{0};
+    std::atomic<uint64_t> archiveRuns_{0};
+    std::atomic<uint64_t> archiveFailures_{0};
+    std::atomic<uint64_t> archivedMessages_{0};
+    std::atomic<uint64_t> skippedMessages_{0};
+    std::atomic<uint64_t> trimmedMessages_{0};
+    std::atomic<uint64_t> deadLetterMessages_{0};
+    
+    // 逐条写入时各记录被拒绝的次数，只在归档线程中访问
+    std::unordered_map<std::string, int> rejectedAttempts_;
+    
     // 归档配置
-    static constexpr int ARCHIVE_INTERVAL = 3600; // 默认每小时归档一次
+    static constexpr int ARCHIVE_INTERVAL = 3600; // 好友关系每小时归档一次
     static constexpr int BATCH_SIZE = 1000; // 每批处理的消息数量
+    static constexpr long long STREAM_BLOCK_MS = 1000; // 没有新消息时每次等待的时间
+    static constexpr int MAX_RETRY_DELAY = 30; // 失败后重试的最长间隔（秒）
+    static constexpr int MAX_ENTRY_ATTEMPTS = 3; // 同一条记录被拒绝的次数上限，超过后转入死信
 };
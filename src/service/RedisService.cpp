@@ -1,18 +1,190 @@
 #include "RedisService.h"
+#include "IdGenerator.h"
+#include "../metrics/Metrics.h"
+#include <algorithm>
 #include <chrono>
 #include <ctime>
+#include <iterator>
+#include <unordered_map>
 #include <json/json.h>
 
+namespace {
+
+// 私聊发送脚本
+// KEYS: 发送者好友集合、聊天记录列表、在线用户集合、接收者离线队列、聊天记录累计条数、消息索引、消息流
+// ARGV: 接收者ID、消息记录、聊天记录保留条数、消息索引保留秒数、消息流保留条数
+// 返回: -1 不是好友，0 接收者不在线（已加入离线队列），1 接收者在线
+const char* const kSendPrivateScript = R"lua(
+redis.replicate_commands()
+if redis.call('SISMEMBER', KEYS[1], ARGV[1]) == 0 then
+    return -1
+end
+redis.call('RPUSH', KEYS[2], ARGV[2])
+redis.call('LTRIM', KEYS[2], -tonumber(ARGV[3]), -1)
+redis.call('XADD', KEYS[7], 'MAXLEN', '~', ARGV[5], '*', 'data', ARGV[2])
+local pos = redis.call('INCR', KEYS[5]) - 1
+redis.call('HSET', KEYS[6], 'data', ARGV[2], 'list', KEYS[2], 'pos', pos)
+redis.call('EXPIRE', KEYS[6], ARGV[4])
+if redis.call('SISMEMBER', KEYS[3], ARGV[1]) == 1 then
+    return 1
+end
+redis.call('RPUSH', KEYS[4], ARGV[2])
+return 0
+)lua";
+
+// 私聊记录保留的消息条数
+const char* const kPrivateHistoryLength = "100";
+
+// 群聊发送脚本
+// KEYS: 群组键、群成员集合、群聊记录列表、在线用户集合、大群消息序号、大群日志、群聊记录累计条数、消息索引、
+//       消息流
+// ARGV: 发送者ID、消息记录、群聊记录保留条数、大群成员数阈值（0为不启用）、大群日志保留条数、消息索引保留秒数、
+//       消息流保留条数
+// 返回: {"nogroup"} 或 {"notmember"}；成功时为 {"ok", 大群序号, 离线成员数n, 离线成员 x n, 全部成员...}
+// 大群只把消息以 "序号:记录" 写入群组日志，离线成员数为0，离线成员登录时按游标读取；小群的序号为0
+const char* const kSendGroupScript = R"lua(
+redis.replicate_commands()
+if redis.call('EXISTS', KEYS[1]) == 0 then
+    return {'nogroup'}
+end
+if redis.call('SISMEMBER', KEYS[2], ARGV[1]) == 0 then
+    return {'notmember'}
+end
+redis.call('RPUSH', KEYS[3], ARGV[2])
+redis.call('LTRIM', KEYS[3], -tonumber(ARGV[3]), -1)
+redis.call('XADD', KEYS[9], 'MAXLEN', '~', ARGV[7], '*', 'data', ARGV[2])
+local pos = redis.call('INCR', KEYS[7]) - 1
+redis.call('HSET', KEYS[8], 'data', ARGV[2], 'list', KEYS[3], 'pos', pos)
+redis.call('EXPIRE', KEYS[8], ARGV[6])
+local members = redis.call('SMEMBERS', KEYS[2])
+local threshold = tonumber(ARGV[4])
+local offline = {}
+local seq = 0
+if threshold > 0 and #members > threshold then
+    seq = redis.call('INCR', KEYS[5])
+    redis.call('ZADD', KEYS[6], seq, seq .. ':' .. ARGV[2])
+    redis.call('ZREMRANGEBYRANK', KEYS[6], 0, -tonumber(ARGV[5]) - 1)
+else
+    offline = redis.call('SDIFF', KEYS[2], KEYS[4])
+end
+local result = {'ok', tostring(seq), tostring(#offline)}
+for _, id in ipairs(offline) do
+    result[#result + 1] = id
+end
+for _, id in ipairs(members) do
+    result[#result + 1] = id
+end
+return result
+)lua";
+
+// 大群积压消息转入离线队列的脚本，每次只处理一个群组并最多转入 ARGV[2] 条，避免长时间阻塞Redis
+// KEYS: 用户游标哈希、用户离线队列、群组消息序号键、群组日志键
+// ARGV: 群组ID、本次最多转入的消息数量
+// 没有序号键的群组是写扩散的小群，返回 {0, -1}；缺少游标的成员在群组切换为读扩散之前就已加入，从头读取
+// 返回: {转入的消息数量, 最新序号}，转入数量达到上限时游标只推进到最后转入的消息，需要再次调用
+const char* const kPullGroupBacklogScript = R"lua(
+local head = tonumber(redis.call('GET', KEYS[3]))
+if not head then
+    return {0, -1}
+end
+local limit = tonumber(ARGV[2])
+local cursor = tonumber(redis.call('HGET', KEYS[1], ARGV[1]) or '0')
+if head <= cursor then
+    return {0, head}
+end
+local entries = redis.call('ZRANGEBYSCORE', KEYS[4], '(' .. cursor, head, 'LIMIT', 0, limit)
+local last = head
+for _, entry in ipairs(entries) do
+    local sep = string.find(entry, ':', 1, true)
+    redis.call('RPUSH', KEYS[2], string.sub(entry, sep + 1))
+    last = tonumber(string.sub(entry, 1, sep - 1))
+end
+if #entries < limit then
+    last = head
+end
+redis.call('HSET', KEYS[1], ARGV[1], last)
+return {#entries, head}
+)lua";
+
+// 下线时保存大群游标的脚本，游标只向前推进
+// KEYS: 用户游标哈希
+// ARGV: 群组ID、已投递的最大序号，依次成对出现
+const char* const kSaveGroupCursorsScript = R"lua(
+for i = 1, #ARGV, 2 do
+    local cursor = tonumber(redis.call('HGET', KEYS[1], ARGV[i]) or '0')
+    if tonumber(ARGV[i + 1]) > cursor then
+        redis.call('HSET', KEYS[1], ARGV[i], ARGV[i + 1])
+    end
+end
+return 0
+)lua";
+
+// 更新已索引消息的脚本，消息索引和聊天记录中的副本一起修改
+// KEYS: 消息索引、消息所在的聊天记录列表、该列表的累计条数
+// ARGV: 修改前的消息记录、修改后的消息记录、消息在列表中的累计位置
+// 列表只从头部裁剪，消息当前的下标 = 累计位置 - (累计条数 - 列表长度)
+// 返回: -1 消息已被并发修改，0 消息已不在列表中（只更新了索引），1 已更新
+const char* const kUpdateMessageScript = R"lua(
+if redis.call('HGET', KEYS[1], 'data') ~= ARGV[1] then
+    return -1
+end
+redis.call('HSET', KEYS[1], 'data', ARGV[2])
+local pushed = tonumber(redis.call('GET', KEYS[3]) or '0')
+local index = tonumber(ARGV[3]) - (pushed - redis.call('LLEN', KEYS[2]))
+if index >= 0 and redis.call('LINDEX', KEYS[2], index) == ARGV[1] then
+    redis.call('LSET', KEYS[2], index, ARGV[2])
+    return 1
+end
+return 0
+)lua";
+
+// 消息索引（message:<id>）保留时间，撤回和已读回执只针对近期消息
+constexpr long long kMessageIndexTtlSeconds = 7 * 24 * 3600;
+const std::string kMessageIndexTtl = std::to_string(kMessageIndexTtlSeconds);
+
+// 默认的大群成员数阈值和大群日志保留条数
+constexpr int kDefaultLargeGroupThreshold = 500;
+constexpr int kDefaultGroupLogLength = 1000;
+
+// 默认的消息流保留条数
+constexpr long long kDefaultStreamMaxLength = 1000000;
+
+// 群聊记录保留的消息条数
+const char* const kGroupHistoryLength = "200";
+
+// 每次脚本调用最多转入离线队列的大群消息数量
+constexpr long long kGroupBacklogBatch = 200;
+
+} // namespace
+
 RedisService& RedisService::getInstance() {
     static RedisService instance;
     return instance;
 }
 
-RedisService::RedisService() : initialized_(false) {}
+RedisService::RedisService()
+    : initialized_(false),
+      sendPrivateScript_{"send_private", kSendPrivateScript, ""},
+      sendGroupScript_{"send_group", kSendGroupScript, ""},
+      pullGroupBacklogScript_{"pull_group_backlog", kPullGroupBacklogScript, ""},
+      saveGroupCursorsScript_{"save_group_cursors", kSaveGroupCursorsScript, ""},
+      updateMessageScript_{"update_message", kUpdateMessageScript, ""},
+      largeGroupThreshold_(kDefaultLargeGroupThreshold),
+      groupLogLength_(kDefaultGroupLogLength),
+      streamMaxLength_(kDefaultStreamMaxLength) {}
+
+void RedisService::setGroupLogOptions(int largeGroupThreshold, int logLength) {
+    largeGroupThreshold_ = std::max(largeGroupThreshold, 0);
+    groupLogLength_ = std::max(logLength, 1);
+}
+
+void RedisService::setStreamMaxLength(long long maxLength) {
+    streamMaxLength_ = std::max(maxLength, 1LL);
+}
 
 RedisService::~RedisService() {}
 
-bool RedisService::init(const std::string& host, int port, const std::string& password, int db) {
+bool RedisService::init(const std::string& host, int port, const std::string& password, int db, int poolSize) {
     try {
         // 构建连接URI
         std::string uri = "tcp://" + host + ":" + std::to_string(port);
@@ -29,16 +201,27 @@ bool RedisService::init(const std::string& host, int port, const std::string& pa
         
         // 设置连接池选项
         sw::redis::ConnectionPoolOptions pool_options;
-        pool_options.size = 5;  // 连接池大小
+        pool_options.size = poolSize > 0 ? poolSize : 5;  // 连接池大小
         pool_options.wait_timeout = std::chrono::milliseconds(100);  // 连接池等待超时
         
         // 创建Redis客户端
         redis_ = std::make_unique<sw::redis::Redis>(conn_options, pool_options);
         
+        // 消息流的阻塞读取使用单独的连接，不占用工作线程的连接池
+        sw::redis::ConnectionPoolOptions stream_pool_options;
+        stream_pool_options.size = 1;
+        streamRedis_ = std::make_unique<sw::redis::Redis>(conn_options, stream_pool_options);
+        
         // 测试连接
         try {
             redis_->ping();
-            LOG_INFO << "Redis connection established successfully at " << host << ":" << port;
+            LOG_INFO << "Redis connection established successfully at " << host << ":" << port
+                     << ", pool size " << pool_options.size;
+            if (!loadScript(&sendPrivateScript_) || !loadScript(&sendGroupScript_) ||
+                !loadScript(&pullGroupBacklogScript_) || !loadScript(&saveGroupCursorsScript_) ||
+                !loadScript(&updateMessageScript_)) {
+                return false;
+            }
             initialized_ = true;
             return true;
         } catch (const std::exception& e) {
@@ -51,6 +234,40 @@ bool RedisService::init(const std::string& host, int port, const std::string& pa
     }
 }
 
+bool RedisService::loadScript(Script* script) {
+    try {
+        script->sha = redis_->script_load(script->source);
+        LOG_INFO << "Redis script " << script->name << " loaded, sha1 " << script->sha;
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR << "Failed to load Redis script " << script->name << ": " << e.what();
+        return false;
+    }
+}
+
+template <typename Result, typename Keys, typename Args>
+Result RedisService::evalScript(const Script& script, Keys keysFirst, Keys keysLast,
+                                Args argsFirst, Args argsLast) {
+    try {
+        return redis_->evalsha<Result>(script.sha, keysFirst, keysLast, argsFirst, argsLast);
+    } catch (const sw::redis::ReplyError& e) {
+        if (std::string(e.what()).compare(0, 8, "NOSCRIPT") != 0) {
+            throw;
+        }
+    }
+    // 脚本缓存已被清空，SHA1由脚本内容决定，重新加载后不变
+    LOG_WARN << "Redis script " << script.name << " missing on server, reloading";
+    redis_->script_load(script.source);
+    return redis_->evalsha<Result>(script.sha, keysFirst, keysLast, argsFirst, argsLast);
+}
+
+template <typename Result>
+Result RedisService::evalScript(const Script& script,
+                                std::initializer_list<sw::redis::StringView> keys,
+                                std::initializer_list<sw::redis::StringView> args) {
+    return evalScript<Result>(script, keys.begin(), keys.end(), args.begin(), args.end());
+}
+
 std::string RedisService::getChatKey(int userId1, int userId2) {
     // 保证较小的用户ID在前，确保两个用户能获取到相同的key
     if (userId1 > userId2) {
@@ -79,12 +296,42 @@ std::string RedisService::getFriendRequestsKey(int userId) {
     return "user:" + std::to_string(userId) + ":friend_requests";
 }
 
-bool RedisService::sendPrivateMessage(int fromUserId, int toUserId, const std::string& content) {
-    if (!initialized_ || !redis_) return false;
+std::string RedisService::getListPushedKey(const std::string& listKey) {
+    return "pushed:" + listKey;
+}
+
+std::string RedisService::getMessageKey(const std::string& messageId) {
+    return "message:" + messageId;
+}
+
+std::string RedisService::getGroupSeqKey(int groupId) {
+    return "group:" + std::to_string(groupId) + ":seq";
+}
+
+std::string RedisService::getGroupLogKey(int groupId) {
+    return "group:" + std::to_string(groupId) + ":log";
+}
+
+std::string RedisService::getGroupCursorsKey(int userId) {
+    return "user:" + std::to_string(userId) + ":group_cursors";
+}
+
+RedisService::SendResult RedisService::sendPrivateMessage(int fromUserId, int toUserId,
+                                                          const std::string& content,
+                                                          std::string* record,
+                                                          std::string* messageId) {
+    METRICS_LATENCY_SCOPE("redis", "sendPrivateMessage");
+    if (!initialized_ || !redis_) return SendResult::FAILED;
     
     try {
         // 构建消息JSON
+        uint64_t rawId = IdGenerator::getInstance().next();
+        if (rawId == 0) {
+            return SendResult::FAILED;
+        }
+        std::string id = std::to_string(rawId);
         Json::Value message;
+        message["id"] = id;
         message["from"] = fromUserId;
         message["to"] = toUserId;
         message["content"] = content;
@@ -99,49 +346,57 @@ bool RedisService::sendPrivateMessage(int fromUserId, int toUserId, const std::s
         Json::StreamWriterBuilder writer;
         std::string messageStr = Json::writeString(writer, message);
         
-        // 获取聊天key
+        // 好友检查、写入聊天记录、消息索引和消息流、裁剪、在线检查和离线入队一次往返完成
+        std::string friendsKey = getUserFriendsKey(fromUserId);
         std::string chatKey = getChatKey(fromUserId, toUserId);
+        std::string offlineKey = "user:" + std::to_string(toUserId) + ":offline";
+        std::string pushedKey = getListPushedKey(chatKey);
+        std::string messageKey = getMessageKey(id);
+        std::string toUserStr = std::to_string(toUserId);
+        std::string streamMaxLengthStr = std::to_string(streamMaxLength_);
+        
+        long long status = evalScript<long long>(
+            sendPrivateScript_,
+            {friendsKey, chatKey, ONLINE_USERS_KEY, offlineKey, pushedKey, messageKey, MESSAGE_STREAM_KEY},
+            {toUserStr, messageStr, kPrivateHistoryLength, kMessageIndexTtl, streamMaxLengthStr});
+        if (status < 0) {
+            LOG_ERROR << "User " << fromUserId << " tried to send message to non-friend user " << toUserId;
+            return SendResult::NOT_FRIEND;
+        }
         
-        // 将消息添加到聊天列表
-        redis_->rpush(chatKey, messageStr);
-        
-        // 限制列表大小，保留最近的100条消息
-        redis_->ltrim(chatKey, -100, -1);
-        
-        // 如果用户不在线，将消息加入离线消息队列
-        if (!isUserOnline(toUserId)) {
-            std::string offlineKey = "user:" + std::to_string(toUserId) + ":offline";
-            redis_->rpush(offlineKey, messageStr);
+        if (record) {
+            *record = std::move(messageStr);
+        }
+        if (messageId) {
+            *messageId = std::move(id);
         }
         
         LOG_INFO << "Private message sent from user " << fromUserId << " to user " << toUserId;
-        return true;
+        return status > 0 ? SendResult::SENT : SendResult::QUEUED;
     } catch (const std::exception& e) {
         LOG_ERROR << "Failed to send private message: " << e.what();
-        return false;
+        return SendResult::FAILED;
     }
 }
 
-bool RedisService::sendGroupMessage(int fromUserId, int groupId, const std::string& content) {
-    if (!initialized_ || !redis_) return false;
+RedisService::SendResult RedisService::sendGroupMessage(int fromUserId, int groupId,
+                                                        const std::string& content,
+                                                        std::string* record,
+                                                        std::vector<int>* members,
+                                                        std::string* messageId,
+                                                        long long* groupSeq) {
+    METRICS_LATENCY_SCOPE("redis", "sendGroupMessage");
+    if (!initialized_ || !redis_) return SendResult::FAILED;
     
     try {
-        // 检查群组是否存在
-        std::string groupKey = getGroupKey(groupId);
-        if (!redis_->exists(groupKey)) {
-            LOG_ERROR << "Group " << groupId << " does not exist";
-            return false;
-        }
-        
-        // 检查用户是否在群组中
-        std::string groupMembersKey = getGroupMembersKey(groupId);
-        if (!redis_->sismember(groupMembersKey, std::to_string(fromUserId))) {
-            LOG_ERROR << "User " << fromUserId << " is not a member of group " << groupId;
-            return false;
-        }
-        
         // 构建消息JSON
+        uint64_t rawId = IdGenerator::getInstance().next();
+        if (rawId == 0) {
+            return SendResult::FAILED;
+        }
+        std::string id = std::to_string(rawId);
         Json::Value message;
+        message["id"] = id;
         message["from"] = fromUserId;
         message["group"] = groupId;
         message["content"] = content;
@@ -156,35 +411,83 @@ bool RedisService::sendGroupMessage(int fromUserId, int groupId, const std::stri
         Json::StreamWriterBuilder writer;
         std::string messageStr = Json::writeString(writer, message);
         
-        // 将消息添加到群组消息列表
+        // 检查群组和成员身份、写入群聊记录并计算离线成员（大群写入群组日志），一次往返完成
+        std::string groupKey = getGroupKey(groupId);
+        std::string groupMembersKey = getGroupMembersKey(groupId);
         std::string groupMsgKey = "group:" + std::to_string(groupId) + ":messages";
-        redis_->rpush(groupMsgKey, messageStr);
-        
-        // 限制列表大小，保留最近的200条消息
-        redis_->ltrim(groupMsgKey, -200, -1);
+        std::string groupSeqKey = getGroupSeqKey(groupId);
+        std::string groupLogKey = getGroupLogKey(groupId);
+        std::string pushedKey = getListPushedKey(groupMsgKey);
+        std::string messageKey = getMessageKey(id);
+        std::string fromUserStr = std::to_string(fromUserId);
+        std::string thresholdStr = std::to_string(largeGroupThreshold_);
+        std::string logLengthStr = std::to_string(groupLogLength_);
+        std::string streamMaxLengthStr = std::to_string(streamMaxLength_);
+        
+        std::vector<std::string> reply = evalScript<std::vector<std::string>>(
+            sendGroupScript_,
+            {groupKey, groupMembersKey, groupMsgKey, ONLINE_USERS_KEY, groupSeqKey, groupLogKey,
+             pushedKey, messageKey, MESSAGE_STREAM_KEY},
+            {fromUserStr, messageStr, kGroupHistoryLength, thresholdStr, logLengthStr, kMessageIndexTtl,
+             streamMaxLengthStr});
+        if (reply.empty() || reply[0] == "nogroup") {
+            LOG_ERROR << "Group " << groupId << " does not exist";
+            return SendResult::NO_GROUP;
+        }
+        if (reply[0] == "notmember") {
+            LOG_ERROR << "User " << fromUserId << " is not a member of group " << groupId;
+            return SendResult::NOT_MEMBER;
+        }
         
-        // 获取群组所有成员
-        std::vector<std::string> members;
-        redis_->smembers(groupMembersKey, std::back_inserter(members));
+        long long seq = std::stoll(reply.at(1));
+        size_t offlineCount = std::stoul(reply.at(2));
+        auto offlineBegin = reply.begin() + 3;
+        auto offlineEnd = offlineBegin + offlineCount;
+        
+        // 离线成员的入队命令在一次pipeline中发送，发送者自己不入队
+        size_t queued = 0;
+        if (offlineCount > 0) {
+            auto pipe = redis_->pipeline(false);
+            for (auto it = offlineBegin; it != offlineEnd; ++it) {
+                if (*it != fromUserStr) {
+                    pipe.rpush("user:" + *it + ":offline", messageStr);
+                    ++queued;
+                }
+            }
+            if (queued > 0) {
+                pipe.exec();
+            }
+        }
         
-        // 遍历群组成员，如果不在线，将消息加入离线消息队列
-        for (const auto& memberStr : members) {
-            int memberId = std::stoi(memberStr);
-            if (memberId != fromUserId && !isUserOnline(memberId)) {
-                std::string offlineKey = "user:" + memberStr + ":offline";
-                redis_->rpush(offlineKey, messageStr);
+        if (members) {
+            members->clear();
+            members->reserve(reply.end() - offlineEnd);
+            for (auto it = offlineEnd; it != reply.end(); ++it) {
+                members->push_back(std::stoi(*it));
             }
         }
         
-        LOG_INFO << "Group message sent from user " << fromUserId << " to group " << groupId;
-        return true;
+        if (record) {
+            *record = std::move(messageStr);
+        }
+        if (messageId) {
+            *messageId = std::move(id);
+        }
+        if (groupSeq) {
+            *groupSeq = seq;
+        }
+        
+        LOG_INFO << "Group message sent from user " << fromUserId << " to group " << groupId
+                 << ", " << queued << " offline members";
+        return queued > 0 ? SendResult::QUEUED : SendResult::SENT;
     } catch (const std::exception& e) {
         LOG_ERROR << "Failed to send group message: " << e.what();
-        return false;
+        return SendResult::FAILED;
     }
 }
 
 std::vector<std::string> RedisService::getPrivateMessages(int userId1, int userId2, int count) {
+    METRICS_LATENCY_SCOPE("redis", "getPrivateMessages");
     std::vector<std::string> messages;
     if (!initialized_ || !redis_) return messages;
     
@@ -203,6 +506,7 @@ std::vector<std::string> RedisService::getPrivateMessages(int userId1, int userI
 }
 
 std::vector<std::string> RedisService::getGroupMessages(int groupId, int count) {
+    METRICS_LATENCY_SCOPE("redis", "getGroupMessages");
     std::vector<std::string> messages;
     if (!initialized_ || !redis_) return messages;
     
@@ -221,6 +525,7 @@ std::vector<std::string> RedisService::getGroupMessages(int groupId, int count)
 }
 
 std::vector<int> RedisService::getUserChats(int userId) {
+    METRICS_LATENCY_SCOPE("redis", "getUserChats");
     std::vector<int> chats;
     if (!initialized_ || !redis_) return chats;
     
@@ -256,6 +561,7 @@ std::vector<int> RedisService::getUserChats(int userId) {
 }
 
 std::vector<int> RedisService::getUserGroups(int userId) {
+    METRICS_LATENCY_SCOPE("redis", "getUserGroups");
     std::vector<int> groups;
     if (!initialized_ || !redis_) return groups;
     
@@ -280,6 +586,7 @@ std::vector<int> RedisService::getUserGroups(int userId) {
 }
 
 bool RedisService::createGroup(int groupId, const std::string& groupName, int creatorId) {
+    METRICS_LATENCY_SCOPE("redis", "createGroup");
     if (!initialized_ || !redis_) return false;
     
     try {
@@ -321,6 +628,7 @@ bool RedisService::createGroup(int groupId, const std::string& groupName, int cr
 }
 
 bool RedisService::joinGroup(int userId, int groupId) {
+    METRICS_LATENCY_SCOPE("redis", "joinGroup");
     if (!initialized_ || !redis_) return false;
     
     try {
@@ -339,6 +647,12 @@ bool RedisService::joinGroup(int userId, int groupId) {
         std::string userGroupsKey = getUserGroupsKey(userId);
         redis_->sadd(userGroupsKey, std::to_string(groupId));
         
+        // 大群的新成员从当前序号开始，不接收加入之前的消息
+        auto head = redis_->get(getGroupSeqKey(groupId));
+        if (head) {
+            redis_->hset(getGroupCursorsKey(userId), std::to_string(groupId), *head);
+        }
+        
         LOG_INFO << "User " << userId << " joined group " << groupId;
         return true;
     } catch (const std::exception& e) {
@@ -348,6 +662,7 @@ bool RedisService::joinGroup(int userId, int groupId) {
 }
 
 bool RedisService::leaveGroup(int userId, int groupId) {
+    METRICS_LATENCY_SCOPE("redis", "leaveGroup");
     if (!initialized_ || !redis_) return false;
     
     try {
@@ -371,6 +686,7 @@ bool RedisService::leaveGroup(int userId, int groupId) {
         // 将群组从用户的群组列表移除
         std::string userGroupsKey = getUserGroupsKey(userId);
         redis_->srem(userGroupsKey, std::to_string(groupId));
+        redis_->hdel(getGroupCursorsKey(userId), std::to_string(groupId));
         
         // 检查是否是创建者，如果是且群组没有其他成员，则删除群组
         auto creator_opt = redis_->hget(groupKey, "creator");
@@ -389,6 +705,8 @@ bool RedisService::leaveGroup(int userId, int groupId) {
                 // 删除群组消息
                 std::string groupMsgKey = "group:" + std::to_string(groupId) + ":messages";
                 redis_->del(groupMsgKey);
+                redis_->del(getGroupSeqKey(groupId));
+                redis_->del(getGroupLogKey(groupId));
                 
                 LOG_INFO << "Group " << groupId << " deleted as creator left and no members remain";
             }
@@ -403,6 +721,7 @@ bool RedisService::leaveGroup(int userId, int groupId) {
 }
 
 std::vector<int> RedisService::getGroupMembers(int groupId) {
+    METRICS_LATENCY_SCOPE("redis", "getGroupMembers");
     std::vector<int> members;
     if (!initialized_ || !redis_) return members;
     
@@ -433,6 +752,7 @@ std::vector<int> RedisService::getGroupMembers(int groupId) {
 }
 
 bool RedisService::setUserOnline(int userId, bool online) {
+    METRICS_LATENCY_SCOPE("redis", "setUserOnline");
     if (!initialized_ || !redis_) return false;
     
     try {
@@ -463,6 +783,7 @@ bool RedisService::setUserOnline(int userId, bool online) {
 }
 
 bool RedisService::isUserOnline(int userId) {
+    METRICS_LATENCY_SCOPE("redis", "isUserOnline");
     if (!initialized_ || !redis_) return false;
     
     try {
@@ -475,6 +796,7 @@ bool RedisService::isUserOnline(int userId) {
 }
 
 std::vector<int> RedisService::getOnlineUsers() {
+    METRICS_LATENCY_SCOPE("redis", "getOnlineUsers");
     std::vector<int> onlineUsers;
     if (!initialized_ || !redis_) return onlineUsers;
     
@@ -496,6 +818,7 @@ std::vector<int> RedisService::getOnlineUsers() {
 }
 
 bool RedisService::addFriend(int userId1, int userId2) {
+    METRICS_LATENCY_SCOPE("redis", "addFriend");
     if (!initialized_ || !redis_) return false;
     
     try {
@@ -516,6 +839,7 @@ bool RedisService::addFriend(int userId1, int userId2) {
 }
 
 bool RedisService::removeFriend(int userId1, int userId2) {
+    METRICS_LATENCY_SCOPE("redis", "removeFriend");
     if (!initialized_ || !redis_) return false;
     
     try {
@@ -536,6 +860,7 @@ bool RedisService::removeFriend(int userId1, int userId2) {
 }
 
 std::vector<int> RedisService::getUserFriends(int userId) {
+    METRICS_LATENCY_SCOPE("redis", "getUserFriends");
     std::vector<int> friends;
     if (!initialized_ || !redis_) return friends;
     
@@ -560,6 +885,7 @@ std::vector<int> RedisService::getUserFriends(int userId) {
 }
 
 bool RedisService::isFriend(int userId1, int userId2) {
+    METRICS_LATENCY_SCOPE("redis", "isFriend");
     if (!initialized_ || !redis_) return false;
     
     try {
@@ -575,21 +901,48 @@ bool RedisService::isFriend(int userId1, int userId2) {
 }
 
 // 标记消息为已读
+bool RedisService::loadIndexedMessage(const std::string& messageId, std::string* data,
+                                      std::string* listKey, std::string* pos) {
+    std::vector<sw::redis::OptionalString> fields;
+    redis_->hmget(getMessageKey(messageId), {"data", "list", "pos"}, std::back_inserter(fields));
+    if (fields.size() != 3 || !fields[0]) {
+        LOG_ERROR << "Message " << messageId << " does not exist";
+        return false;
+    }
+    *data = *fields[0];
+    *listKey = fields[1] ? *fields[1] : "";
+    *pos = fields[2] ? *fields[2] : "-1";
+    return true;
+}
+
+bool RedisService::updateIndexedMessage(const std::string& messageId, const std::string& oldData,
+                                        const std::string& newData, const std::string& listKey,
+                                        const std::string& pos) {
+    std::string messageKey = getMessageKey(messageId);
+    std::string pushedKey = getListPushedKey(listKey);
+    long long status = evalScript<long long>(updateMessageScript_,
+                                             {messageKey, listKey, pushedKey},
+                                             {oldData, newData, pos});
+    if (status < 0) {
+        LOG_ERROR << "Message " << messageId << " was modified concurrently";
+        return false;
+    }
+    if (status == 0) {
+        LOG_INFO << "Message " << messageId << " is no longer in " << listKey << ", only its index was updated";
+    }
+    return true;
+}
+
 bool RedisService::markMessageAsRead(int userId, const std::string& messageId) {
+    METRICS_LATENCY_SCOPE("redis", "markMessageAsRead");
     if (!initialized_ || !redis_) return false;
     
     try {
-        // 检查消息是否存在
-        std::string messageKey = "message:" + messageId;
-        if (!redis_->exists(messageKey)) {
-            LOG_ERROR << "Message " << messageId << " does not exist";
-            return false;
-        }
-        
-        // 获取消息数据
+        // 通过索引获取消息数据
+        std::string messageKey = getMessageKey(messageId);
         auto messageData_opt = redis_->hget(messageKey, "data");
         if (!messageData_opt) {
-            LOG_ERROR << "Failed to get message data for message " << messageId;
+            LOG_ERROR << "Message " << messageId << " does not exist";
             return false;
         }
         std::string messageData = *messageData_opt;
@@ -608,14 +961,15 @@ bool RedisService::markMessageAsRead(int userId, const std::string& messageId) {
             return false;
         }
         
-        // 标记消息为已读
-        redis_->hset(messageKey, "read", "1");
-        
-        // 记录已读时间戳
+        // 标记消息为已读并记录已读时间戳
         long long timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
             std::chrono::system_clock::now().time_since_epoch()
         ).count();
-        redis_->hset(messageKey, "read_timestamp", std::to_string(timestamp));
+        std::vector<std::pair<std::string, std::string>> fields = {
+            {"read", "1"},
+            {"read_timestamp", std::to_string(timestamp)}
+        };
+        redis_->hset(messageKey, fields.begin(), fields.end());
         
         LOG_INFO << "Message " << messageId << " marked as read by user " << userId;
         return true;
@@ -627,20 +981,15 @@ bool RedisService::markMessageAsRead(int userId, const std::string& messageId) {
 
 // 标记群组消息为已读
 bool RedisService::markGroupMessageAsRead(int userId, int groupId, const std::string& messageId) {
+    METRICS_LATENCY_SCOPE("redis", "markGroupMessageAsRead");
     if (!initialized_ || !redis_) return false;
     
     try {
-        // 检查消息是否存在
-        std::string messageKey = "message:" + messageId;
-        if (!redis_->exists(messageKey)) {
-            LOG_ERROR << "Message " << messageId << " does not exist";
-            return false;
-        }
-        
-        // 获取消息数据
+        // 通过索引获取消息数据
+        std::string messageKey = getMessageKey(messageId);
         auto messageData_opt = redis_->hget(messageKey, "data");
         if (!messageData_opt) {
-            LOG_ERROR << "Failed to get message data for message " << messageId;
+            LOG_ERROR << "Message " << messageId << " does not exist";
             return false;
         }
         std::string messageData = *messageData_opt;
@@ -665,16 +1014,18 @@ bool RedisService::markGroupMessageAsRead(int userId, int groupId, const std::st
             return false;
         }
         
-        // 标记消息为已读
+        // 标记消息为已读并记录已读时间戳，与消息索引同样过期，一次发送
         std::string readKey = messageKey + ":read";
-        redis_->sadd(readKey, std::to_string(userId));
-        
-        // 记录已读时间戳
         std::string readTsKey = messageKey + ":read_timestamps";
         long long timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
             std::chrono::system_clock::now().time_since_epoch()
         ).count();
-        redis_->hset(readTsKey, std::to_string(userId), std::to_string(timestamp));
+        auto pipe = redis_->pipeline(false);
+        pipe.sadd(readKey, std::to_string(userId))
+            .hset(readTsKey, std::to_string(userId), std::to_string(timestamp))
+            .expire(readKey, kMessageIndexTtlSeconds)
+            .expire(readTsKey, kMessageIndexTtlSeconds)
+            .exec();
         
         LOG_INFO << "Group message " << messageId << " marked as read by user " << userId;
         return true;
@@ -686,23 +1037,17 @@ bool RedisService::markGroupMessageAsRead(int userId, int groupId, const std::st
 
 // 撤回私聊消息
 bool RedisService::recallPrivateMessage(int userId, int targetUserId, const std::string& messageId) {
+    METRICS_LATENCY_SCOPE("redis", "recallPrivateMessage");
     if (!initialized_ || !redis_) return false;
     
     try {
-        // 检查消息是否存在
-        std::string messageKey = "message:" + messageId;
-        if (!redis_->exists(messageKey)) {
-            LOG_ERROR << "Message " << messageId << " does not exist";
-            return false;
-        }
-        
-        // 获取消息数据
-        auto messageData_opt = redis_->hget(messageKey, "data");
-        if (!messageData_opt) {
-            LOG_ERROR << "Failed to get message data for message " << messageId;
+        // 通过索引获取消息数据和所在位置
+        std::string messageData;
+        std::string listKey;
+        std::string pos;
+        if (!loadIndexedMessage(messageId, &messageData, &listKey, &pos)) {
             return false;
         }
-        std::string messageData = *messageData_opt;
         
         // 解析消息数据
         Json::Value message;
@@ -712,11 +1057,15 @@ bool RedisService::recallPrivateMessage(int userId, int targetUserId, const std:
             return false;
         }
         
-        // 检查用户是否是发送者
+        // 检查用户是否是发送者，以及消息是否发给目标用户
         if (!message.isMember("from") || message["from"].asInt() != userId) {
             LOG_ERROR << "User " << userId << " is not the sender of message " << messageId;
             return false;
         }
+        if (!message.isMember("to") || message["to"].asInt() != targetUserId) {
+            LOG_ERROR << "Message " << messageId << " was not sent to user " << targetUserId;
+            return false;
+        }
         
         // 检查消息是否在2分钟内
         long long timestamp = message["timestamp"].asInt64();
@@ -733,30 +1082,14 @@ bool RedisService::recallPrivateMessage(int userId, int targetUserId, const std:
         message["recalled"] = true;
         message["recall_time"] = static_cast<Json::UInt64>(now);
         
-        // 更新消息
+        // 更新消息索引和聊天记录
         Json::StreamWriterBuilder writer;
         std::string updatedMessageStr = Json::writeString(writer, message);
-        redis_->hset(messageKey, "data", updatedMessageStr);
-        
-        // 获取聊天key
-        std::string chatKey = getChatKey(userId, targetUserId);
-        
-        // 更新聊天记录
-        std::vector<std::string> messages;
-        redis_->lrange(chatKey, 0, -1, std::back_inserter(messages));
-        
-        for (size_t i = 0; i < messages.size(); i++) {
-            Json::Value msg;
-            if (reader.parse(messages[i], msg) && msg.isMember("id") && msg["id"].asString() == messageId) {
-                // 将撤回的消息添加标记
-                msg["recalled"] = true;
-                msg["recall_time"] = static_cast<Json::UInt64>(now);
-                
-                // 更新聊天记录
-                std::string updatedMsg = Json::writeString(writer, msg);
-                redis_->lset(chatKey, static_cast<long long>(i), updatedMsg);
-                break;
-            }
+        if (listKey.empty()) {
+            listKey = getChatKey(userId, targetUserId);
+        }
+        if (!updateIndexedMessage(messageId, messageData, updatedMessageStr, listKey, pos)) {
+            return false;
         }
         
         LOG_INFO << "Message " << messageId << " recalled by user " << userId;
@@ -769,24 +1102,18 @@ bool RedisService::recallPrivateMessage(int userId, int targetUserId, const std:
 
 // 撤回群组消息
 bool RedisService::recallGroupMessage(int userId, int groupId, const std::string& messageId) {
+    METRICS_LATENCY_SCOPE("redis", "recallGroupMessage");
     if (!initialized_ || !redis_) return false;
     
     try {
-        // 检查消息是否存在
-        std::string messageKey = "message:" + messageId;
-        if (!redis_->exists(messageKey)) {
-            LOG_ERROR << "Message " << messageId << " does not exist";
+        // 通过索引获取消息数据和所在位置
+        std::string messageData;
+        std::string listKey;
+        std::string pos;
+        if (!loadIndexedMessage(messageId, &messageData, &listKey, &pos)) {
             return false;
         }
         
-        // 获取消息数据
-        auto messageDataOpt = redis_->hget(messageKey, "data");
-        if (!messageDataOpt) {
-            LOG_ERROR << "Failed to get message data for message " << messageId;
-            return false;
-        }
-        std::string messageData = *messageDataOpt;
-        
         // 解析消息数据
         Json::Value message;
         Json::Reader reader;
@@ -846,31 +1173,14 @@ bool RedisService::recallGroupMessage(int userId, int groupId, const std::string
         message["recall_time"] = static_cast<Json::UInt64>(now);
         message["recall_by"] = userId;
         
-        // 更新消息
+        // 更新消息索引和群聊记录
         Json::StreamWriterBuilder writer;
         std::string updatedMessageStr = Json::writeString(writer, message);
-        redis_->hset(messageKey, "data", updatedMessageStr);
-        
-        // 获取群聊key
-        std::string groupMsgKey = "group:" + std::to_string(groupId) + ":messages";
-        
-        // 更新群聊记录
-        std::vector<std::string> messages;
-        redis_->lrange(groupMsgKey, 0, -1, std::back_inserter(messages));
-        
-        for (size_t i = 0; i < messages.size(); i++) {
-            Json::Value msg;
-            if (reader.parse(messages[i], msg) && msg.isMember("id") && msg["id"].asString() == messageId) {
-                // 将撤回的消息添加标记
-                msg["recalled"] = true;
-                msg["recall_time"] = static_cast<Json::UInt64>(now);
-                msg["recall_by"] = userId;
-                
-                // 更新群聊记录
-                std::string updatedMsg = Json::writeString(writer, msg);
-                redis_->lset(groupMsgKey, static_cast<long long>(i), updatedMsg);
-                break;
-            }
+        if (listKey.empty()) {
+            listKey = "group:" + std::to_string(groupId) + ":messages";
+        }
+        if (!updateIndexedMessage(messageId, messageData, updatedMessageStr, listKey, pos)) {
+            return false;
         }
         
         LOG_INFO << "Group message " << messageId << " recalled by user " << userId;
@@ -881,8 +1191,88 @@ bool RedisService::recallGroupMessage(int userId, int groupId, const std::string
     }
 }
 
+bool RedisService::createStreamGroup(const std::string& group) {
+    METRICS_LATENCY_SCOPE("redis", "createStreamGroup");
+    if (!initialized_ || !streamRedis_) return false;
+    
+    try {
+        // 从头开始消费，流不存在时一并创建
+        streamRedis_->xgroup_create(MESSAGE_STREAM_KEY, group, "0", true);
+        LOG_INFO << "Created consumer group " << group << " on " << MESSAGE_STREAM_KEY;
+        return true;
+    } catch (const sw::redis::ReplyError& e) {
+        if (std::string(e.what()).compare(0, 9, "BUSYGROUP") == 0) {
+            return true;
+        }
+        LOG_ERROR << "Failed to create consumer group " << group << ": " << e.what();
+        return false;
+    } catch (const std::exception& e) {
+        LOG_ERROR << "Failed to create consumer group " << group << ": " << e.what();
+        return false;
+    }
+}
+
+bool RedisService::readStream(const std::string& group, const std::string& consumer, long long count,
+                              long long blockMs, bool pending, std::vector<StreamEntry>* entries) {
+    METRICS_LATENCY_SCOPE("redis", "readStream");
+    entries->clear();
+    if (!initialized_ || !streamRedis_) return false;
+    
+    try {
+        using Attrs = std::vector<std::pair<std::string, std::string>>;
+        using Item = std::pair<std::string, sw::redis::Optional<Attrs>>;
+        std::unordered_map<std::string, std::vector<Item>> result;
+        if (pending) {
+            // 本消费者已读取但尚未确认的记录，不阻塞
+            streamRedis_->xreadgroup(group, consumer, MESSAGE_STREAM_KEY, "0", count,
+                                     std::inserter(result, result.end()));
+        } else {
+            streamRedis_->xreadgroup(group, consumer, MESSAGE_STREAM_KEY, ">",
+                                     std::chrono::milliseconds(blockMs), count, false,
+                                     std::inserter(result, result.end()));
+        }
+        
+        auto it = result.find(MESSAGE_STREAM_KEY);
+        if (it == result.end()) {
+            return true;
+        }
+        entries->reserve(it->second.size());
+        for (auto& item : it->second) {
+            // 等待确认期间被 MAXLEN 裁剪掉的记录没有内容
+            std::string data;
+            if (item.second) {
+                for (auto& field : *item.second) {
+                    if (field.first == "data") {
+                        data = std::move(field.second);
+                    }
+                }
+            }
+            entries->emplace_back(std::move(item.first), std::move(data));
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR << "Failed to read message stream: " << e.what();
+        return false;
+    }
+}
+
+bool RedisService::ackStream(const std::string& group, const std::vector<std::string>& ids) {
+    METRICS_LATENCY_SCOPE("redis", "ackStream");
+    if (!initialized_ || !streamRedis_) return false;
+    if (ids.empty()) return true;
+    
+    try {
+        streamRedis_->xack(MESSAGE_STREAM_KEY, group, ids.begin(), ids.end());
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR << "Failed to acknowledge message stream entries: " << e.what();
+        return false;
+    }
+}
+
 // 删除键
 bool RedisService::delKey(const std::string& key) {
+    METRICS_LATENCY_SCOPE("redis", "delKey");
     try {
         if (redis_ && keyExists(key)) {
             return redis_->del(key) > 0;
@@ -895,6 +1285,7 @@ bool RedisService::delKey(const std::string& key) {
 
 // 获取所有匹配的键
 std::vector<std::string> RedisService::getKeys(const std::string& pattern) {
+    METRICS_LATENCY_SCOPE("redis", "getKeys");
     std::vector<std::string> keys;
     try {
         if (redis_) {
@@ -908,6 +1299,7 @@ std::vector<std::string> RedisService::getKeys(const std::string& pattern) {
 
 // 获取列表中的所有元素
 std::vector<std::string> RedisService::getAllListItems(const std::string& key) {
+    METRICS_LATENCY_SCOPE("redis", "getAllListItems");
     std::vector<std::string> items;
     try {
         if (redis_) {
@@ -933,6 +1325,7 @@ std::vector<std::string> RedisService::getAllListItems(const std::string& key) {
 
 // 获取指定范围的列表元素
 std::vector<std::string> RedisService::getListRange(const std::string& key, long long start, long long stop) {
+    METRICS_LATENCY_SCOPE("redis", "getListRange");
     std::vector<std::string> items;
     try {
         if (redis_) {
@@ -946,6 +1339,7 @@ std::vector<std::string> RedisService::getListRange(const std::string& key, long
 
 // 设置键值
 bool RedisService::setValue(const std::string& key, const std::string& value) {
+    METRICS_LATENCY_SCOPE("redis", "setValue");
     try {
         if (redis_) {
             redis_->set(key, value);
@@ -959,6 +1353,7 @@ bool RedisService::setValue(const std::string& key, const std::string& value) {
 
 // 获取键值
 std::string RedisService::getValue(const std::string& key, const std::string& defaultValue) {
+    METRICS_LATENCY_SCOPE("redis", "getValue");
     try {
         if (redis_) {
             auto val = redis_->get(key);
@@ -974,6 +1369,7 @@ std::string RedisService::getValue(const std::string& key, const std::string& de
 
 // 检查键是否存在
 bool RedisService::keyExists(const std::string& key) {
+    METRICS_LATENCY_SCOPE("redis", "keyExists");
     try {
         if (redis_) {
             return redis_->exists(key);
@@ -986,6 +1382,7 @@ bool RedisService::keyExists(const std::string& key) {
 
 // 检查键是否是列表类型
 bool RedisService::isListType(const std::string& key) {
+    METRICS_LATENCY_SCOPE("redis", "isListType");
     try {
         if (redis_) {
             auto type = redis_->type(key);
@@ -999,6 +1396,7 @@ bool RedisService::isListType(const std::string& key) {
 
 // 获取键的类型
 std::string RedisService::getKeyType(const std::string& key) {
+    METRICS_LATENCY_SCOPE("redis", "getKeyType");
     try {
         if (redis_) {
             return redis_->type(key);
@@ -1011,6 +1409,7 @@ std::string RedisService::getKeyType(const std::string& key) {
 
 // 修剪列表
 bool RedisService::trimList(const std::string& key, long long start, long long stop) {
+    METRICS_LATENCY_SCOPE("redis", "trimList");
     try {
         if (redis_) {
             redis_->ltrim(key, start, stop);
@@ -1024,6 +1423,7 @@ bool RedisService::trimList(const std::string& key, long long start, long long s
 
 // 获取并清除用户离线消息
 std::vector<std::string> RedisService::getOfflineMessages(int userId) {
+    METRICS_LATENCY_SCOPE("redis", "getOfflineMessages");
     std::vector<std::string> messages;
     if (!initialized_ || !redis_) return messages;
     
@@ -1051,6 +1451,7 @@ std::vector<std::string> RedisService::getOfflineMessages(int userId) {
 
 // 检查用户是否有离线消息
 bool RedisService::hasOfflineMessages(int userId) {
+    METRICS_LATENCY_SCOPE("redis", "hasOfflineMessages");
     if (!initialized_ || !redis_) return false;
     
     try {
@@ -1068,6 +1469,7 @@ bool RedisService::hasOfflineMessages(int userId) {
 
 // 获取离线消息计数
 int RedisService::getOfflineMessageCount(int userId) {
+    METRICS_LATENCY_SCOPE("redis", "getOfflineMessageCount");
     if (!initialized_ || !redis_) return 0;
     
     try {
@@ -1083,8 +1485,129 @@ int RedisService::getOfflineMessageCount(int userId) {
     }
 }
 
+// 大群积压消息转入离线队列
+int RedisService::pullGroupBacklog(int userId, std::unordered_map<int, long long>* heads) {
+    METRICS_LATENCY_SCOPE("redis", "pullGroupBacklog");
+    if (!initialized_ || !redis_) return 0;
+    
+    try {
+        std::vector<std::string> groups;
+        redis_->smembers(getUserGroupsKey(userId), std::back_inserter(groups));
+        if (groups.empty()) {
+            return 0;
+        }
+        
+        // 逐个群组分批转入，每次脚本调用的工作量有上限
+        std::string cursorsKey = getGroupCursorsKey(userId);
+        std::string offlineKey = "user:" + std::to_string(userId) + ":offline";
+        std::string batchStr = std::to_string(kGroupBacklogBatch);
+        long long pulled = 0;
+        for (const auto& groupId : groups) {
+            int id = std::stoi(groupId);
+            std::string seqKey = getGroupSeqKey(id);
+            std::string logKey = getGroupLogKey(id);
+            long long count = 0;
+            long long head = -1;
+            do {
+                std::vector<long long> reply = evalScript<std::vector<long long>>(
+                    pullGroupBacklogScript_, {cursorsKey, offlineKey, seqKey, logKey},
+                    {groupId, batchStr});
+                count = reply.at(0);
+                head = reply.at(1);
+                pulled += count;
+            } while (count >= kGroupBacklogBatch);
+            if (heads && head >= 0) {
+                (*heads)[id] = head;
+            }
+        }
+        if (pulled > 0) {
+            LOG_INFO << "Pulled " << pulled << " large group messages into offline queue of user " << userId;
+        }
+        return static_cast<int>(pulled);
+    } catch (const std::exception& e) {
+        LOG_ERROR << "Failed to pull group backlog: " << e.what();
+        return 0;
+    }
+}
+
+bool RedisService::saveGroupCursors(int userId, const std::unordered_map<int, long long>& cursors) {
+    METRICS_LATENCY_SCOPE("redis", "saveGroupCursors");
+    if (!initialized_ || !redis_) return false;
+    if (cursors.empty()) return true;
+    
+    try {
+        std::vector<std::string> args;
+        args.reserve(cursors.size() * 2);
+        for (const auto& cursor : cursors) {
+            args.push_back(std::to_string(cursor.first));
+            args.push_back(std::to_string(cursor.second));
+        }
+        
+        std::vector<std::string> keys = {getGroupCursorsKey(userId)};
+        evalScript<long long>(saveGroupCursorsScript_, keys.begin(), keys.end(), args.begin(), args.end());
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR << "Failed to save group cursors of user " << userId << ": " << e.what();
+        return false;
+    }
+}
+
+bool RedisService::pushOfflineMessage(int userId, const std::string& record) {
+    METRICS_LATENCY_SCOPE("redis", "pushOfflineMessage");
+    if (!initialized_ || !redis_) return false;
+    
+    try {
+        std::string offlineKey = "user:" + std::to_string(userId) + ":offline";
+        redis_->rpush(offlineKey, record);
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR << "Failed to push offline message: " << e.what();
+        return false;
+    }
+}
+
+// 分页读取离线消息
+std::vector<std::string> RedisService::getOfflineMessageRange(int userId, long long start, long long count) {
+    METRICS_LATENCY_SCOPE("redis", "getOfflineMessageRange");
+    std::vector<std::string> messages;
+    if (!initialized_ || !redis_ || count <= 0) return messages;
+    
+    try {
+        // 构建用户离线消息key
+        std::string offlineKey = "user:" + std::to_string(userId) + ":offline";
+        
+        // 离线消息通过rpush追加，下标0为最早的消息
+        redis_->lrange(offlineKey, start, start + count - 1, std::back_inserter(messages));
+        return messages;
+    } catch (const std::exception& e) {
+        LOG_ERROR << "Failed to get offline message range: " << e.what();
+        return std::vector<std::string>();
+    }
+}
+
+// 删除已确认的离线消息
+bool RedisService::trimOfflineMessages(int userId, long long count) {
+    METRICS_LATENCY_SCOPE("redis", "trimOfflineMessages");
+    if (!initialized_ || !redis_) return false;
+    if (count <= 0) return true;
+    
+    try {
+        // 构建用户离线消息key
+        std::string offlineKey = "user:" + std::to_string(userId) + ":offline";
+        
+        // 只保留确认之后新到达的消息，列表为空时Redis会自动删除该键
+        redis_->ltrim(offlineKey, count, -1);
+        LOG_INFO << "Trimmed " << count << " acknowledged offline messages for user " << userId;
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR << "Failed to trim offline messages: " << e.what();
+        return false;
+    }
+}
+
 // 发送好友请求
 bool RedisService::sendFriendRequest(int fromUserId, int toUserId) {
+    METRICS_LATENCY_SCOPE("redis", "sendFriendRequest");
     if (!initialized_ || !redis_) return false;
     
     try {
@@ -1114,6 +1637,7 @@ bool RedisService::sendFriendRequest(int fromUserId, int toUserId) {
 
 // 接受好友请求
 bool RedisService::acceptFriendRequest(int fromUserId, int toUserId) {
+    METRICS_LATENCY_SCOPE("redis", "acceptFriendRequest");
     if (!initialized_ || !redis_) return false;
     
     try {
@@ -1143,6 +1667,7 @@ bool RedisService::acceptFriendRequest(int fromUserId, int toUserId) {
 
 // 拒绝好友请求
 bool RedisService::rejectFriendRequest(int fromUserId, int toUserId) {
+    METRICS_LATENCY_SCOPE("redis", "rejectFriendRequest");
     if (!initialized_ || !redis_) return false;
     
     try {
@@ -1166,6 +1691,7 @@ bool RedisService::rejectFriendRequest(int fromUserId, int toUserId) {
 
 // 获取用户的好友请求列表
 std::vector<std::pair<int, std::string>> RedisService::getFriendRequests(int userId) {
+    METRICS_LATENCY_SCOPE("redis", "getFriendRequests");
     std::vector<std::pair<int, std::string>> requests;
     if (!initialized_ || !redis_) return requests;
     
@@ -1191,6 +1717,7 @@ std::vector<std::pair<int, std::string>> RedisService::getFriendRequests(int use
 
 // 检查是否已发送好友请求
 bool RedisService::hasFriendRequest(int fromUserId, int toUserId) {
+    METRICS_LATENCY_SCOPE("redis", "hasFriendRequest");
     if (!initialized_ || !redis_) return false;
     
     try {
@@ -2,26 +2,61 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include <memory>
 #include <sw/redis++/redis++.h>
 #include <muduo/base/Logging.h>
 
 class RedisService {
 public:
+    // 消息流中的一条记录: {流记录ID, 消息记录}
+    using StreamEntry = std::pair<std::string, std::string>;
+    
+    // 消息发送结果
+    enum class SendResult {
+        SENT,        // 已写入聊天记录，接收方在线
+        QUEUED,      // 已写入聊天记录，（部分）接收方不在线，同时加入其离线队列
+        NOT_FRIEND,  // 双方不是好友，没有写入
+        NO_GROUP,    // 群组不存在，没有写入
+        NOT_MEMBER,  // 发送者不是群成员，没有写入
+        FAILED       // Redis错误
+    };
+
     // 单例模式
     static RedisService& getInstance();
     
-    // 初始化Redis服务
+    // 初始化Redis服务，poolSize 为连接池大小，应不小于同时访问Redis的工作线程数
     bool init(const std::string& host = "127.0.0.1", 
              int port = 6379, 
              const std::string& password = "",
-             int db = 0);
+             int db = 0,
+             int poolSize = 5);
+    
+    // 大群读扩散设置，需在init之前调用
+    // 成员数超过 largeGroupThreshold 的群组，消息只写入一份按序号排列的群组日志，成员只保存
+    // 每个群已投递到的序号（游标），离线成员登录时从游标之后读取；为0时所有群组都写扩散。
+    // logLength 为群组日志保留的消息条数，游标落后更多的成员只能从历史记录中查看更早的消息
+    void setGroupLogOptions(int largeGroupThreshold, int logLength);
+    
+    // 消息流保留的记录条数（XADD MAXLEN ~），需在init之前调用
+    // 归档停止时间过长、积压超过该值时，最早的未归档记录会被裁剪
+    void setStreamMaxLength(long long maxLength);
     
     // 发送私聊消息
-    bool sendPrivateMessage(int fromUserId, int toUserId, const std::string& content);
+    // 好友检查、写入聊天记录、裁剪、在线检查和离线入队在一个Lua脚本中完成，只需一次往返。
+    // 每条消息由 IdGenerator 分配ID，并写入 message:<id> 索引，撤回和已读回执据此直接定位。
+    // record 非空时返回写入Redis的消息记录，可用于之后转存到离线队列；messageId 非空时返回消息ID
+    SendResult sendPrivateMessage(int fromUserId, int toUserId, const std::string& content,
+                                  std::string* record = nullptr, std::string* messageId = nullptr);
     
     // 发送群聊消息
-    bool sendGroupMessage(int fromUserId, int groupId, const std::string& content);
+    // 成员检查、写入群聊记录和离线成员计算（SDIFF 在线用户集合）在一个Lua脚本中完成，
+    // 离线入队用一次pipeline发送，与群组大小无关，共两次往返。
+    // members 非空时返回群成员列表，供调用方推送给在线成员；消息ID和索引同私聊。
+    // groupSeq 非空时返回大群消息在群组日志中的序号，小群为0
+    SendResult sendGroupMessage(int fromUserId, int groupId, const std::string& content,
+                                std::string* record = nullptr, std::vector<int>* members = nullptr,
+                                std::string* messageId = nullptr, long long* groupSeq = nullptr);
     
     // 获取私聊历史消息
     std::vector<std::string> getPrivateMessages(int userId1, int userId2, int count = 20);
@@ -95,6 +130,24 @@ public:
     // 获取离线消息计数
     int getOfflineMessageCount(int userId);
     
+    // 把用户所在大群中游标之后的消息转入其离线队列并推进游标，返回转入的消息数量。
+    // 按群组分批执行脚本，每次调用转入的消息数量有上限
+    // 登录时在读取离线消息数量之前调用，之后与其他离线消息一起分批发送和确认。
+    // heads 非空时返回各大群的最新序号，不超过该序号的消息已转入离线队列或此前已投递
+    int pullGroupBacklog(int userId, std::unordered_map<int, long long>* heads = nullptr);
+    
+    // 下线时保存大群游标，cursors 为在线期间各群没有遗漏地推送到的序号，游标只向前推进
+    bool saveGroupCursors(int userId, const std::unordered_map<int, long long>& cursors);
+    
+    // 把消息记录追加到用户的离线队列
+    bool pushOfflineMessage(int userId, const std::string& record);
+    
+    // 分页读取离线消息，从最早的消息开始，不删除
+    std::vector<std::string> getOfflineMessageRange(int userId, long long start, long long count);
+    
+    // 删除最早的count条离线消息（客户端确认收到后调用）
+    bool trimOfflineMessages(int userId, long long count);
+    
     // 标记群组消息为已读
     bool markGroupMessageAsRead(int userId, int groupId, const std::string& messageId);
     
@@ -134,6 +187,19 @@ public:
 
     // 裁剪列表
     bool trimList(const std::string& key, long long start, long long stop);
+    
+    // 以下方法提供给 MessageArchiveService 以消费组方式读取消息流
+    // 每条私聊和群聊消息在写入聊天记录的同一个脚本中追加到消息流（stream:messages）
+    // 创建消费组，已存在时直接返回true
+    bool createStreamGroup(const std::string& group);
+    
+    // 读取消息流，pending 为true时读取本消费者已读取但尚未确认的记录（不阻塞），
+    // 否则读取新记录，没有新记录时最多阻塞 blockMs 毫秒；读取失败返回false
+    bool readStream(const std::string& group, const std::string& consumer, long long count,
+                    long long blockMs, bool pending, std::vector<StreamEntry>* entries);
+    
+    // 确认已处理的记录
+    bool ackStream(const std::string& group, const std::vector<std::string>& ids);
 
 private:
     RedisService();
@@ -143,10 +209,45 @@ private:
     RedisService(const RedisService&) = delete;
     RedisService& operator=(const RedisService&) = delete;
     
+    // 预加载的Lua脚本，init时 SCRIPT LOAD，之后用 EVALSHA 执行
+    struct Script {
+        const char* name;
+        const char* source;
+        std::string sha;
+    };
+
+    // 加载脚本并记录SHA1
+    bool loadScript(Script* script);
+
+    // 执行脚本，Redis重启或 SCRIPT FLUSH 后返回 NOSCRIPT 时重新加载并重试一次
+    template <typename Result, typename Keys, typename Args>
+    Result evalScript(const Script& script, Keys keysFirst, Keys keysLast, Args argsFirst, Args argsLast);
+    
+    template <typename Result>
+    Result evalScript(const Script& script,
+                      std::initializer_list<sw::redis::StringView> keys,
+                      std::initializer_list<sw::redis::StringView> args);
+
     // Redis连接
     std::unique_ptr<sw::redis::Redis> redis_;
     bool initialized_;
     
+    // 消息流阻塞读取专用的连接
+    std::unique_ptr<sw::redis::Redis> streamRedis_;
+
+    Script sendPrivateScript_;
+    Script sendGroupScript_;
+    Script pullGroupBacklogScript_;
+    Script saveGroupCursorsScript_;
+    Script updateMessageScript_;
+    
+    // 大群读扩散设置
+    int largeGroupThreshold_;
+    int groupLogLength_;
+    
+    // 消息流保留条数
+    long long streamMaxLength_;
+    
     // 生成聊天键
     std::string getChatKey(int userId1, int userId2);
     
@@ -165,6 +266,34 @@ private:
     // 生成好友请求键
     std::string getFriendRequestsKey(int userId);
     
+    // 生成列表累计写入条数键，与消息索引中的位置一起计算消息在列表中的当前下标
+    std::string getListPushedKey(const std::string& listKey);
+    
+    // 生成消息索引键，哈希字段: data 消息记录、list 所在列表、pos 在列表中的累计位置
+    std::string getMessageKey(const std::string& messageId);
+    
+    // 读取消息索引，消息不存在或索引已过期时返回false
+    bool loadIndexedMessage(const std::string& messageId, std::string* data,
+                            std::string* listKey, std::string* pos);
+    
+    // 按索引修改消息记录，同时更新所在列表中的副本
+    // 返回false表示消息不存在、已被并发修改或Redis错误
+    bool updateIndexedMessage(const std::string& messageId, const std::string& oldData,
+                              const std::string& newData, const std::string& listKey,
+                              const std::string& pos);
+    
+    // 生成大群消息序号键，存在时表示该群已使用读扩散
+    std::string getGroupSeqKey(int groupId);
+    
+    // 生成大群日志键
+    std::string getGroupLogKey(int groupId);
+    
+    // 生成用户大群游标键（群组ID -> 已投递到的序号）
+    std::string getGroupCursorsKey(int userId);
+    
     // 在线用户集合键
     const std::string ONLINE_USERS_KEY = "online:users";
+    
+    // 消息流键
+    const std::string MESSAGE_STREAM_KEY = "stream:messages";
 };
@@ -0,0 +1,84 @@
+#include "WireFormat.h"
+
+namespace wire {
+
+void putVarint(std::string* out, uint64_t value)
+{
+    char buf[10];
+    size_t len = 0;
+    while (value >= 0x80) {
+        buf[len++] = static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    buf[len++] = static_cast<char>(value);
+    out->append(buf, len);
+}
+
+bool Reader::next(int* field, WireType* type)
+{
+    if (!ok_ || pos_ == end_) {
+        return false;
+    }
+
+    uint64_t tag = 0;
+    if (!readVarint(&tag)) {
+        return false;
+    }
+
+    uint64_t number = tag >> 3;
+    uint64_t wireType = tag & 0x7;
+    if (number == 0 || number > 0x1fffffff || (wireType != VARINT && wireType != LENGTH_DELIMITED)) {
+        ok_ = false;
+        return false;
+    }
+    *field = static_cast<int>(number);
+    *type = static_cast<WireType>(wireType);
+    return true;
+}
+
+bool Reader::readVarint(uint64_t* value)
+{
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos_ == end_) {
+            break;
+        }
+        uint8_t byte = static_cast<uint8_t>(*pos_++);
+        result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+
+    // 数据截断或超过10字节
+    ok_ = false;
+    return false;
+}
+
+bool Reader::readBytes(std::string_view* value)
+{
+    uint64_t length = 0;
+    if (!readVarint(&length)) {
+        return false;
+    }
+    if (length > static_cast<uint64_t>(end_ - pos_)) {
+        ok_ = false;
+        return false;
+    }
+    *value = std::string_view(pos_, static_cast<size_t>(length));
+    pos_ += length;
+    return true;
+}
+
+bool Reader::skip(WireType type)
+{
+    if (type == VARINT) {
+        uint64_t ignored;
+        return readVarint(&ignored);
+    }
+    std::string_view ignored;
+    return readBytes(&ignored);
+}
+
+} // namespace wire
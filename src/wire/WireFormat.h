@@ -0,0 +1,91 @@
+#ifndef WIRE_FORMAT_H
+#define WIRE_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// 二进制消息编码的基础读写函数
+//
+// 编码规则与 protobuf 的 varint / length-delimited 两种线型一致：
+//   字段   = tag(varint) 值
+//   tag    = 字段编号 << 3 | 线型
+//   整数   = varint（负数按64位补码编码，占10字节）
+//   字符串 = varint 长度 + 内容，嵌套消息同理
+// 值为默认值（0、false、空字符串）的字段不编码，重复字段每个元素单独编码一次。
+// 解码时跳过未知字段，新增字段不影响旧客户端。
+//
+// 具体消息由 tools/wiregen.py 根据 src/wire/Messages.schema 生成。
+namespace wire {
+
+enum WireType {
+    VARINT = 0,
+    LENGTH_DELIMITED = 2
+};
+
+// 所有顶层消息中保留给请求ID（rid）的字段编号
+constexpr int kRidField = 15;
+
+// varint编码后的字节数
+inline size_t varintSize(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+inline size_t tagSize(int field) {
+    return varintSize(static_cast<uint64_t>(field) << 3);
+}
+
+// 长度前缀字段（字符串或嵌套消息）编码后的字节数
+inline size_t lengthDelimitedSize(int field, size_t length) {
+    return tagSize(field) + varintSize(length) + length;
+}
+
+void putVarint(std::string* out, uint64_t value);
+
+inline void putTag(std::string* out, int field, WireType type) {
+    putVarint(out, static_cast<uint64_t>(field) << 3 | type);
+}
+
+inline void putVarintField(std::string* out, int field, uint64_t value) {
+    putTag(out, field, VARINT);
+    putVarint(out, value);
+}
+
+inline void putStringField(std::string* out, int field, std::string_view value) {
+    putTag(out, field, LENGTH_DELIMITED);
+    putVarint(out, value.size());
+    out->append(value.data(), value.size());
+}
+
+// 顺序读取一条消息中的字段，返回的 string_view 直接引用输入数据
+class Reader {
+public:
+    explicit Reader(std::string_view data)
+        : pos_(data.data()), end_(data.data() + data.size()) {}
+
+    // 读取下一个字段的tag，数据结束或格式错误时返回false，可用ok()区分
+    bool next(int* field, WireType* type);
+
+    bool readVarint(uint64_t* value);
+    bool readBytes(std::string_view* value);
+
+    // 跳过当前字段的值
+    bool skip(WireType type);
+
+    bool ok() const { return ok_; }
+
+private:
+    const char* pos_;
+    const char* end_;
+    bool ok_ = true;
+};
+
+} // namespace wire
+
+#endif // WIRE_FORMAT_H
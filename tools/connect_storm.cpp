@@ -0,0 +1,252 @@
+// 连接风暴压测工具
+//
+// 按固定速率发起大量新连接（模拟发布后所有客户端同时重连），每个连接建立后立即发送一个
+// 二进制帧格式的心跳请求，统计两段延迟：
+//   connect: 从 connect() 到三次握手完成（内核完成，不需要服务器 accept）
+//   accept:  从 connect() 到收到心跳响应的第一个字节，包含服务器 accept、分配I/O线程、
+//            处理第一条消息的时间，监听线程成为瓶颈时这一项会明显变长
+// 所有连接保持到结束，客户端和服务器都需要足够的文件描述符（ulimit -n）。
+//
+// 用法: connect_storm <ip> <port> [总连接数=50000] [持续秒数=10] [线程数=4]
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 心跳请求的消息类型，见 MessageType::HEARTBEAT_REQUEST
+constexpr uint16_t kHeartbeatRequest = 6;
+
+// 单个连接等待响应的超时时间
+constexpr auto kResponseTimeout = std::chrono::seconds(30);
+
+struct Pending {
+    Clock::time_point start;
+    bool connected = false;
+};
+
+struct WorkerResult {
+    std::vector<double> connectMicros;
+    std::vector<double> acceptMicros;
+    int connectErrors = 0;
+    int timeouts = 0;
+};
+
+std::string makeHeartbeatFrame()
+{
+    std::string frame(8, '\0');
+    uint32_t length = 0;
+    uint16_t type = htons(kHeartbeatRequest);
+    uint16_t flags = 0;
+    ::memcpy(&frame[0], &length, sizeof length);
+    ::memcpy(&frame[4], &type, sizeof type);
+    ::memcpy(&frame[6], &flags, sizeof flags);
+    return frame;
+}
+
+// 每个线程按 interval 的间隔发起 count 个连接
+void runWorker(const sockaddr_in& addr, int count, std::chrono::nanoseconds interval,
+               Clock::time_point begin, WorkerResult* result, std::vector<int>* openFds)
+{
+    const std::string heartbeat = makeHeartbeatFrame();
+    int epfd = ::epoll_create1(EPOLL_CLOEXEC);
+    std::unordered_map<int, Pending> pending;
+    std::vector<epoll_event> events(1024);
+    int started = 0;
+
+    while (started < count || !pending.empty()) {
+        Clock::time_point now = Clock::now();
+
+        // 按计划时间发起新连接
+        while (started < count && begin + interval * started <= now) {
+            int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0) {
+                ++result->connectErrors;
+                ++started;
+                continue;
+            }
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+            Pending p;
+            p.start = Clock::now();
+            int ret = ::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof addr);
+            if (ret < 0 && errno != EINPROGRESS) {
+                ++result->connectErrors;
+                ::close(fd);
+                ++started;
+                continue;
+            }
+            epoll_event ev{};
+            ev.events = EPOLLOUT | EPOLLIN;
+            ev.data.fd = fd;
+            ::epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+            pending.emplace(fd, p);
+            ++started;
+        }
+
+        int timeoutMs = 1;
+        if (started >= count) {
+            timeoutMs = 100;
+        }
+        int n = ::epoll_wait(epfd, events.data(), static_cast<int>(events.size()), timeoutMs);
+        now = Clock::now();
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            auto it = pending.find(fd);
+            if (it == pending.end()) {
+                continue;
+            }
+            Pending& p = it->second;
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                ++result->connectErrors;
+                ::epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+                ::close(fd);
+                pending.erase(it);
+                continue;
+            }
+
+            if (!p.connected && (events[i].events & EPOLLOUT)) {
+                p.connected = true;
+                result->connectMicros.push_back(
+                    std::chrono::duration<double, std::micro>(now - p.start).count());
+                if (::write(fd, heartbeat.data(), heartbeat.size()) != static_cast<ssize_t>(heartbeat.size())) {
+                    ++result->connectErrors;
+                    ::epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+                    ::close(fd);
+                    pending.erase(it);
+                    continue;
+                }
+                epoll_event ev{};
+                ev.events = EPOLLIN;
+                ev.data.fd = fd;
+                ::epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
+            }
+
+            if (p.connected && (events[i].events & EPOLLIN)) {
+                char buf[256];
+                ssize_t nread = ::read(fd, buf, sizeof buf);
+                ::epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+                if (nread > 0) {
+                    result->acceptMicros.push_back(
+                        std::chrono::duration<double, std::micro>(now - p.start).count());
+                    openFds->push_back(fd);
+                } else {
+                    ++result->connectErrors;
+                    ::close(fd);
+                }
+                pending.erase(it);
+            }
+        }
+
+        // 清理超时的连接
+        if (started >= count) {
+            for (auto it = pending.begin(); it != pending.end();) {
+                if (now - it->second.start > kResponseTimeout) {
+                    ++result->timeouts;
+                    ::epoll_ctl(epfd, EPOLL_CTL_DEL, it->first, nullptr);
+                    ::close(it->first);
+                    it = pending.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+    ::close(epfd);
+}
+
+void report(const char* name, std::vector<double>& samples)
+{
+    if (samples.empty()) {
+        std::printf("%-8s no samples\n", name);
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto at = [&samples](double q) {
+        return samples[std::min(samples.size() - 1, static_cast<size_t>(q * static_cast<double>(samples.size())))];
+    };
+    std::printf("%-8s n=%zu p50=%.0fus p90=%.0fus p99=%.0fus p99.9=%.0fus max=%.0fus\n",
+                name, samples.size(), at(0.5), at(0.9), at(0.99), at(0.999), samples.back());
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        std::fprintf(stderr, "usage: %s <ip> <port> [connections=50000] [seconds=10] [threads=4]\n", argv[0]);
+        return 1;
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(std::atoi(argv[2])));
+    if (::inet_pton(AF_INET, argv[1], &addr.sin_addr) != 1) {
+        std::fprintf(stderr, "invalid address %s\n", argv[1]);
+        return 1;
+    }
+    int total = argc > 3 ? std::atoi(argv[3]) : 50000;
+    double seconds = argc > 4 ? std::atof(argv[4]) : 10.0;
+    int threads = argc > 5 ? std::atoi(argv[5]) : 4;
+    if (total <= 0 || seconds <= 0 || threads <= 0) {
+        std::fprintf(stderr, "invalid arguments\n");
+        return 1;
+    }
+
+    // 每个线程负责 total / threads 个连接，各线程的发起时间错开
+    auto interval = std::chrono::nanoseconds(static_cast<int64_t>(seconds * 1e9 * threads / total));
+    Clock::time_point begin = Clock::now() + std::chrono::milliseconds(10);
+    std::vector<WorkerResult> results(threads);
+    std::vector<std::vector<int>> openFds(threads);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; ++i) {
+        int count = total / threads + (i < total % threads ? 1 : 0);
+        Clock::time_point start = begin + interval * i / threads;
+        workers.emplace_back(runWorker, std::cref(addr), count, interval, start, &results[i], &openFds[i]);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+
+    WorkerResult all;
+    for (auto& result : results) {
+        all.connectMicros.insert(all.connectMicros.end(), result.connectMicros.begin(), result.connectMicros.end());
+        all.acceptMicros.insert(all.acceptMicros.end(), result.acceptMicros.begin(), result.acceptMicros.end());
+        all.connectErrors += result.connectErrors;
+        all.timeouts += result.timeouts;
+    }
+
+    std::printf("%d connections in %.2fs, %zu answered, %d errors, %d timeouts\n",
+                total, elapsed, all.acceptMicros.size(), all.connectErrors, all.timeouts);
+    report("connect", all.connectMicros);
+    report("accept", all.acceptMicros);
+
+    for (auto& fds : openFds) {
+        for (int fd : fds) {
+            ::close(fd);
+        }
+    }
+    return all.acceptMicros.size() == static_cast<size_t>(total) ? 0 : 2;
+}
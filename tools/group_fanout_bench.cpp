@@ -0,0 +1,307 @@
+// 群聊扇出压测工具
+//
+// 模拟一条群聊消息推送给所有在线成员，对比两种方式：
+//   copy:   原来的逐成员发送，每个成员一个 runInLoop 任务，任务中持有一份消息副本
+//           （与跨线程调用 TcpConnection::send 相同）
+//   shared: ChatServer::broadcast 的方式，ChatCodec::encode 编码一次，成员按所属EventLoop分组，
+//           每个EventLoop一个任务，共享同一个 EncodedMessage，通过 ChatCodec::send 发送
+// 每个成员是一对 socketpair 上的 TcpConnection，发送端分布在若干I/O线程中，并以二进制帧模式
+// 绑定 Session；接收端在另外的线程中读取，收到完整的帧时记录投递延迟（从开始群发算起）。
+// 统计：用户态复制的字节数（消息副本 + 编码结果 + 写不完时追加到输出缓冲区的部分）、
+// runInLoop 任务数量、投递延迟的 p50/p99/最大值（多轮取中位数）。
+// 每个成员占用两个文件描述符，工具会尝试把 RLIMIT_NOFILE 提高到硬上限。
+//
+// 用法: group_fanout_bench [成员数=5000] [内容字节数=256] [轮数=30] [I/O线程数=4] [接收线程数=2]
+
+#include "src/server/ChatCodec.h"
+#include "src/server/Session.h"
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThread.h"
+#include "muduo/net/InetAddress.h"
+
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using muduo::net::EventLoop;
+using muduo::net::TcpConnection;
+using muduo::net::TcpConnectionPtr;
+using Clock = std::chrono::steady_clock;
+
+int64_t nowMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch()).count();
+}
+
+struct Member {
+    TcpConnectionPtr server;              // 发送端，属于I/O线程
+    TcpConnectionPtr client;              // 接收端，属于接收线程
+    std::atomic<int64_t> deliveredAt{0};  // 收到完整帧的时间（微秒）
+};
+
+struct RunResult {
+    double p50 = 0;
+    double p99 = 0;
+    double max = 0;
+    uint64_t copiedBytes = 0;
+    uint64_t tasks = 0;
+};
+
+class FanoutBench {
+public:
+    FanoutBench(int members, int ioThreads, int clientThreads)
+        : members_(members),
+          codec_([](const TcpConnectionPtr&, const ChatCodec::Frame&, muduo::Timestamp) {})
+    {
+        for (int i = 0; i < ioThreads; ++i) {
+            startLoop("fanout-io" + std::to_string(i), &ioLoops_);
+        }
+        for (int i = 0; i < clientThreads; ++i) {
+            startLoop("fanout-client" + std::to_string(i), &clientLoops_);
+        }
+    }
+
+    // 建立所有成员的连接
+    bool connect()
+    {
+        muduo::CountDownLatch latch(static_cast<int>(members_.size()) * 2);
+        for (size_t i = 0; i < members_.size(); ++i) {
+            int fds[2];
+            if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) != 0) {
+                std::fprintf(stderr, "socketpair failed after %zu members, raise ulimit -n\n", i);
+                for (size_t j = i; j < members_.size(); ++j) {
+                    latch.countDown();
+                    latch.countDown();
+                }
+                latch.wait();
+                return false;
+            }
+
+            Member* member = &members_[i];
+            muduo::net::InetAddress address;
+            EventLoop* ioLoop = ioLoops_[i % ioLoops_.size()];
+            EventLoop* clientLoop = clientLoops_[i % clientLoops_.size()];
+            std::string name = "member" + std::to_string(i);
+
+            // 发送端以二进制帧模式绑定会话，与已登录的客户端一致
+            auto session = std::make_shared<Session>();
+            session->mode = ChatCodec::Mode::BINARY;
+            member->server = std::make_shared<TcpConnection>(ioLoop, name + "-server", fds[0], address, address);
+            member->server->setContext(SessionPtr(session));
+
+            member->client = std::make_shared<TcpConnection>(clientLoop, name + "-client", fds[1], address, address);
+            member->client->setMessageCallback(
+                [this, member](const TcpConnectionPtr&, muduo::net::Buffer* buf, muduo::Timestamp) {
+                    size_t frameSize = frameSize_.load(std::memory_order_acquire);
+                    if (frameSize == 0 || buf->readableBytes() < frameSize) {
+                        return;
+                    }
+                    buf->retrieve(frameSize);
+                    member->deliveredAt.store(nowMicros(), std::memory_order_relaxed);
+                    delivered_.fetch_add(1, std::memory_order_release);
+                });
+
+            TcpConnectionPtr server = member->server;
+            TcpConnectionPtr client = member->client;
+            ioLoop->runInLoop([server, &latch]() {
+                server->connectEstablished();
+                latch.countDown();
+            });
+            clientLoop->runInLoop([client, &latch]() {
+                client->connectEstablished();
+                latch.countDown();
+            });
+        }
+        latch.wait();
+        return true;
+    }
+
+    // 群发一次，等待所有成员收到后返回统计
+    RunResult broadcast(const std::string& message, bool shared)
+    {
+        ChatCodec::EncodedMessagePtr encoded = ChatCodec::encode(message);
+        frameSize_.store(encoded->binary.size(), std::memory_order_release);
+        delivered_.store(0);
+        bufferedBytes_.store(0);
+        for (Member& member : members_) {
+            member.deliveredAt.store(0, std::memory_order_relaxed);
+        }
+
+        RunResult result;
+        const int64_t start = nowMicros();
+        if (shared) {
+            result.copiedBytes = encoded->text.size() + encoded->binary.size() + encoded->wire.size();
+            std::unordered_map<EventLoop*, std::vector<TcpConnectionPtr>> connsByLoop;
+            for (Member& member : members_) {
+                connsByLoop[member.server->getLoop()].push_back(member.server);
+            }
+            for (auto& entry : connsByLoop) {
+                entry.first->runInLoop([this, conns = std::move(entry.second), encoded]() {
+                    for (const TcpConnectionPtr& conn : conns) {
+                        size_t before = conn->outputBuffer()->readableBytes();
+                        codec_.send(conn, *encoded);
+                        countBuffered(conn, before);
+                    }
+                });
+                ++result.tasks;
+            }
+        } else {
+            const std::string& frame = encoded->binary;
+            for (Member& member : members_) {
+                TcpConnectionPtr conn = member.server;
+                conn->getLoop()->runInLoop([this, conn, copy = frame]() {
+                    size_t before = conn->outputBuffer()->readableBytes();
+                    conn->send(copy);
+                    countBuffered(conn, before);
+                });
+                result.copiedBytes += frame.size();
+                ++result.tasks;
+            }
+        }
+
+        while (delivered_.load(std::memory_order_acquire) < members_.size()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        result.copiedBytes += bufferedBytes_.load();
+
+        std::vector<int64_t> latencies;
+        latencies.reserve(members_.size());
+        for (Member& member : members_) {
+            latencies.push_back(member.deliveredAt.load(std::memory_order_relaxed) - start);
+        }
+        std::sort(latencies.begin(), latencies.end());
+        result.p50 = static_cast<double>(latencies[latencies.size() / 2]);
+        result.p99 = static_cast<double>(latencies[latencies.size() * 99 / 100]);
+        result.max = static_cast<double>(latencies.back());
+        return result;
+    }
+
+    // 关闭所有连接并停止线程
+    void stop()
+    {
+        muduo::CountDownLatch latch(static_cast<int>(members_.size()) * 2);
+        for (Member& member : members_) {
+            for (const TcpConnectionPtr& conn : {member.server, member.client}) {
+                if (!conn) {
+                    latch.countDown();
+                    continue;
+                }
+                conn->getLoop()->runInLoop([conn, &latch]() {
+                    conn->connectDestroyed();
+                    latch.countDown();
+                });
+            }
+        }
+        latch.wait();
+        members_.clear();
+        threads_.clear();
+    }
+
+private:
+    void startLoop(const std::string& name, std::vector<EventLoop*>* loops)
+    {
+        threads_.emplace_back(new muduo::net::EventLoopThread(muduo::net::EventLoopThread::ThreadInitCallback(), name));
+        loops->push_back(threads_.back()->startLoop());
+    }
+
+    // 套接字写不完时 TcpConnection 把剩余部分追加到输出缓冲区，这部分也是一次复制
+    void countBuffered(const TcpConnectionPtr& conn, size_t before)
+    {
+        size_t after = conn->outputBuffer()->readableBytes();
+        if (after > before) {
+            bufferedBytes_.fetch_add(after - before, std::memory_order_relaxed);
+        }
+    }
+
+    std::vector<Member> members_;
+    ChatCodec codec_;
+    std::vector<std::unique_ptr<muduo::net::EventLoopThread>> threads_;
+    std::vector<EventLoop*> ioLoops_;
+    std::vector<EventLoop*> clientLoops_;
+    std::atomic<size_t> frameSize_{0};
+    std::atomic<size_t> delivered_{0};
+    std::atomic<uint64_t> bufferedBytes_{0};
+};
+
+// 每个成员两个文件描述符，尽量提高软上限
+void raiseFileLimit(int members)
+{
+    rlimit limit;
+    if (::getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+        return;
+    }
+    rlim_t wanted = static_cast<rlim_t>(members) * 2 + 64;
+    if (limit.rlim_cur < wanted) {
+        limit.rlim_cur = std::min(wanted, limit.rlim_max);
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+double median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    int members = argc > 1 ? std::atoi(argv[1]) : 5000;
+    int contentBytes = argc > 2 ? std::atoi(argv[2]) : 256;
+    int rounds = argc > 3 ? std::atoi(argv[3]) : 30;
+    int ioThreads = argc > 4 ? std::atoi(argv[4]) : 4;
+    int clientThreads = argc > 5 ? std::atoi(argv[5]) : 2;
+    if (members <= 0 || contentBytes < 0 || rounds <= 0 || ioThreads <= 0 || clientThreads <= 0) {
+        std::fprintf(stderr, "Usage: %s [members] [content bytes] [rounds] [io threads] [client threads]\n", argv[0]);
+        return 1;
+    }
+
+    muduo::Logger::setLogLevel(muduo::Logger::WARN);
+    raiseFileLimit(members);
+
+    // 与 handleGroupChat 推送给成员的消息格式相同
+    std::string message = "13:messageId=7391829301849133057;groupId=1;fromUserId=2;fromUsername=alice;content=" +
+                          std::string(static_cast<size_t>(contentBytes), 'x') + ";timestamp=1700000000000";
+
+    FanoutBench bench(members, ioThreads, clientThreads);
+    if (!bench.connect()) {
+        bench.stop();
+        return 1;
+    }
+
+    std::printf("%d members on %d I/O threads, %zu byte message, %d rounds\n",
+                members, ioThreads, message.size(), rounds);
+    for (bool shared : {false, true}) {
+        std::vector<double> p50s, p99s, maxes;
+        RunResult last;
+        for (int round = 0; round < rounds; ++round) {
+            last = bench.broadcast(message, shared);
+            p50s.push_back(last.p50);
+            p99s.push_back(last.p99);
+            maxes.push_back(last.max);
+        }
+        std::printf("%-6s copied %10llu bytes (%8.1f KB)  tasks %6llu  p50 %7.0f us  p99 %7.0f us  max %7.0f us\n",
+                    shared ? "shared" : "copy",
+                    static_cast<unsigned long long>(last.copiedBytes), last.copiedBytes / 1024.0,
+                    static_cast<unsigned long long>(last.tasks),
+                    median(p50s), median(p99s), median(maxes));
+    }
+
+    bench.stop();
+    return 0;
+}
@@ -0,0 +1,167 @@
+// 私聊发送路径的Redis压测工具
+//
+// 对比两种发送方式每个连接的吞吐（msgs/s）:
+//   legacy: 原来的逐条命令方式，SISMEMBER 好友检查、RPUSH、LTRIM、SISMEMBER 在线检查，
+//           接收者不在线时再 RPUSH 离线队列，每条消息4~5次往返
+//   script: RedisService::sendPrivateMessage，一次 EVALSHA 完成
+// 每个线程独占一个连接，使用各自的一对用户，一半接收者在线、一半不在线。
+// 测试用户ID从 kBaseUserId 开始，结束后删除生成的键（包括整个消息流）；默认使用 db 15，请勿指向生产库。
+//
+// 用法: redis_send_bench <ip> <port> [每连接消息数=20000] [连接数=1] [db=15]
+
+#include "src/service/RedisService.h"
+#include "muduo/base/Logging.h"
+#include <sw/redis++/redis++.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kBaseUserId = 1900000000;
+
+const std::string kContent = "hello, this is a benchmark message";
+
+// 与 RedisService 为 kContent 生成的消息记录大小相近
+const std::string kRecord =
+    R"({"content":"hello, this is a benchmark message","from":1,"timestamp":1700000000000,"to":2,"type":"private"})";
+
+int senderOf(int thread) { return kBaseUserId + thread * 2; }
+int recipientOf(int thread) { return kBaseUserId + thread * 2 + 1; }
+
+std::string chatKey(int a, int b)
+{
+    return "chat:" + std::to_string(std::min(a, b)) + ":" + std::to_string(std::max(a, b));
+}
+
+std::string friendsKey(int user) { return "user:" + std::to_string(user) + ":friends"; }
+std::string offlineKey(int user) { return "user:" + std::to_string(user) + ":offline"; }
+
+const std::string kOnlineKey = "online:users";
+const std::string kStreamKey = "stream:messages";
+
+void prepare(sw::redis::Redis& redis, int connections)
+{
+    for (int t = 0; t < connections; ++t) {
+        redis.sadd(friendsKey(senderOf(t)), std::to_string(recipientOf(t)));
+        if (t % 2 == 0) {
+            redis.sadd(kOnlineKey, std::to_string(recipientOf(t)));
+        }
+    }
+}
+
+void cleanup(sw::redis::Redis& redis, int connections)
+{
+    for (int t = 0; t < connections; ++t) {
+        std::string chat = chatKey(senderOf(t), recipientOf(t));
+        redis.del({friendsKey(senderOf(t)), chat, "pushed:" + chat, offlineKey(recipientOf(t))});
+        redis.srem(kOnlineKey, std::to_string(recipientOf(t)));
+    }
+    // 发送脚本追加的消息流；message:<id> 索引自带过期时间
+    redis.del(kStreamKey);
+}
+
+// 原来的发送方式
+void sendLegacy(sw::redis::Redis& redis, int from, int to)
+{
+    std::string toStr = std::to_string(to);
+    if (!redis.sismember(friendsKey(from), toStr)) {
+        return;
+    }
+    std::string key = chatKey(from, to);
+    redis.rpush(key, kRecord);
+    redis.ltrim(key, -100, -1);
+    if (!redis.sismember(kOnlineKey, toStr)) {
+        redis.rpush(offlineKey(to), kRecord);
+    }
+}
+
+template <typename Send>
+double run(const char* name, int connections, int messages, Send send)
+{
+    std::atomic<int> failures{0};
+    std::vector<std::thread> threads;
+    Clock::time_point start = Clock::now();
+    for (int t = 0; t < connections; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < messages; ++i) {
+                if (!send(senderOf(t), recipientOf(t))) {
+                    failures.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    double total = static_cast<double>(connections) * messages;
+    std::printf("%-7s %10.0f msgs/s total  %10.0f msgs/s per connection  %8.1f us/msg  failures %d\n",
+                name, total / seconds, total / seconds / connections,
+                seconds * 1e6 * connections / total, failures.load());
+    return total / seconds;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        std::fprintf(stderr, "Usage: %s <ip> <port> [messages per connection] [connections] [db]\n", argv[0]);
+        return 1;
+    }
+    std::string host = argv[1];
+    int port = std::atoi(argv[2]);
+    int messages = argc > 3 ? std::atoi(argv[3]) : 20000;
+    int connections = argc > 4 ? std::atoi(argv[4]) : 1;
+    int db = argc > 5 ? std::atoi(argv[5]) : 15;
+    if (messages <= 0 || connections <= 0) {
+        std::fprintf(stderr, "Invalid arguments\n");
+        return 1;
+    }
+
+    // 每条消息一行INFO日志会淹没测量结果
+    muduo::Logger::setLogLevel(muduo::Logger::WARN);
+
+    sw::redis::ConnectionOptions options;
+    options.host = host;
+    options.port = port;
+    options.db = db;
+    sw::redis::ConnectionPoolOptions poolOptions;
+    poolOptions.size = connections;
+    sw::redis::Redis redis(options, poolOptions);
+
+    RedisService& service = RedisService::getInstance();
+    if (!service.init(host, port, "", db, connections)) {
+        std::fprintf(stderr, "Cannot connect to Redis at %s:%d\n", host.c_str(), port);
+        return 1;
+    }
+
+    cleanup(redis, connections);
+    prepare(redis, connections);
+
+    std::printf("%d connections, %d messages per connection, db %d\n", connections, messages, db);
+    double legacy = run("legacy", connections, messages, [&](int from, int to) {
+        try {
+            sendLegacy(redis, from, to);
+            return true;
+        } catch (const sw::redis::Error&) {
+            return false;
+        }
+    });
+    double script = run("script", connections, messages, [&](int from, int to) {
+        return service.sendPrivateMessage(from, to, kContent) != RedisService::SendResult::FAILED;
+    });
+    std::printf("speedup %.2fx\n", script / legacy);
+
+    cleanup(redis, connections);
+    return 0;
+}
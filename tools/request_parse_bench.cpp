@@ -0,0 +1,137 @@
+// 请求解析微基准
+//
+// 对比两种解析方式每条消息的耗时（ns/msg）和内存分配次数（allocs/msg）:
+//   old: 原来的 onMessage 路径，retrieveAllAsString 取出消息，两个 stringstream 加 getline
+//        切分，键值对逐个 substr 后存入 unordered_map<string, string>
+//   new: 直接在输入缓冲区上拆出消息类型，Request::parse 切分为 string_view 字段
+// 两种方式都从 muduo::net::Buffer 中读取同一组消息（私聊、群聊、历史记录、登录轮流出现），
+// 并查找一次 content 字段，模拟处理函数的访问。分配次数通过替换全局 operator new 统计。
+//
+// 用法: request_parse_bench [消息数=1000000] [轮数=3]
+
+#include "src/server/Request.h"
+#include "muduo/net/Buffer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+size_t g_allocations = 0;
+
+// 防止编译器把解析结果优化掉
+volatile size_t g_sink = 0;
+
+const char* const kMessages[] = {
+    "12:toUserId=1024;content=hello there, how are you doing today?",
+    "13:groupId=345678;content=meeting moved to 3pm, please update your calendars",
+    "36:type=private;targetUserId=1024;count=50;rid=h-17",
+    "1:username=alice;password=secret123",
+};
+constexpr size_t kMessageKinds = sizeof(kMessages) / sizeof(kMessages[0]);
+
+// 原来的解析方式
+void parseOld(muduo::net::Buffer* buffer)
+{
+    std::string message = buffer->retrieveAllAsString();
+
+    std::stringstream ss(message);
+    std::string msgTypeStr;
+    std::getline(ss, msgTypeStr, ':');
+    int msgType = std::stoi(msgTypeStr);
+
+    std::string content;
+    std::getline(ss, content);
+
+    std::unordered_map<std::string, std::string> msgData;
+    std::stringstream contentStream(content);
+    std::string item;
+    while (std::getline(contentStream, item, ';')) {
+        std::size_t pos = item.find('=');
+        if (pos != std::string::npos) {
+            std::string key = item.substr(0, pos);
+            std::string value = item.substr(pos + 1);
+            msgData[key] = value;
+        }
+    }
+
+    auto it = msgData.find("content");
+    g_sink = msgType + (it != msgData.end() ? it->second.size() : 0);
+}
+
+// Request 解析方式，字段直接引用缓冲区，处理完成后才取走数据
+void parseNew(muduo::net::Buffer* buffer)
+{
+    std::string_view message(buffer->peek(), buffer->readableBytes());
+    size_t colon = message.find(':');
+    int msgType = toInt(message.substr(0, colon));
+
+    Request request;
+    request.parse(message.substr(colon + 1));
+
+    auto it = request.find("content");
+    g_sink = msgType + (it != request.end() ? it->second.size() : 0);
+    buffer->retrieveAll();
+}
+
+template <typename Parse>
+void run(const char* name, int messages, Parse parse)
+{
+    muduo::net::Buffer buffer;
+    size_t allocations = g_allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < messages; ++i) {
+        const char* message = kMessages[i % kMessageKinds];
+        buffer.append(message, std::strlen(message));
+        parse(&buffer);
+    }
+    double nanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-4s %8.1f ns/msg  %6.2f allocs/msg\n", name, nanos / messages,
+                static_cast<double>(g_allocations - allocations) / messages);
+}
+
+} // namespace
+
+void* operator new(size_t size)
+{
+    ++g_allocations;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+int main(int argc, char* argv[])
+{
+    int messages = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 3;
+    if (messages <= 0 || rounds <= 0) {
+        std::fprintf(stderr, "Usage: %s [messages] [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    std::printf("%d messages per round\n", messages);
+    for (int round = 0; round < rounds; ++round) {
+        run("old", messages, parseOld);
+        run("new", messages, parseNew);
+    }
+    return 0;
+}
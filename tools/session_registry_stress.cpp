@@ -0,0 +1,386 @@
+// 会话注册表并发压力测试，以 -fsanitize=thread 构建（见 CMakeLists.txt）
+//
+// 多个 EventLoop 线程各自持有一组通过 socketpair 建立的 TcpConnection，服务端一侧与
+// ChatServer 一样通过 setContext 绑定 Session。多个工作线程随机执行：
+//   login:  与 ChatServer::bindUser 相同，写入 Session::userId 后绑定，被挤下线的旧连接
+//           清除 userId 并在其所属线程收到通知；登录期间连接已断开时解除绑定
+//   logout: 与 ChatServer::unbindUser 相同
+//   send:   按用户ID查找连接，在目标连接所属线程发送（ChatServer::deliver）
+//   count:  读取在线用户数（指标采集）
+//   close:  forceClose，断开回调在连接所属线程解除绑定，随后建立新连接替换
+// 同一连接上的登录和登出在 ChatServer 中由会话的任务队列串行执行，这里用每个连接槽位的锁保证。
+// 结束后检查注册表与各会话的userId一致，不一致时返回1。
+// 只有本文件和 SessionRegistry 经过插桩，muduo 库内部的数据竞争不在检查范围内。
+//
+// 用法: session_registry_stress [工作线程数=8] [每线程操作数=200000] [连接数=256] [用户数=64] [I/O线程数=4]
+
+#include "src/server/Session.h"
+#include "src/server/SessionRegistry.h"
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThread.h"
+#include "muduo/net/InetAddress.h"
+
+#include <sys/socket.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+using muduo::net::EventLoop;
+using muduo::net::TcpConnection;
+using muduo::net::TcpConnectionPtr;
+
+const std::string kKickOutMessage = "0:errorMsg=Your account logged in elsewhere";
+const std::string kChatMessage = "12:fromUserId=1;content=stress";
+
+class RegistryStress {
+public:
+    RegistryStress(int loops, int slots, int users)
+        : slots_(slots), users_(users), loopCount_(loops) {}
+
+    // 启动I/O线程并在各自线程中建立连接
+    void start()
+    {
+        for (int i = 0; i < loopCount_; ++i) {
+            loopThreads_.emplace_back(new muduo::net::EventLoopThread(muduo::net::EventLoopThread::ThreadInitCallback(),
+                                                                      "stress-io" + std::to_string(i)));
+            loops_.push_back(loopThreads_.back()->startLoop());
+            clients_.emplace_back(new std::unordered_set<TcpConnectionPtr>());
+        }
+
+        muduo::CountDownLatch latch(static_cast<int>(slots_.size()));
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            EventLoop* loop = loops_[i % loops_.size()];
+            loop->runInLoop([this, i, loop, &latch]() {
+                openConnection(i, loop);
+                latch.countDown();
+            });
+        }
+        latch.wait();
+    }
+
+    // 工作线程随机执行各种操作
+    void run(int threads, int operations)
+    {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([this, t, operations]() { work(t, operations); });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // 等待各I/O线程处理完已排队的发送、断开和重建
+    void quiesce()
+    {
+        for (int round = 0; round < 5; ++round) {
+            muduo::CountDownLatch latch(static_cast<int>(loops_.size()));
+            for (EventLoop* loop : loops_) {
+                loop->runInLoop([&latch]() { latch.countDown(); });
+            }
+            latch.wait();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    }
+
+    // 检查注册表与会话状态一致，返回错误数量
+    int verify()
+    {
+        int errors = 0;
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            std::lock_guard<std::mutex> lock(slots_[i].mutex);
+            const TcpConnectionPtr& conn = slots_[i].conn;
+            Session* session = conn ? getSession(conn) : nullptr;
+            if (!session || !conn->connected()) {
+                std::fprintf(stderr, "slot %zu: connection was not replaced\n", i);
+                ++errors;
+                continue;
+            }
+            int userId = session->userId.load();
+            if (userId != -1 && registry_.find(userId) != conn) {
+                std::fprintf(stderr, "slot %zu: session claims user %d but the registry does not\n", i, userId);
+                ++errors;
+            }
+        }
+
+        size_t online = 0;
+        for (int userId = 0; userId < users_; ++userId) {
+            TcpConnectionPtr conn = registry_.find(userId);
+            if (!conn) {
+                continue;
+            }
+            ++online;
+            Session* session = getSession(conn);
+            if (!conn->connected()) {
+                std::fprintf(stderr, "user %d: registered to a closed connection\n", userId);
+                ++errors;
+            } else if (!session || session->userId.load() != userId) {
+                std::fprintf(stderr, "user %d: registered connection belongs to user %d\n",
+                             userId, session ? session->userId.load() : -1);
+                ++errors;
+            }
+        }
+
+        if (registry_.userCount() != online) {
+            std::fprintf(stderr, "%zu users registered, found %zu\n", registry_.userCount(), online);
+            ++errors;
+        }
+        return errors;
+    }
+
+    // 关闭所有连接并停止I/O线程
+    void stop()
+    {
+        stopping_.store(true);
+        for (Slot& slot : slots_) {
+            std::lock_guard<std::mutex> lock(slot.mutex);
+            if (slot.conn) {
+                slot.conn->forceClose();
+            }
+        }
+        quiesce();
+        slots_.clear();
+        loopThreads_.clear();
+    }
+
+    void report() const
+    {
+        std::printf("logins %llu (kicked %llu, closed during login %llu), logouts %llu, sends %llu, "
+                    "delivered %llu, counts %llu, closes %llu, bytes received %llu\n",
+                    load(logins_), load(kicks_), load(lateLogins_), load(logouts_), load(sends_),
+                    load(delivered_), load(counts_), load(closes_), load(bytesReceived_));
+    }
+
+private:
+    struct Slot {
+        std::mutex mutex;
+        TcpConnectionPtr conn;
+    };
+
+    static unsigned long long load(const std::atomic<uint64_t>& counter)
+    {
+        return static_cast<unsigned long long>(counter.load());
+    }
+
+    size_t loopIndex(EventLoop* loop) const
+    {
+        for (size_t i = 0; i < loops_.size(); ++i) {
+            if (loops_[i] == loop) {
+                return i;
+            }
+        }
+        return 0;
+    }
+
+    // 在 loop 所属线程中建立一对连接，服务端一侧放入槽位
+    void openConnection(size_t index, EventLoop* loop)
+    {
+        int fds[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) != 0) {
+            LOG_SYSFATAL << "socketpair";
+        }
+        std::string name = "slot" + std::to_string(index) + "#" + std::to_string(nextConnectionId_.fetch_add(1));
+        muduo::net::InetAddress address;
+
+        TcpConnectionPtr server = std::make_shared<TcpConnection>(loop, name + "-server", fds[0], address, address);
+        server->setConnectionCallback([this](const TcpConnectionPtr& conn) { onServerConnection(conn); });
+        server->setMessageCallback([](const TcpConnectionPtr&, muduo::net::Buffer* buf, muduo::Timestamp) {
+            buf->retrieveAll();
+        });
+        server->setCloseCallback([this, index](const TcpConnectionPtr& conn) { onServerClose(index, conn); });
+
+        std::unordered_set<TcpConnectionPtr>* clients = clients_[loopIndex(loop)].get();
+        TcpConnectionPtr client = std::make_shared<TcpConnection>(loop, name + "-client", fds[1], address, address);
+        client->setMessageCallback([this](const TcpConnectionPtr&, muduo::net::Buffer* buf, muduo::Timestamp) {
+            bytesReceived_.fetch_add(buf->readableBytes(), std::memory_order_relaxed);
+            buf->retrieveAll();
+        });
+        client->setCloseCallback([clients](const TcpConnectionPtr& conn) {
+            clients->erase(conn);
+            conn->getLoop()->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+        });
+        clients->insert(client);
+
+        server->connectEstablished();
+        client->connectEstablished();
+
+        std::lock_guard<std::mutex> lock(slots_[index].mutex);
+        slots_[index].conn = server;
+    }
+
+    // 与 ChatServer::onConnection 相同：建立时绑定会话，断开时解除绑定
+    void onServerConnection(const TcpConnectionPtr& conn)
+    {
+        if (conn->connected()) {
+            conn->setContext(std::make_shared<Session>());
+            return;
+        }
+
+        unbindUser(conn);
+    }
+
+    // 与 TcpServer::removeConnection 相同，随后在同一线程中建立新连接替换
+    void onServerClose(size_t index, const TcpConnectionPtr& conn)
+    {
+        EventLoop* loop = conn->getLoop();
+        loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+        if (!stopping_.load()) {
+            openConnection(index, loop);
+        }
+    }
+
+    // 与 ChatServer::bindUser 相同
+    void login(const TcpConnectionPtr& conn, int userId)
+    {
+        Session* session = getSession(conn);
+        int current = session->userId.load();
+        if (current != -1 && current != userId) {
+            unbindUser(conn);
+        }
+
+        session->userId.store(userId);
+        TcpConnectionPtr previous = registry_.bind(userId, conn);
+        if (previous) {
+            Session* oldSession = getSession(previous);
+            int expected = userId;
+            oldSession->userId.compare_exchange_strong(expected, -1);
+            deliver(previous, kKickOutMessage);
+            kicks_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (!conn->connected()) {
+            int expected = userId;
+            session->userId.compare_exchange_strong(expected, -1);
+            registry_.unbind(userId, conn);
+            lateLogins_.fetch_add(1, std::memory_order_relaxed);
+        }
+        logins_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 与 ChatServer::unbindUser 相同
+    void unbindUser(const TcpConnectionPtr& conn)
+    {
+        Session* session = getSession(conn);
+        int userId = session ? session->userId.exchange(-1) : -1;
+        if (userId != -1) {
+            registry_.unbind(userId, conn);
+        }
+    }
+
+    // 与 ChatServer::deliver 相同，在目标连接所属线程中发送
+    void deliver(const TcpConnectionPtr& conn, const std::string& message)
+    {
+        conn->getLoop()->runInLoop([this, conn, message]() {
+            if (conn->connected()) {
+                conn->send(message);
+                delivered_.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    void work(int seed, int operations)
+    {
+        std::mt19937 rng(static_cast<unsigned>(seed) * 7919u + 1);
+        std::uniform_int_distribution<size_t> slotDist(0, slots_.size() - 1);
+        std::uniform_int_distribution<int> userDist(0, users_ - 1);
+        std::uniform_int_distribution<int> opDist(0, 99);
+
+        for (int i = 0; i < operations; ++i) {
+            int op = opDist(rng);
+            if (op < 40) {
+                TcpConnectionPtr conn = registry_.find(userDist(rng));
+                if (conn) {
+                    deliver(conn, kChatMessage);
+                    sends_.fetch_add(1, std::memory_order_relaxed);
+                }
+                continue;
+            }
+            if (op < 45) {
+                registry_.userCount();
+                counts_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            Slot& slot = slots_[slotDist(rng)];
+            std::lock_guard<std::mutex> lock(slot.mutex);
+            if (!slot.conn) {
+                continue;
+            }
+            if (op < 75) {
+                login(slot.conn, userDist(rng));
+            } else if (op < 95) {
+                unbindUser(slot.conn);
+                logouts_.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                slot.conn->forceClose();
+                closes_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    SessionRegistry registry_;
+    std::vector<Slot> slots_;
+    const int users_;
+    const int loopCount_;
+    std::vector<std::unique_ptr<muduo::net::EventLoopThread>> loopThreads_;
+    std::vector<EventLoop*> loops_;
+    // 每个I/O线程的客户端一侧连接，只在该线程中访问
+    std::vector<std::unique_ptr<std::unordered_set<TcpConnectionPtr>>> clients_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<uint64_t> nextConnectionId_{0};
+
+    std::atomic<uint64_t> logins_{0};
+    std::atomic<uint64_t> kicks_{0};
+    std::atomic<uint64_t> lateLogins_{0};
+    std::atomic<uint64_t> logouts_{0};
+    std::atomic<uint64_t> sends_{0};
+    std::atomic<uint64_t> delivered_{0};
+    std::atomic<uint64_t> counts_{0};
+    std::atomic<uint64_t> closes_{0};
+    std::atomic<uint64_t> bytesReceived_{0};
+};
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    int threads = argc > 1 ? std::atoi(argv[1]) : 8;
+    int operations = argc > 2 ? std::atoi(argv[2]) : 200000;
+    int slots = argc > 3 ? std::atoi(argv[3]) : 256;
+    int users = argc > 4 ? std::atoi(argv[4]) : 64;
+    int loops = argc > 5 ? std::atoi(argv[5]) : 4;
+    if (threads <= 0 || operations <= 0 || slots <= 0 || users <= 0 || loops <= 0) {
+        std::fprintf(stderr, "Usage: %s [threads] [operations per thread] [connections] [users] [io threads]\n", argv[0]);
+        return 1;
+    }
+
+    muduo::Logger::setLogLevel(muduo::Logger::WARN);
+
+    RegistryStress stress(loops, slots, users);
+    stress.start();
+
+    auto start = std::chrono::steady_clock::now();
+    stress.run(threads, operations);
+    stress.quiesce();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int errors = stress.verify();
+    stress.report();
+    std::printf("%d threads x %d operations over %d connections and %d users in %.2f s, %d inconsistencies\n",
+                threads, operations, slots, users, seconds, errors);
+    stress.stop();
+    return errors == 0 ? 0 : 1;
+}
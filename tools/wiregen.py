@@ -0,0 +1,384 @@
+#!/usr/bin/env python3
+"""根据消息定义文件生成二进制编解码代码
+
+用法: wiregen.py <schema> <输出目录>
+
+输出 <名称>.h 和 <名称>.cpp，名称取定义文件的文件名（不含扩展名）。
+定义文件语法和编码规则分别见 src/wire/Messages.schema 和 src/wire/WireFormat.h。
+"""
+
+import os
+import re
+import sys
+
+SCALARS = {
+    # 类型: (C++类型, 线型, 默认值判断, 编码成uint64的表达式, JSON类型检查, JSON读取, JSON写入)
+    'int32': ('int32_t', 'VARINT', '{v} != 0', 'static_cast<uint64_t>(static_cast<int64_t>({v}))',
+              'isInt', 'asInt', '{v}'),
+    'int64': ('int64_t', 'VARINT', '{v} != 0', 'static_cast<uint64_t>({v})',
+              'isInt64', 'asInt64', 'static_cast<Json::Int64>({v})'),
+    'uint32': ('uint32_t', 'VARINT', '{v} != 0', 'static_cast<uint64_t>({v})',
+               'isUInt', 'asUInt', '{v}'),
+    'uint64': ('uint64_t', 'VARINT', '{v} != 0', '{v}',
+               'isUInt64', 'asUInt64', 'static_cast<Json::UInt64>({v})'),
+    'bool': ('bool', 'VARINT', '{v}', 'static_cast<uint64_t>({v})',
+             'isBool', 'asBool', '{v}'),
+    'string': ('std::string', 'LENGTH_DELIMITED', '!{v}.empty()', None,
+               'isString', 'asString', '{v}'),
+}
+
+# 从varint还原字段值
+DECODE_CAST = {
+    'int32': 'static_cast<int32_t>(static_cast<int64_t>(value))',
+    'int64': 'static_cast<int64_t>(value)',
+    'uint32': 'static_cast<uint32_t>(value)',
+    'uint64': 'value',
+    'bool': 'value != 0',
+}
+
+RID_FIELD = 15
+
+MESSAGE_RE = re.compile(r'message\s+([A-Za-z_]\w*)\s*\{')
+FIELD_RE = re.compile(r'(repeated\s+)?([A-Za-z_]\w*)\s+([A-Za-z_]\w*)\s*=\s*(\d+)\s*;')
+
+
+class SchemaError(Exception):
+    pass
+
+
+class Field:
+    def __init__(self, name, type_, number, repeated, line):
+        self.name = name
+        self.type = type_
+        self.number = number
+        self.repeated = repeated
+        self.line = line
+
+    @property
+    def is_message(self):
+        return self.type not in SCALARS
+
+    @property
+    def cpp_type(self):
+        base = self.type if self.is_message else SCALARS[self.type][0]
+        return 'std::vector<%s>' % base if self.repeated else base
+
+    @property
+    def wire_type(self):
+        return 'LENGTH_DELIMITED' if self.is_message else SCALARS[self.type][1]
+
+
+class Message:
+    def __init__(self, name, line):
+        self.name = name
+        self.line = line
+        self.fields = []
+
+
+def parse(path):
+    messages = []
+    current = None
+    with open(path, encoding='utf-8') as f:
+        for lineno, raw in enumerate(f, 1):
+            line = raw.split('#', 1)[0].strip()
+            if not line:
+                continue
+            where = '%s:%d' % (path, lineno)
+
+            if current is None:
+                m = MESSAGE_RE.fullmatch(line)
+                if not m:
+                    raise SchemaError('%s: expected "message <Name> {"' % where)
+                if any(msg.name == m.group(1) for msg in messages):
+                    raise SchemaError('%s: duplicate message %s' % (where, m.group(1)))
+                current = Message(m.group(1), where)
+                continue
+
+            if line == '}':
+                messages.append(current)
+                current = None
+                continue
+
+            m = FIELD_RE.fullmatch(line)
+            if not m:
+                raise SchemaError('%s: expected "[repeated] <type> <name> = <number>;"' % where)
+            repeated, type_, name, number = bool(m.group(1)), m.group(2), m.group(3), int(m.group(4))
+            if type_ not in SCALARS and not any(msg.name == type_ for msg in messages):
+                raise SchemaError('%s: unknown type %s (messages must be defined before use)' % (where, type_))
+            if number < 1 or number > 0x1fffffff:
+                raise SchemaError('%s: field number out of range' % where)
+            if number == RID_FIELD and (name != 'rid' or type_ != 'string' or repeated):
+                raise SchemaError('%s: field %d is reserved for "string rid"' % (where, RID_FIELD))
+            for other in current.fields:
+                if other.number == number or other.name == name:
+                    raise SchemaError('%s: duplicate field %s = %d' % (where, name, number))
+            current.fields.append(Field(name, type_, number, repeated, where))
+
+    if current is not None:
+        raise SchemaError('%s: message %s is not closed' % (current.line, current.name))
+    return messages
+
+
+def gen_header(messages, guard):
+    out = []
+    out.append('// 由 tools/wiregen.py 根据消息定义文件生成，请勿手动修改')
+    out.append('#ifndef %s' % guard)
+    out.append('#define %s' % guard)
+    out.append('')
+    out.append('#include <cstddef>')
+    out.append('#include <cstdint>')
+    out.append('#include <string>')
+    out.append('#include <string_view>')
+    out.append('#include <vector>')
+    out.append('#include <json/json.h>')
+    out.append('')
+    out.append('namespace wire {')
+    for msg in messages:
+        out.append('')
+        out.append('struct %s {' % msg.name)
+        for f in msg.fields:
+            init = ''
+            if not f.repeated and not f.is_message and f.type != 'string':
+                init = ' = false' if f.type == 'bool' else ' = 0'
+            out.append('    %s %s%s;' % (f.cpp_type, f.name, init))
+        out.append('};')
+    out.append('')
+    for msg in messages:
+        out.append('// %s' % msg.name)
+        out.append('size_t byteSize(const %s& msg);' % msg.name)
+        out.append('void encode(const %s& msg, std::string* out);' % msg.name)
+        out.append('bool decode(std::string_view data, %s* msg);' % msg.name)
+        out.append('Json::Value toJson(const %s& msg);' % msg.name)
+        out.append('void fromJson(const Json::Value& json, %s* msg);' % msg.name)
+        out.append('')
+    out.append('} // namespace wire')
+    out.append('')
+    out.append('#endif // %s' % guard)
+    return '\n'.join(out) + '\n'
+
+
+def gen_byte_size(msg):
+    out = ['size_t byteSize(const %s& msg)' % msg.name, '{', '    size_t size = 0;']
+    for f in msg.fields:
+        v = 'msg.' + f.name
+        if f.repeated:
+            out.append('    for (const auto& item : %s) {' % v)
+            out.extend('        ' + line for line in size_of_value(f, 'item', always=True))
+            out.append('    }')
+        elif f.is_message:
+            out.extend('    ' + line for line in size_of_value(f, v, always=True))
+        else:
+            out.append('    if (%s) {' % SCALARS[f.type][2].format(v=v))
+            out.extend('        ' + line for line in size_of_value(f, v, always=True))
+            out.append('    }')
+    out.append('    return size;')
+    out.append('}')
+    return out
+
+
+def size_of_value(f, v, always):
+    if f.is_message:
+        return ['size += lengthDelimitedSize(%d, byteSize(%s));' % (f.number, v)]
+    if f.type == 'string':
+        return ['size += lengthDelimitedSize(%d, %s.size());' % (f.number, v)]
+    if f.type == 'bool':
+        return ['size += tagSize(%d) + 1;' % f.number]
+    return ['size += tagSize(%d) + varintSize(%s);' % (f.number, SCALARS[f.type][3].format(v=v))]
+
+
+def encode_value(f, v):
+    if f.is_message:
+        return ['putTag(out, %d, LENGTH_DELIMITED);' % f.number,
+                'putVarint(out, byteSize(%s));' % v,
+                'encode(%s, out);' % v]
+    if f.type == 'string':
+        return ['putStringField(out, %d, %s);' % (f.number, v)]
+    return ['putVarintField(out, %d, %s);' % (f.number, SCALARS[f.type][3].format(v=v))]
+
+
+def gen_encode(msg):
+    out = ['void encode(const %s& msg, std::string* out)' % msg.name, '{']
+    for f in msg.fields:
+        v = 'msg.' + f.name
+        if f.repeated:
+            out.append('    for (const auto& item : %s) {' % v)
+            out.extend('        ' + line for line in encode_value(f, 'item'))
+            out.append('    }')
+        elif f.is_message:
+            out.extend('    ' + line for line in encode_value(f, v))
+        else:
+            out.append('    if (%s) {' % SCALARS[f.type][2].format(v=v))
+            out.extend('        ' + line for line in encode_value(f, v))
+            out.append('    }')
+    out.append('}')
+    return out
+
+
+def gen_decode(msg):
+    uses_value = any(not f.is_message and f.type != 'string' for f in msg.fields)
+    uses_bytes = any(f.is_message or f.type == 'string' for f in msg.fields)
+    out = ['bool decode(std::string_view data, %s* msg)' % msg.name, '{',
+           '    *msg = %s();' % msg.name,
+           '    Reader reader(data);',
+           '    int field = 0;',
+           '    WireType type = VARINT;']
+    if uses_value:
+        out.append('    uint64_t value = 0;')
+    if uses_bytes:
+        out.append('    std::string_view bytes;')
+    out.append('    while (reader.next(&field, &type)) {')
+    out.append('        switch (field) {')
+    for f in msg.fields:
+        target = 'msg->' + f.name
+        out.append('        case %d:' % f.number)
+        out.append('            if (type != %s) {' % f.wire_type)
+        out.append('                return false;')
+        out.append('            }')
+        if f.is_message:
+            out.append('            if (!reader.readBytes(&bytes)) {')
+            out.append('                return false;')
+            out.append('            }')
+            dest = ('&%s.emplace_back()' % target) if f.repeated else ('&' + target)
+            out.append('            if (!decode(bytes, %s)) {' % dest)
+            out.append('                return false;')
+            out.append('            }')
+        elif f.type == 'string':
+            out.append('            if (!reader.readBytes(&bytes)) {')
+            out.append('                return false;')
+            out.append('            }')
+            if f.repeated:
+                out.append('            %s.emplace_back(bytes);' % target)
+            else:
+                out.append('            %s.assign(bytes.data(), bytes.size());' % target)
+        else:
+            out.append('            if (!reader.readVarint(&value)) {')
+            out.append('                return false;')
+            out.append('            }')
+            if f.repeated:
+                out.append('            %s.push_back(%s);' % (target, DECODE_CAST[f.type]))
+            else:
+                out.append('            %s = %s;' % (target, DECODE_CAST[f.type]))
+        out.append('            break;')
+    out.append('        default:')
+    out.append('            if (!reader.skip(type)) {')
+    out.append('                return false;')
+    out.append('            }')
+    out.append('            break;')
+    out.append('        }')
+    out.append('    }')
+    out.append('    return reader.ok();')
+    out.append('}')
+    return out
+
+
+def json_value(f, v):
+    if f.is_message:
+        return 'toJson(%s)' % v
+    return SCALARS[f.type][6].format(v=v)
+
+
+def gen_to_json(msg):
+    out = ['Json::Value toJson(const %s& msg)' % msg.name, '{',
+           '    Json::Value json(Json::objectValue);']
+    for f in msg.fields:
+        v = 'msg.' + f.name
+        if f.repeated:
+            out.append('    Json::Value& %s = json["%s"] = Json::Value(Json::arrayValue);' % (local(f), f.name))
+            out.append('    for (const auto& item : %s) {' % v)
+            out.append('        %s.append(%s);' % (local(f), json_value(f, 'item')))
+            out.append('    }')
+        else:
+            out.append('    json["%s"] = %s;' % (f.name, json_value(f, v)))
+    out.append('    return json;')
+    out.append('}')
+    return out
+
+
+def local(f):
+    return f.name + 'Json'
+
+
+def gen_from_json(msg):
+    out = ['void fromJson(const Json::Value& json, %s* msg)' % msg.name, '{',
+           '    *msg = %s();' % msg.name,
+           '    if (!json.isObject()) {',
+           '        return;',
+           '    }',
+           '    const Json::Value* value = nullptr;']
+    for f in msg.fields:
+        target = 'msg->' + f.name
+        out.append('    value = json.find("%s", "%s" + %d);' % (f.name, f.name, len(f.name)))
+        if f.repeated:
+            out.append('    if (value && value->isArray()) {')
+            out.append('        for (const Json::Value& item : *value) {')
+            if f.is_message:
+                out.append('            fromJson(item, &%s.emplace_back());' % target)
+            else:
+                check, read = SCALARS[f.type][4], SCALARS[f.type][5]
+                out.append('            if (item.%s()) {' % check)
+                out.append('                %s.push_back(item.%s());' % (target, read))
+                out.append('            }')
+            out.append('        }')
+            out.append('    }')
+        elif f.is_message:
+            out.append('    if (value) {')
+            out.append('        fromJson(*value, &%s);' % target)
+            out.append('    }')
+        else:
+            check, read = SCALARS[f.type][4], SCALARS[f.type][5]
+            out.append('    if (value && value->%s()) {' % check)
+            out.append('        %s = value->%s();' % (target, read))
+            out.append('    }')
+    out.append('}')
+    return out
+
+
+def gen_source(messages, header_name):
+    out = ['// 由 tools/wiregen.py 根据消息定义文件生成，请勿手动修改',
+           '#include "%s"' % header_name,
+           '#include "src/wire/WireFormat.h"',
+           '',
+           'namespace wire {']
+    for msg in messages:
+        for gen in (gen_byte_size, gen_encode, gen_decode, gen_to_json, gen_from_json):
+            out.append('')
+            out.extend(gen(msg))
+    out.append('')
+    out.append('} // namespace wire')
+    return '\n'.join(out) + '\n'
+
+
+def write_if_changed(path, content):
+    # 内容未变时不改动文件，避免无谓的重新编译
+    try:
+        with open(path, encoding='utf-8') as f:
+            if f.read() == content:
+                return
+    except FileNotFoundError:
+        pass
+    with open(path, 'w', encoding='utf-8') as f:
+        f.write(content)
+
+
+def main(argv):
+    if len(argv) != 3:
+        sys.stderr.write('usage: %s <schema> <output-dir>\n' % argv[0])
+        return 2
+
+    schema, outdir = argv[1], argv[2]
+    try:
+        messages = parse(schema)
+    except (SchemaError, OSError) as e:
+        sys.stderr.write('wiregen: %s\n' % e)
+        return 1
+
+    base = os.path.splitext(os.path.basename(schema))[0]
+    guard = 'WIRE_%s_H' % re.sub(r'(?<!^)(?=[A-Z])', '_', base).upper()
+    os.makedirs(outdir, exist_ok=True)
+    write_if_changed(os.path.join(outdir, base + '.h'), gen_header(messages, guard))
+    write_if_changed(os.path.join(outdir, base + '.cpp'), gen_source(messages, base + '.h'))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))